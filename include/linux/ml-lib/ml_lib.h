@@ -8,6 +8,19 @@
 #ifndef _LINUX_ML_LIB_H
 #define _LINUX_ML_LIB_H
 
+#include <linux/types.h>
+#include <linux/atomic.h>
+#include <linux/spinlock.h>
+#include <linux/mutex.h>
+#include <linux/rcupdate.h>
+#include <linux/list.h>
+#include <linux/llist.h>
+#include <linux/workqueue.h>
+#include <linux/wait.h>
+#include <linux/kobject.h>
+#include <linux/kref.h>
+#include <linux/completion.h>
+
 /*
  * Any kernel subsystem can be in several modes
  * that define how this subsystem interacts with
@@ -42,22 +55,141 @@ enum {
 
 struct ml_lib_model;
 
+/*
+ * Priority classes of ML model's worker:
+ * (1) NORMAL - unbound worker with deferrable timer.
+ * (2) HIGH - high priority worker with precise timer.
+ * (3) BACKGROUND - deferrable worker; the background workers
+ *                  of all ML models share the limit of one
+ *                  concurrent worker per NUMA node.
+ */
+enum {
+	ML_LIB_WORKER_NORMAL_CLASS,
+	ML_LIB_WORKER_HIGH_CLASS,
+	ML_LIB_WORKER_BACKGROUND_CLASS,
+	ML_LIB_WORKER_CLASS_MAX
+};
+
+/*
+ * Reasons of ML model's mode change:
+ * (1) MANUAL - the mode has been set by ml_model_set_mode().
+ * (2) PROMOTION - ML-driven results have won several intervals.
+ * (3) EFFICIENCY - ML-driven results are worse than default algorithm(s).
+ * (4) LATENCY - the decisions of ML model are too slow.
+ */
+enum {
+	ML_LIB_MODE_CHANGE_MANUAL,
+	ML_LIB_MODE_CHANGE_PROMOTION,
+	ML_LIB_MODE_CHANGE_EFFICIENCY,
+	ML_LIB_MODE_CHANGE_LATENCY,
+	ML_LIB_MODE_CHANGE_REASON_MAX
+};
+
+/*
+ * Sources of ml_model_decide() answer:
+ * (1) DEFAULT - default algorithm(s) of subsystem.
+ * (2) CACHED - cached recommendation for the same features.
+ * (3) MODEL - in-kernel ML model or synchronous execute_operation().
+ * (4) AGENT - recommendation of user-space agent within latency budget.
+ */
+enum {
+	ML_LIB_DECISION_DEFAULT,
+	ML_LIB_DECISION_CACHED,
+	ML_LIB_DECISION_MODEL,
+	ML_LIB_DECISION_AGENT,
+	ML_LIB_DECISION_SOURCE_MAX
+};
+
 #define ML_LIB_SLEEP_TIMEOUT_DEFAULT	(10)
+#define ML_LIB_PROMOTE_EFFICIENCY_DEFAULT	(110)
+#define ML_LIB_DEMOTE_EFFICIENCY_DEFAULT	(90)
+#define ML_LIB_PROMOTE_INTERVALS_DEFAULT	(3)
+#define ML_LIB_HEDGE_AGENTS_DEFAULT		(2)
+#define ML_LIB_DATASET_QUEUE_DEPTH_DEFAULT	(8)
+
+/* Dataset compression algorithms */
+enum {
+	ML_LIB_NO_COMPRESSION,
+	ML_LIB_LZ4_COMPRESSION,
+	ML_LIB_ZSTD_COMPRESSION,
+	ML_LIB_COMPRESSION_MAX
+};
 
 /*
  * struct ml_lib_model_options - ML model global options
- * @sleep_timeout: main thread's sleep timeout
+ * @sleep_timeout: interval of worker's cycles (milliseconds)
+ * @min_sleep_timeout: lower bound of adaptive interval (milliseconds)
+ * @max_sleep_timeout: upper bound of adaptive interval (0 - fixed interval)
+ * @worker_class: priority class of worker (applied by start)
+ * @worker_budget: worker's CPU time in microseconds per second (0 - no limit)
+ * @hint_ring_depth: capacity of recommendations ring (0 - default)
+ * @hint_cache_entries: capacity of recommendations cache (0 - no cache)
+ * @hint_cache_ttl: lifetime of cached recommendation (milliseconds, 0 - infinite)
+ * @governor_interval: interval of mode governor (milliseconds, 0 - no governor)
+ * @promote_efficiency: efficiency that promotes ML model (percent, 0 - default)
+ * @demote_efficiency: efficiency that demotes ML model (percent, 0 - default)
+ * @promote_intervals: number of won intervals before promotion (0 - default)
+ * @max_decision_latency: max average latency of decision (nanoseconds, 0 - no limit)
+ * @hedge_agents: number of agents that receive one request (0 - default)
+ * @dataset_queue_depth: number of datasets that can wait for consumer
+ * @stream_chunk_size: max portion size of one extraction (0 - no limit)
+ * @compression: compression algorithm of published datasets
+ * @ring_slots: number of slots in dataset ring (0 - no ring)
+ * @ring_portion_size: payload capacity of one slot of dataset ring
+ * @size: number of bytes in allocated object
+ * @rcu: deferred freeing of replaced options
  *
  * These options define behavior of ML model.
  * The options can be defined during init() or re-init() call.
+ * The @dataset_queue_depth, @hint_ring_depth, @hint_cache_entries,
+ * @ring_slots and @ring_portion_size are applied by init() call only.
+ * The ring's @ring_portion_size can be tens of megabytes because
+ * the ring is backed by the array of pages.
+ *
+ * If @max_sleep_timeout is bigger than @min_sleep_timeout, then
+ * the worker adapts the interval of its cycles within these bounds
+ * by the rate of published data and the consumer's lag.
+ * The @sleep_timeout is the initial interval in this case.
+ *
+ * If @governor_interval is defined, then the governor compares
+ * the efficiency of ML model with default algorithm(s) every
+ * interval between start() and stop() calls. The model is promoted
+ * from LEARNING through COLLABORATION to RECOMMENDATION mode after
+ * @promote_intervals consecutive intervals with the efficiency
+ * of @promote_efficiency or better. The model falls into EMERGENCY
+ * mode at the first interval with the efficiency lower than
+ * @demote_efficiency or the decision latency above
+ * @max_decision_latency. The gap between the thresholds is
+ * the hysteresis that prevents the oscillation of the mode.
  */
 struct ml_lib_model_options {
 	u32 sleep_timeout;
+	u32 min_sleep_timeout;
+	u32 max_sleep_timeout;
+	u32 worker_class;
+	u32 worker_budget;
+	u32 hint_ring_depth;
+	u32 hint_cache_entries;
+	u32 hint_cache_ttl;
+	u32 governor_interval;
+	u32 promote_efficiency;
+	u32 demote_efficiency;
+	u32 promote_intervals;
+	u32 max_decision_latency;
+	u32 hedge_agents;
+	u32 dataset_queue_depth;
+	u32 stream_chunk_size;
+	u32 compression;
+	u32 ring_slots;
+	u32 ring_portion_size;
+
+	size_t size;
+	struct rcu_head rcu;
 };
 
 /*
  * struct ml_lib_model_run_config - ML model run config
- * @sleep_timeout: main thread's sleep timeout
+ * @sleep_timeout: interval of worker's cycles (milliseconds, 0 - no change)
  *
  * The run config is used for correction of ML model options
  * by means of start/stop methods pair.
@@ -124,16 +256,73 @@ struct ml_lib_subsystem_state_operations {
  * @type: object type
  * @state: object state
  * @allocated_size: number of bytes in allocated object
+ * @desc_size: number of bytes in allocated descriptor
  * @portion_offset: portion offset in the data stream
  * @portion_size: extracted portion size
+ * @portion_limit: max portion size that extract method can produce
+ * @compression: compression algorithm of the payload
+ * @raw_size: portion size before compression
+ * @preprocessed: payload consists of preprocessed records
+ * @slot_seq: sequence number of the ring's slot (0 - not published)
+ * @payload: portion's payload (ML_LIB_MEMORY_STREAM_DATASET)
+ * @owner: ML model that reclaims the dataset
+ * @rcu: deferred reclamation of discarded dataset
+ * @reclaim_node: node in the ML model's reclamation list
+ *
+ * If ML model owns a dataset ring, then @payload points on
+ * the reserved slot of the ring and @allocated_size defines
+ * the slot's capacity. The extract method can store the portion
+ * directly into the slot and user-space can access it without
+ * any copy.
+ *
+ * The datasets are extracted incrementally. ML library defines
+ * @portion_offset by current position of the model's stream cursor
+ * and @portion_limit by the chunk size and slot's capacity before
+ * the extract method call. The extract method produces the next
+ * portion of no more than @portion_limit bytes and sets the state
+ * ML_LIB_DATASET_EXTRACTED_PARTIALLY, if the stream has more data,
+ * or ML_LIB_DATASET_EXTRACTED_COMPLETELY, if the portion is the last
+ * one. The stream cursor is advanced by @portion_size, or it is
+ * rewound at the beginning of the stream after the last portion.
  */
 struct ml_lib_dataset {
 	atomic_t type;
 	atomic_t state;
 	size_t allocated_size;
+	size_t desc_size;
+
+	u64 portion_offset;
+	u32 portion_size;
+	u32 portion_limit;
+
+	u32 compression;
+	u32 raw_size;
+	bool preprocessed;
 
+	u64 slot_seq;
+	void *payload;
+
+	struct ml_lib_model *owner;
+	struct rcu_head rcu;
+	struct llist_node reclaim_node;
+};
+
+/*
+ * struct ml_lib_dataset_info - dataset's descriptor for BPF programs
+ * @portion_offset: portion offset in the data stream
+ * @slot_seq: sequence number of the ring's slot (0 - not published)
+ * @type: dataset type
+ * @portion_size: size of the payload
+ * @compression: compression algorithm of the payload
+ * @raw_size: portion size before compression
+ */
+struct ml_lib_dataset_info {
 	u64 portion_offset;
+	u64 slot_seq;
+	u32 type;
 	u32 portion_size;
+	u32 compression;
+	u32 raw_size;
 };
 
 enum {
@@ -157,6 +346,289 @@ enum {
 	ML_LIB_DATASET_STATE_MAX
 };
 
+/*
+ * Feature transformations of preprocessing stage:
+ * (1) DROP - exclude the feature from the output record.
+ * (2) RAW - copy the value (saturated by output width).
+ * (3) NORMALIZE - fixed-point normalization:
+ *                 ((value - offset) * scale) >> shift,
+ *                 saturated by output width (int8/int16/int32/int64).
+ * (4) LOG2_BUCKET - index of logarithmic bucket:
+ *                   fls64(value - offset), limited by @nr_buckets - 1.
+ * (5) LINEAR_BUCKET - normalized value limited by [0, @nr_buckets - 1].
+ * (6) HASH - hash of value (kernel object ID: inode, LBA, pid)
+ *            into [0, @nr_buckets).
+ */
+enum {
+	ML_LIB_FEATURE_DROP,
+	ML_LIB_FEATURE_RAW,
+	ML_LIB_FEATURE_NORMALIZE,
+	ML_LIB_FEATURE_LOG2_BUCKET,
+	ML_LIB_FEATURE_LINEAR_BUCKET,
+	ML_LIB_FEATURE_HASH,
+	ML_LIB_FEATURE_TRANSFORM_MAX
+};
+
+/*
+ * struct ml_lib_feature_desc - feature preprocessing descriptor
+ * @transform: feature transformation (ML_LIB_FEATURE_*)
+ * @width: output width in bytes (1, 2, 4 or 8)
+ * @offset: subtracted from the value before transformation
+ * @scale: fixed-point multiplier of normalization
+ * @shift: fixed-point shift of normalization
+ * @nr_buckets: number of buckets (or hash dimensions)
+ * @seed: seed of feature hashing
+ */
+struct ml_lib_feature_desc {
+	u32 transform;
+	u32 width;
+	s64 offset;
+	u32 scale;
+	u32 shift;
+	u32 nr_buckets;
+	u32 seed;
+};
+
+/* log2 buckets of 64-bit value: fls64() is in [0, 64] */
+#define ML_LIB_HISTOGRAM_BUCKETS	(BITS_PER_LONG_LONG + 1)
+
+/*
+ * struct ml_lib_preprocess_config - preprocessing configuration
+ * @nr_features: number of features in one input record
+ * @in_record_size: size of input record in bytes (calculated)
+ * @out_record_size: size of output record in bytes (calculated)
+ * @rcu: deferred freeing of replaced configuration
+ * @ref: references of ML model and running preprocessing
+ * @aggregate_lock: protects the aggregates of input records
+ * @nr_records: number of aggregated input records
+ * @sum: per-feature sums of input values
+ * @min: per-feature minimums of input values
+ * @max: per-feature maximums of input values
+ * @histogram: per-feature log2 histograms of input values
+ * @features: descriptors of features
+ *
+ * The input record is an array of @nr_features 64-bit values.
+ * The output record packs the transformed features by their
+ * widths. The output is never bigger than the input, so the
+ * dataset's payload is transformed in place.
+ *
+ * The input records are aggregated before the transformation.
+ * The aggregates are allocated together with the configuration,
+ * so they are reset by the replacement of configuration.
+ */
+struct ml_lib_preprocess_config {
+	u32 nr_features;
+	u32 in_record_size;
+	u32 out_record_size;
+
+	struct rcu_head rcu;
+	struct kref ref;
+
+	spinlock_t aggregate_lock;
+	u64 nr_records;
+	s64 *sum;
+	s64 *min;
+	s64 *max;
+	u64 *histogram;
+
+	struct ml_lib_feature_desc features[];
+};
+
+/*
+ * Tree ensemble image of in-kernel evaluator:
+ * (1) struct ml_lib_tree_ensemble_header;
+ * (2) u32 roots[nr_trees] - index of every tree's root node;
+ * (3) struct ml_lib_tree_node nodes[nr_nodes].
+ *
+ * Nodes of every tree are stored in pre-order: the left child
+ * of split node is the next node, the right child is defined
+ * by its index. Nodes of a tree occupy the range from its root
+ * till the root of the next tree. The decision value is:
+ * base_score + sum of leaf values (integer fixed-point).
+ */
+#define ML_LIB_TREE_ENSEMBLE_MAGIC	0x4d4c5445	/* MLTE */
+#define ML_LIB_TREE_ENSEMBLE_VERSION	(1)
+#define ML_LIB_TREE_NODES_MAX		(1U << 20)
+#define ML_LIB_TREE_LEAF		U16_MAX
+
+/*
+ * struct ml_lib_tree_ensemble_header - header of tree ensemble image
+ * @magic: ML_LIB_TREE_ENSEMBLE_MAGIC
+ * @version: ML_LIB_TREE_ENSEMBLE_VERSION
+ * @nr_features: number of features in decision's feature vector
+ * @nr_trees: number of trees
+ * @nr_nodes: number of nodes of all trees
+ * @reserved: reserved (should be zero)
+ * @base_score: initial decision value
+ */
+struct ml_lib_tree_ensemble_header {
+	u32 magic;
+	u32 version;
+	u32 nr_features;
+	u32 nr_trees;
+	u32 nr_nodes;
+	u32 reserved;
+	s64 base_score;
+};
+
+/*
+ * struct ml_lib_tree_node - node of flattened tree
+ * @value: split threshold (feature <= @value goes left) or leaf value
+ * @feature: index of split feature or ML_LIB_TREE_LEAF
+ * @reserved: reserved (should be zero)
+ * @right: index of right child (split node only)
+ */
+struct ml_lib_tree_node {
+	s64 value;
+	u16 feature;
+	u16 reserved;
+	u32 right;
+};
+
+/*
+ * Quantized MLP image of in-kernel inference:
+ * (1) struct ml_lib_mlp_header;
+ * (2) struct ml_lib_mlp_layer_desc layers[nr_layers];
+ * (3) parameters of every layer:
+ *     s32 bias[out_size], s8 weights[out_size][in_size].
+ *
+ * Every layer calculates int32 accumulators:
+ * acc[o] = bias[o] + sum(weights[o][i] * x[i]).
+ * The hidden layer's output is int8:
+ * x'[o] = clamp(activation(acc[o]) >> shift, -128, 127).
+ * The last layer's output is int32: activation(acc[o]).
+ */
+#define ML_LIB_MLP_MAGIC		0x4d4c4d50	/* MLMP */
+#define ML_LIB_MLP_VERSION		(1)
+#define ML_LIB_MLP_LAYERS_MAX		(8)
+#define ML_LIB_MLP_WIDTH_MAX		(1024)
+
+enum {
+	ML_LIB_MLP_ACTIVATION_NONE,
+	ML_LIB_MLP_ACTIVATION_RELU,
+	ML_LIB_MLP_ACTIVATION_MAX
+};
+
+/*
+ * struct ml_lib_mlp_header - header of MLP image
+ * @magic: ML_LIB_MLP_MAGIC
+ * @version: ML_LIB_MLP_VERSION
+ * @nr_layers: number of layers
+ * @input_shift: quantization of 64-bit features: clamp(value >> shift)
+ */
+struct ml_lib_mlp_header {
+	u32 magic;
+	u32 version;
+	u32 nr_layers;
+	u32 input_shift;
+};
+
+/*
+ * struct ml_lib_mlp_layer_desc - descriptor of MLP layer
+ * @in_size: number of inputs
+ * @out_size: number of outputs
+ * @activation: activation function (ML_LIB_MLP_ACTIVATION_*)
+ * @shift: requantization shift of hidden layer's accumulators
+ */
+struct ml_lib_mlp_layer_desc {
+	u32 in_size;
+	u32 out_size;
+	u32 activation;
+	u32 shift;
+};
+
+/*
+ * Versioned model blob:
+ * (1) struct ml_lib_model_blob_header;
+ * (2) payload - image of in-kernel model of @type
+ *     (tree ensemble image or MLP image).
+ */
+#define ML_LIB_MODEL_BLOB_MAGIC		0x4d4c4d42	/* MLMB */
+#define ML_LIB_MODEL_BLOB_FORMAT	(1)
+#define ML_LIB_MODEL_BLOB_SIZE_MAX	(64 * 1024 * 1024)
+
+enum {
+	ML_LIB_MODEL_BLOB_UNKNOWN,
+	ML_LIB_MODEL_BLOB_TREE_ENSEMBLE,
+	ML_LIB_MODEL_BLOB_MLP,
+	ML_LIB_MODEL_BLOB_TYPE_MAX
+};
+
+/*
+ * struct ml_lib_model_blob_header - header of model blob
+ * @magic: ML_LIB_MODEL_BLOB_MAGIC
+ * @format: ML_LIB_MODEL_BLOB_FORMAT
+ * @type: type of payload (ML_LIB_MODEL_BLOB_*)
+ * @reserved: reserved (should be zero)
+ * @version: model version (should grow with every upload)
+ * @payload_size: size of payload in bytes
+ * @checksum: crc32_le(~0, payload, payload_size)
+ */
+struct ml_lib_model_blob_header {
+	u32 magic;
+	u32 format;
+	u32 type;
+	u32 reserved;
+	u64 version;
+	u32 payload_size;
+	u32 checksum;
+};
+
+/*
+ * struct ml_lib_dataset_ring_ctrl - dataset ring's control page
+ * @nr_slots: number of slots in the ring
+ * @slot_size: size of one slot in bytes (header + payload)
+ * @data_offset: offset of the first slot from the beginning of mapping
+ * @head: index of the next slot that will be published
+ * @tail: index of the oldest slot that can be still valid
+ *
+ * The dataset ring is mapped into user-space as read-only area:
+ * the control page is followed by @nr_slots slots of @slot_size.
+ * Slot with index I lives at @data_offset + (I % @nr_slots) * @slot_size.
+ * The producer never waits for user-space: the oldest slot
+ * is overwritten if the ring is full. User-space keeps its own
+ * read index and resynchronizes with @tail if it lags behind.
+ */
+struct ml_lib_dataset_ring_ctrl {
+	u32 nr_slots;
+	u32 slot_size;
+	u32 data_offset;
+	u32 reserved;
+	u64 head;
+	u64 tail;
+};
+
+/*
+ * struct ml_lib_dataset_slot - dataset ring's slot header
+ * @seq: index of published slot plus one (zero if slot is invalid)
+ * @portion_offset: portion offset in the data stream
+ * @portion_size: number of valid bytes in the payload
+ * @type: dataset type
+ * @compression: compression algorithm of the payload
+ * @raw_size: portion size before compression
+ *
+ * The payload follows the header. If @compression isn't
+ * ML_LIB_NO_COMPRESSION, then @portion_size bytes of the payload
+ * should be decompressed into @raw_size bytes. User-space should read @seq
+ * before and after the payload access. The payload is consistent
+ * only if @seq is equal to I + 1 in both cases.
+ */
+struct ml_lib_dataset_slot {
+	u64 seq;
+	u64 portion_offset;
+	u32 portion_size;
+	u32 type;
+	u32 compression;
+	u32 raw_size;
+};
+
+struct ml_lib_dataset_ring;
+struct ml_lib_dataset_queue;
+struct ml_lib_samples;
+struct ml_lib_compressor;
+struct ml_lib_hint_ring;
+struct ml_lib_hint_cache;
+
 struct ml_lib_dataset_operations {
 	void *(*allocate)(size_t size, gfp_t gfp);
 	void (*free)(struct ml_lib_dataset *dataset);
@@ -202,9 +674,27 @@ struct ml_lib_request_config_operations {
 	int (*destroy)(struct ml_lib_request_config *config);
 };
 
+/*
+ * struct ml_lib_user_space_request - request of decision
+ * @id: identification of request
+ * @nr_features: number of features in @features
+ * @features: feature vector of decision
+ */
 struct ml_lib_user_space_request {
+	u64 id;
+	u32 nr_features;
+	const s64 *features;
 };
 
+/* ml_model_decide() assigns the ids with this bit to its requests */
+#define ML_LIB_DECISION_REQUEST_ID	(1ULL << 63)
+
+/*
+ * request of efficiency estimation by mode governor
+ * (outside of the decisions' ids and of U64_MAX marker of free slot)
+ */
+#define ML_LIB_GOVERNOR_REQUEST_ID	(ML_LIB_DECISION_REQUEST_ID - 1)
+
 struct ml_lib_user_space_request_operations {
 	int (*operation)(struct ml_lib_model *ml_model,
 			 struct ml_lib_user_space_request *request);
@@ -218,7 +708,20 @@ struct ml_lib_user_space_notification_operations {
 			 struct ml_lib_user_space_notification *notify);
 };
 
+/*
+ * struct ml_lib_user_space_recommendation - ML model's recommendation
+ * @type: recommendation type (defined by kernel subsystem)
+ * @flags: recommendation flags (defined by kernel subsystem)
+ * @request_id: identification of request the recommendation relates to
+ * @value: recommended value
+ * @payload: subsystem specific data
+ */
 struct ml_lib_user_space_recommendation {
+	u32 type;
+	u32 flags;
+	u64 request_id;
+	s64 value;
+	u8 payload[40];
 };
 
 struct ml_lib_user_space_recommendation_operations {
@@ -226,7 +729,64 @@ struct ml_lib_user_space_recommendation_operations {
 			 struct ml_lib_user_space_recommendation *hint);
 };
 
+/*
+ * struct ml_lib_backpropagation_feedback - feedback for ML model
+ * @type: feedback type (defined by kernel subsystem)
+ * @flags: feedback flags (defined by kernel subsystem)
+ * @request_id: identification of request the feedback relates to
+ * @error: error of recommended value
+ * @reserved: reserved for future use
+ */
 struct ml_lib_backpropagation_feedback {
+	u32 type;
+	u32 flags;
+	u64 request_id;
+	s64 error;
+	u64 reserved;
+};
+
+/*
+ * io_uring commands (struct io_uring_cmd::cmd_op)
+ *
+ * (1) FETCH_DATASET - copy the oldest dataset's payload
+ *                     into the buffer and discard the dataset.
+ * (2) APPLY_RECOMMENDATION - submit the array of
+ *                            struct ml_lib_user_space_recommendation
+ *                            into the recommendations ring.
+ * (3) SEND_FEEDBACK - deliver the array of
+ *                     struct ml_lib_backpropagation_feedback.
+ */
+enum {
+	ML_LIB_URING_CMD_FETCH_DATASET = 1,
+	ML_LIB_URING_CMD_APPLY_RECOMMENDATION,
+	ML_LIB_URING_CMD_SEND_FEEDBACK,
+	ML_LIB_URING_CMD_MAX
+};
+
+/* FETCH_DATASET flags */
+#define ML_LIB_URING_FETCH_PREPARE	(1 << 0)
+#define ML_LIB_URING_FETCH_KEEP		(1 << 1)
+#define ML_LIB_URING_FETCH_FLAGS	(ML_LIB_URING_FETCH_PREPARE | \
+					 ML_LIB_URING_FETCH_KEEP)
+
+/* max number of records in one io_uring command */
+#define ML_LIB_URING_BATCH_MAX		(4096)
+
+/*
+ * struct ml_lib_uring_cmd - io_uring command's payload (SQE's cmd area)
+ * @addr: user-space address of the buffer or array of records
+ * @len: buffer size in bytes (FETCH_DATASET) or number of records
+ * @flags: command flags
+ *
+ * The CQE's result is the number of fetched bytes or processed
+ * records, or negative error code. FETCH_DATASET fails with -EMSGSIZE
+ * if the buffer is smaller than the dataset; the required size is
+ * reported in the big CQE's extra field (IORING_SETUP_CQE32).
+ */
+struct ml_lib_uring_cmd {
+	u64 addr;
+	u32 len;
+	u32 flags;
 };
 
 struct ml_lib_backpropagation_operations {
@@ -245,6 +805,7 @@ struct ml_lib_backpropagation_operations {
  * @get_system_state: specialized method of getting subsystem state
  * @get_dataset: specialized method of getting a dataset
  * @preprocess_data: specialized method of data preprocessing
+ * @compress_data: specialized method of data compression
  * @publish_data: specialized method of sharing data with user-space
  * @preprocess_recommendation: specialized method of preprocess recomendations
  * @estimate_system_state: specialized method of system state estimation
@@ -253,6 +814,28 @@ struct ml_lib_backpropagation_operations {
  * @estimate_efficiency: specialized method of operation efficiency estimation
  * @error_backpropagation: specialized method of error backpropagation
  * @correct_system_state: specialized method of subsystem state correction
+ * @default_operation: decision of subsystem's default algorithm(s)
+ *
+ * The @execute_operation returns -EINPROGRESS if it has sent
+ * the request to user-space agent. Then ml_model_decide() waits
+ * for the recommendation with the request's id.
+ *
+ * The @estimate_efficiency is called in two contexts:
+ * (1) the mode governor calls it with the request of
+ *     ML_LIB_GOVERNOR_REQUEST_ID that has no features. The method
+ *     returns the efficiency of ML-driven results during the last
+ *     interval in percent of the default algorithm's efficiency
+ *     (100 - equal efficiency) or -ENODATA if nothing has been
+ *     measured;
+ * (2) every answer of shadow agent is scored by the call with
+ *     the answer as @hint and the request of ml_model_decide()
+ *     (the id has ML_LIB_DECISION_REQUEST_ID bit and the features
+ *     are the copy of the answered request's ones, if any).
+ *     The method returns the efficiency of this answer in percent
+ *     of the default algorithm's decision for the same features
+ *     or -ENODATA if it cannot be estimated. The call can sleep
+ *     and it must not consume the statistics of the interval
+ *     that are reserved for the governor.
  */
 struct ml_lib_model_operations {
 	int (*create)(struct ml_lib_model *ml_model);
@@ -270,6 +853,8 @@ struct ml_lib_model_operations {
 			   struct ml_lib_dataset *dataset);
 	int (*preprocess_data)(struct ml_lib_model *ml_model,
 				struct ml_lib_dataset *dataset);
+	int (*compress_data)(struct ml_lib_model *ml_model,
+			     struct ml_lib_dataset *dataset);
 	int (*publish_data)(struct ml_lib_model *ml_model,
 			    struct ml_lib_dataset *dataset,
 			    struct ml_lib_user_space_notification *notify);
@@ -288,6 +873,185 @@ struct ml_lib_model_operations {
 			    struct ml_lib_backpropagation_feedback *feedback,
 			    struct ml_lib_user_space_notification *notify);
 	int (*correct_system_state)(struct ml_lib_model *ml_model);
+	int (*default_operation)(struct ml_lib_model *ml_model,
+			    struct ml_lib_user_space_recommendation *hint,
+			    struct ml_lib_user_space_request *request);
+};
+
+/*
+ * struct ml_lib_cadence - adaptive interval of worker's cycles
+ * @interval: current interval in milliseconds (0 - worker is stopped)
+ * @last_bytes: number of published bytes at the previous cycle
+ * @rate: moving average of publishing rate (bytes per second)
+ */
+struct ml_lib_cadence {
+	u32 interval;
+	u64 last_bytes;
+	u64 rate;
+};
+
+/*
+ * struct ml_lib_governor - state of ML model's mode governor
+ * @interval: interval of evaluations in milliseconds (0 - governor is stopped)
+ * @wins: number of consecutive intervals won by ML model
+ * @efficiency: efficiency of the last interval (percent, negative - no data)
+ * @latency_ns: average decision latency of the last interval
+ * @last_decisions: number of decisions at the previous evaluation
+ * @last_decision_ns: total latency of decisions at the previous evaluation
+ * @promotions: number of promotions by governor
+ * @demotions: number of demotions by governor
+ */
+struct ml_lib_governor {
+	u32 interval;
+	u32 wins;
+	int efficiency;
+	u64 latency_ns;
+	u64 last_decisions;
+	u64 last_decision_ns;
+	u64 promotions;
+	u64 demotions;
+};
+
+/*
+ * struct ml_lib_decision_stats - answers of ml_model_decide()
+ * @cached: number of answers by cached recommendation
+ * @model: number of answers by execute_operation()
+ * @agent: number of answers by user-space agent
+ * @fallback: number of answers by default algorithm(s)
+ * @timeouts: number of requests that exhausted latency budget
+ * @late: number of dropped answers of finished requests
+ */
+struct ml_lib_decision_stats {
+	atomic64_t cached;
+	atomic64_t model;
+	atomic64_t agent;
+	atomic64_t fallback;
+	atomic64_t timeouts;
+	atomic64_t late;
+};
+
+/* the answers of shadow agent are scored but never applied */
+#define ML_LIB_AGENT_SHADOW		(1U << 0)
+
+#define ML_LIB_AGENT_INFLIGHT_MAX	(256)
+
+struct ml_lib_agent;
+
+/*
+ * struct ml_lib_agent_operations - user-space agent operations
+ * @send_request: deliver the request of decision to agent
+ * @cancel_request: the request has been answered by another agent
+ *
+ * The methods are called by ml_model_decide() and they cannot sleep.
+ */
+struct ml_lib_agent_operations {
+	int (*send_request)(struct ml_lib_agent *agent,
+			    struct ml_lib_user_space_request *request);
+	void (*cancel_request)(struct ml_lib_agent *agent, u64 request_id);
+};
+
+/*
+ * struct ml_lib_agent_stats - statistics of user-space agent
+ * @requests: number of sent requests
+ * @answers: number of received answers
+ * @wins: number of answers that have been used
+ * @late: number of answers after cancellation or timeout
+ * @cancelled: number of cancelled requests
+ * @latency_ns: total latency of answers
+ * @max_latency_ns: max latency of answer
+ * @score: total efficiency of shadow agent's answers (percent)
+ * @scored: number of scored answers of shadow agent
+ */
+struct ml_lib_agent_stats {
+	atomic64_t requests;
+	atomic64_t answers;
+	atomic64_t wins;
+	atomic64_t late;
+	atomic64_t cancelled;
+	atomic64_t latency_ns;
+	atomic64_t max_latency_ns;
+	atomic64_t score;
+	atomic64_t scored;
+};
+
+/*
+ * struct ml_lib_agent_inflight - request that has been sent to agent
+ * @request_id: identification of request
+ * @start_ns: time of sending (0 - the answer has been received)
+ * @nr_features: number of features in @features
+ * @features: copy of request's features (shadow agent only)
+ */
+struct ml_lib_agent_inflight {
+	u64 request_id;
+	u64 start_ns;
+	u32 nr_features;
+	s64 *features;
+};
+
+/*
+ * struct ml_lib_agent - user-space agent of ML model
+ * @name: name of agent
+ * @flags: agent's flags (ML_LIB_AGENT_*)
+ * @ops: agent operations
+ * @private: agent's private data
+ * @node: entry in the list of ML model's agents
+ * @ml_model: ML model that the agent is attached to
+ * @stats: agent's statistics
+ * @lock: inflight requests' lock
+ * @inflight: recently sent requests (indexed by request id)
+ *
+ * The kernel subsystem defines @name, @flags, @ops and @private
+ * (for example, for every opened file of user-space agent)
+ * and attaches the agent by ml_model_attach_agent().
+ */
+struct ml_lib_agent {
+	const char *name;
+	u32 flags;
+	const struct ml_lib_agent_operations *ops;
+	void *private;
+
+	struct list_head node;
+	struct ml_lib_model *ml_model;
+	struct ml_lib_agent_stats stats;
+	spinlock_t lock;
+	struct ml_lib_agent_inflight inflight[ML_LIB_AGENT_INFLIGHT_MAX];
+};
+
+/*
+ * struct ml_lib_worker_stats - overhead of worker's cycles
+ * @cycles: number of executed cycles
+ * @runtime_ns: total duration of executed cycles
+ * @throttled: number of cycles delayed by CPU-time budget
+ */
+struct ml_lib_worker_stats {
+	u64 cycles;
+	u64 runtime_ns;
+	u64 throttled;
+};
+
+#define ML_LIB_BPF_OPS_NAME_LEN		(32)
+
+/*
+ * struct ml_lib_bpf_ops - ML model operations implemented by BPF
+ * @estimate_system_state: BPF method of system state estimation
+ * @apply_recommendation: BPF method of recommendations applying
+ * @estimate_efficiency: BPF method of operation efficiency estimation
+ * @subsystem_name: name of subsystem of the ML model
+ * @model_name: name of the ML model
+ *
+ * The BPF struct_ops map of this type is attached to the ML model
+ * with @subsystem_name and @model_name. The defined methods have
+ * priority over the same methods of struct ml_lib_model_operations.
+ */
+struct ml_lib_bpf_ops {
+	int (*estimate_system_state)(struct ml_lib_model *ml_model);
+	int (*apply_recommendation)(struct ml_lib_model *ml_model,
+			    struct ml_lib_user_space_recommendation *hint);
+	int (*estimate_efficiency)(struct ml_lib_model *ml_model,
+			    struct ml_lib_user_space_recommendation *hint,
+			    struct ml_lib_user_space_request *request);
+	char subsystem_name[ML_LIB_BPF_OPS_NAME_LEN];
+	char model_name[ML_LIB_BPF_OPS_NAME_LEN];
 };
 
 /*
@@ -299,10 +1063,49 @@ struct ml_lib_model_operations {
  * @parent: parent kernel subsystem
  * @parent_state: parent kernel subsystem's state
  * @options: ML model options
+ * @datasets: queue of extracted datasets
+ * @dataset_wq: waiters for published datasets
+ * @dataset_pool: preallocated dataset descriptors
+ * @dataset_pool_size: number of descriptors in the pool
+ * @free_datasets: queue of free descriptors of the pool
+ * @fetch_lock: serializes the consumers that discard datasets
+ * @stream_lock: serializes the extraction of stream's portions
+ * @stream_cursor: offset of the next portion in the data stream
+ * @preprocess_config: configuration of preprocessing stage
+ * @compress_lock: protects the compressor
+ * @compressor: compressor of published datasets
+ * @uncompressed_bytes: number of bytes before compression
+ * @compressed_bytes: number of bytes after compression
+ * @published_bytes: number of bytes of published datasets
+ * @tree_ensemble: in-kernel evaluator of decisions
+ * @mlp: in-kernel quantized MLP
+ * @upload_lock: serializes the loading of model blobs
+ * @upload_buf: buffer of partially uploaded model blob
+ * @upload_size: size of uploaded model blob
+ * @upload_received: number of received bytes of model blob
+ * @model_version: version of the last loaded model blob
+ * @bpf_ops: attached BPF implementation of ML model operations
+ * @registry_node: ML model in the registry of ML models
  * @model_ops: ML model specialized operations
  * @system_state_ops: subsystem state specialized operations
  * @dataset_ops: dataset specialized operations
  * @request_config_ops: specialized dataset configuration operations
+ * @ring: mmap'able ring of published datasets
+ * @samples: per-CPU buffers of recorded samples
+ * @reclaim_list: discarded datasets after RCU grace period
+ * @reclaim_work: releases discarded datasets in process context
+ * @worker_lock: serializes start and stop of the worker
+ * @worker_active: the worker's cycles are re-queued
+ * @worker: periodic cycle of started ML model
+ * @worker_class: priority class of started worker
+ * @numa_node: NUMA node of the worker (NUMA_NO_NODE - any node)
+ * @cadence: adaptive interval of worker's cycles
+ * @worker_stats: overhead of worker's cycles
+ * @hints: ring of submitted recommendations
+ * @hint_work: applies the batches of submitted recommendations
+ * @agents_lock: serializes attaching and detaching of agents
+ * @agents: attached user-space agents (RCU list)
+ * @agent_cursor: round-robin selection of hedged agents
  * @kobj: /sys/<subsystem>/<ml_model>/ ML model object
  * @kobj_unregister: completion state for <ml_model> kernel object
  */
@@ -320,14 +1123,75 @@ struct ml_lib_model {
 	spinlock_t options_lock;
 	struct ml_lib_model_options * __rcu options;
 
-	spinlock_t dataset_lock;
-	struct ml_lib_dataset * __rcu dataset;
+	struct ml_lib_dataset_queue *datasets;
+	wait_queue_head_t dataset_wq;
+	struct ml_lib_dataset *dataset_pool;
+	u32 dataset_pool_size;
+	struct ml_lib_dataset_queue *free_datasets;
+	struct mutex fetch_lock;
+
+	struct mutex stream_lock;
+	u64 stream_cursor;
+
+	struct ml_lib_preprocess_config * __rcu preprocess_config;
+
+	struct mutex compress_lock;
+	struct ml_lib_compressor *compressor;
+	atomic64_t uncompressed_bytes;
+	atomic64_t compressed_bytes;
+	atomic64_t published_bytes;
+
+	struct ml_lib_tree_ensemble * __rcu tree_ensemble;
+	struct ml_lib_mlp * __rcu mlp;
+
+	struct mutex upload_lock;
+	void *upload_buf;
+	size_t upload_size;
+	size_t upload_received;
+	u64 model_version;
+
+	struct ml_lib_bpf_ops * __rcu bpf_ops;
+	struct list_head registry_node;
 
 	struct ml_lib_model_operations *model_ops;
 	struct ml_lib_subsystem_state_operations *system_state_ops;
 	struct ml_lib_dataset_operations *dataset_ops;
 	struct ml_lib_request_config_operations *request_config_ops;
 
+	struct ml_lib_dataset_ring *ring;
+	struct ml_lib_samples *samples;
+
+	struct llist_head reclaim_list;
+	struct work_struct reclaim_work;
+
+	struct mutex worker_lock;
+	bool worker_active;
+	struct delayed_work worker;
+	u32 worker_class;
+	int numa_node;
+	struct ml_lib_cadence cadence;
+	struct ml_lib_worker_stats worker_stats;
+
+	atomic64_t decisions;
+	atomic64_t decision_ns;
+	struct delayed_work governor_work;
+	struct ml_lib_governor governor;
+
+	spinlock_t decision_lock;
+	struct list_head decision_waiters;
+	atomic_t nr_decision_waiters;
+	wait_queue_head_t decision_wq;
+	struct ml_lib_decision_stats decision_stats;
+	atomic64_t decision_seq;
+
+	spinlock_t agents_lock;
+	struct list_head agents;
+	atomic_t agent_cursor;
+
+	struct ml_lib_hint_ring *hints;
+	struct work_struct hint_work;
+	struct ml_lib_hint_cache *hint_cache;
+
 	/* /sys/<subsystem>/<ml_model>/ */
 	struct kobject kobj;
 	struct completion kobj_unregister;
@@ -359,25 +1223,52 @@ int ml_model_re_init(struct ml_lib_model *ml_model,
 int ml_model_start(struct ml_lib_model *ml_model,
 		   struct ml_lib_model_run_config *config);
 int ml_model_stop(struct ml_lib_model *ml_model);
+int ml_model_set_numa_node(struct ml_lib_model *ml_model, int node);
+int ml_model_set_mode(struct ml_lib_model *ml_model, int mode);
 void ml_model_destroy(struct ml_lib_model *ml_model);
 struct ml_lib_subsystem_state *get_system_state(struct ml_lib_model *ml_model);
 int ml_model_get_dataset(struct ml_lib_model *ml_model,
 			 struct ml_lib_request_config *config,
 			 struct ml_lib_user_space_request *request);
 int ml_model_discard_dataset(struct ml_lib_model *ml_model);
+struct ml_lib_dataset *ml_model_peek_dataset(struct ml_lib_model *ml_model);
+__poll_t ml_model_poll(struct ml_lib_model *ml_model, struct file *file,
+			struct poll_table_struct *wait);
 int ml_model_preprocess_data(struct ml_lib_model *ml_model,
 			     struct ml_lib_dataset *dataset);
+int ml_model_compress_data(struct ml_lib_model *ml_model,
+			   struct ml_lib_dataset *dataset);
 int ml_model_publish_data(struct ml_lib_model *ml_model,
 			  struct ml_lib_dataset *dataset,
 			  struct ml_lib_user_space_notification *notify);
 int ml_model_preprocess_recommendation(struct ml_lib_model *ml_model,
 			 struct ml_lib_user_space_recommendation *hint);
+int ml_model_submit_recommendation(struct ml_lib_model *ml_model,
+			const struct ml_lib_user_space_recommendation *hint);
+u64 ml_model_state_signature(struct ml_lib_model *ml_model,
+			     const void *state, size_t size);
+int ml_model_lookup_recommendation(struct ml_lib_model *ml_model,
+				u64 signature,
+				struct ml_lib_user_space_recommendation *hint);
+int ml_model_cache_recommendation(struct ml_lib_model *ml_model,
+			u64 signature,
+			const struct ml_lib_user_space_recommendation *hint);
+void ml_model_invalidate_recommendations(struct ml_lib_model *ml_model);
 int estimate_system_state(struct ml_lib_model *ml_model);
 int apply_ml_model_recommendation(struct ml_lib_model *ml_model,
 			 struct ml_lib_user_space_recommendation *hint);
 int execute_ml_model_operation(struct ml_lib_model *ml_model,
 			 struct ml_lib_user_space_recommendation *hint,
 			 struct ml_lib_user_space_request *request);
+int ml_model_decide(struct ml_lib_model *ml_model,
+		    struct ml_lib_user_space_recommendation *hint,
+		    struct ml_lib_user_space_request *request,
+		    u64 budget_ns);
+int ml_model_attach_agent(struct ml_lib_model *ml_model,
+			  struct ml_lib_agent *agent);
+void ml_model_detach_agent(struct ml_lib_agent *agent);
+int ml_model_submit_agent_recommendation(struct ml_lib_agent *agent,
+			const struct ml_lib_user_space_recommendation *hint);
 int estimate_ml_model_efficiency(struct ml_lib_model *ml_model,
 			 struct ml_lib_user_space_recommendation *hint,
 			 struct ml_lib_user_space_request *request);
@@ -386,6 +1277,85 @@ int ml_model_error_backpropagation(struct ml_lib_model *ml_model,
 			    struct ml_lib_user_space_notification *notify);
 int correct_system_state(struct ml_lib_model *ml_model);
 
+/* io_uring API */
+
+struct io_uring_cmd;
+
+#ifdef CONFIG_IO_URING
+int ml_model_uring_cmd(struct ml_lib_model *ml_model,
+			struct io_uring_cmd *ioucmd,
+			unsigned int issue_flags);
+#else
+static inline
+int ml_model_uring_cmd(struct ml_lib_model *ml_model,
+			struct io_uring_cmd *ioucmd,
+			unsigned int issue_flags)
+{
+	return -EOPNOTSUPP;
+}
+#endif /* CONFIG_IO_URING */
+
+/* Preprocessing API */
+
+void *allocate_preprocess_config(u32 nr_features, gfp_t gfp);
+void free_preprocess_config(struct ml_lib_preprocess_config *config);
+int ml_model_set_preprocess_config(struct ml_lib_model *ml_model,
+				   struct ml_lib_preprocess_config *config);
+
+/* Dataset stream API */
+
+u64 ml_model_stream_cursor(struct ml_lib_model *ml_model);
+void ml_model_reset_stream(struct ml_lib_model *ml_model);
+
+/* Dataset ring API */
+
+int ml_model_create_dataset_ring(struct ml_lib_model *ml_model,
+				 u32 nr_slots, u32 portion_size);
+void ml_model_destroy_dataset_ring(struct ml_lib_model *ml_model);
+int ml_model_dataset_ring_mmap(struct ml_lib_model *ml_model,
+			       struct vm_area_struct *vma);
+ssize_t ml_model_read_dataset(struct ml_lib_model *ml_model,
+			      char __user *buf, size_t count, loff_t *ppos);
+
+/* In-kernel tree ensemble API */
+
+int ml_model_load_tree_ensemble(struct ml_lib_model *ml_model,
+				const void *image, size_t size);
+void ml_model_unload_tree_ensemble(struct ml_lib_model *ml_model);
+int ml_model_evaluate_tree_ensemble(struct ml_lib_model *ml_model,
+				    const s64 *features, u32 nr_features,
+				    s64 *value);
+
+/* Model blob API */
+
+int ml_model_load_blob(struct ml_lib_model *ml_model,
+		       const void *blob, size_t size);
+
+/* In-kernel quantized MLP API */
+
+int ml_model_load_mlp(struct ml_lib_model *ml_model,
+		      const void *image, size_t size);
+void ml_model_unload_mlp(struct ml_lib_model *ml_model);
+int ml_model_mlp_infer(struct ml_lib_model *ml_model,
+		       const s8 *input, u32 input_size,
+		       s32 *output, u32 output_size);
+struct ml_lib_mlp *allocate_mlp(const void *image, size_t size);
+void free_mlp(struct ml_lib_mlp *mlp);
+int ml_lib_mlp_run_inference(const struct ml_lib_mlp *mlp,
+			     const s8 *input, u32 input_size,
+			     s32 *output, u32 output_size);
+
+/* Aggregation kernels API */
+
+s32 ml_lib_dot_s8(const s8 *a, const s8 *b, u32 count);
+
+/* Per-CPU samples collection API */
+
+int ml_model_create_sample_buffers(struct ml_lib_model *ml_model,
+				   u32 sample_size, u32 nr_samples);
+void ml_model_destroy_sample_buffers(struct ml_lib_model *ml_model);
+int ml_lib_record_sample(struct ml_lib_model *ml_model, const void *sample);
+
 /* Generic implementation of ML model's methods */
 
 int generic_create_ml_model(struct ml_lib_model *ml_model);
@@ -403,6 +1373,8 @@ int generic_get_dataset(struct ml_lib_model *ml_model,
 			struct ml_lib_dataset *dataset);
 int generic_preprocess_data(struct ml_lib_model *ml_model,
 			    struct ml_lib_dataset *dataset);
+int generic_compress_data(struct ml_lib_model *ml_model,
+			  struct ml_lib_dataset *dataset);
 int generic_publish_data(struct ml_lib_model *ml_model,
 			 struct ml_lib_dataset *dataset,
 			 struct ml_lib_user_space_notification *notify);
@@ -421,5 +1393,8 @@ int generic_error_backpropagation(struct ml_lib_model *ml_model,
 			    struct ml_lib_backpropagation_feedback *feedback,
 			    struct ml_lib_user_space_notification *notify);
 int generic_correct_system_state(struct ml_lib_model *ml_model);
+int generic_default_operation(struct ml_lib_model *ml_model,
+			 struct ml_lib_user_space_recommendation *hint,
+			 struct ml_lib_user_space_request *request);
 
 #endif /* _LINUX_ML_LIB_H */
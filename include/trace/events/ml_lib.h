@@ -0,0 +1,160 @@
+/* SPDX-License-Identifier: GPL-2.0-only */
+/*
+ * Machine Learning (ML) library
+ *
+ * Copyright (C) 2025-2026 Viacheslav Dubeyko <slava@dubeyko.com>
+ */
+
+#undef TRACE_SYSTEM
+#define TRACE_SYSTEM ml_lib
+
+#if !defined(_TRACE_ML_LIB_H) || defined(TRACE_HEADER_MULTI_READ)
+#define _TRACE_ML_LIB_H
+
+#include <linux/tracepoint.h>
+#include <linux/ml-lib/ml_lib.h>
+
+/*
+ * The dataset has been published into the queue of ML model.
+ * The dataset is valid during the probe execution, so BPF
+ * program (tp_btf) can mirror the payload into its ring buffer
+ * by bpf_ml_lib_dataset_read() kfunc.
+ */
+TRACE_EVENT(ml_lib_dataset_publish,
+
+	TP_PROTO(struct ml_lib_model *ml_model,
+		 struct ml_lib_dataset *dataset),
+
+	TP_ARGS(ml_model, dataset),
+
+	TP_STRUCT__entry(
+		__string(subsystem, ml_model->subsystem_name)
+		__string(model, ml_model->model_name)
+		__field(u64, portion_offset)
+		__field(u64, slot_seq)
+		__field(u32, portion_size)
+		__field(u32, compression)
+		__field(u32, raw_size)
+	),
+
+	TP_fast_assign(
+		__assign_str(subsystem);
+		__assign_str(model);
+		__entry->portion_offset = dataset->portion_offset;
+		__entry->slot_seq = dataset->slot_seq;
+		__entry->portion_size = dataset->portion_size;
+		__entry->compression = dataset->compression;
+		__entry->raw_size = dataset->raw_size;
+	),
+
+	TP_printk("%s/%s: offset %llu size %u compression %u raw_size %u seq %llu",
+		  __get_str(subsystem), __get_str(model),
+		  __entry->portion_offset, __entry->portion_size,
+		  __entry->compression, __entry->raw_size,
+		  __entry->slot_seq)
+);
+
+TRACE_DEFINE_ENUM(ML_LIB_UNKNOWN_MODE);
+TRACE_DEFINE_ENUM(ML_LIB_EMERGENCY_MODE);
+TRACE_DEFINE_ENUM(ML_LIB_LEARNING_MODE);
+TRACE_DEFINE_ENUM(ML_LIB_COLLABORATION_MODE);
+TRACE_DEFINE_ENUM(ML_LIB_RECOMMENDATION_MODE);
+
+TRACE_DEFINE_ENUM(ML_LIB_MODE_CHANGE_MANUAL);
+TRACE_DEFINE_ENUM(ML_LIB_MODE_CHANGE_PROMOTION);
+TRACE_DEFINE_ENUM(ML_LIB_MODE_CHANGE_EFFICIENCY);
+TRACE_DEFINE_ENUM(ML_LIB_MODE_CHANGE_LATENCY);
+
+#define show_ml_lib_mode(mode)						\
+	__print_symbolic(mode,						\
+		{ ML_LIB_UNKNOWN_MODE,		"unknown" },		\
+		{ ML_LIB_EMERGENCY_MODE,	"emergency" },		\
+		{ ML_LIB_LEARNING_MODE,		"learning" },		\
+		{ ML_LIB_COLLABORATION_MODE,	"collaboration" },	\
+		{ ML_LIB_RECOMMENDATION_MODE,	"recommendation" })
+
+#define show_ml_lib_mode_change(reason)					\
+	__print_symbolic(reason,					\
+		{ ML_LIB_MODE_CHANGE_MANUAL,	"manual" },		\
+		{ ML_LIB_MODE_CHANGE_PROMOTION,	"promotion" },		\
+		{ ML_LIB_MODE_CHANGE_EFFICIENCY, "efficiency" },	\
+		{ ML_LIB_MODE_CHANGE_LATENCY,	"latency" })
+
+/*
+ * The mode governor has evaluated the last interval of ML model.
+ * The negative efficiency means that nothing has been measured.
+ */
+TRACE_EVENT(ml_lib_governor_sample,
+
+	TP_PROTO(struct ml_lib_model *ml_model, int mode,
+		 int efficiency, u64 latency_ns, u64 decisions),
+
+	TP_ARGS(ml_model, mode, efficiency, latency_ns, decisions),
+
+	TP_STRUCT__entry(
+		__string(subsystem, ml_model->subsystem_name)
+		__string(model, ml_model->model_name)
+		__field(int, mode)
+		__field(int, efficiency)
+		__field(u64, latency_ns)
+		__field(u64, decisions)
+	),
+
+	TP_fast_assign(
+		__assign_str(subsystem);
+		__assign_str(model);
+		__entry->mode = mode;
+		__entry->efficiency = efficiency;
+		__entry->latency_ns = latency_ns;
+		__entry->decisions = decisions;
+	),
+
+	TP_printk("%s/%s: mode %s efficiency %d latency_ns %llu decisions %llu",
+		  __get_str(subsystem), __get_str(model),
+		  show_ml_lib_mode(__entry->mode),
+		  __entry->efficiency, __entry->latency_ns,
+		  __entry->decisions)
+);
+
+/*
+ * The mode of ML model has been changed manually or by the governor.
+ */
+TRACE_EVENT(ml_lib_mode_change,
+
+	TP_PROTO(struct ml_lib_model *ml_model, int old_mode, int new_mode,
+		 int reason, int efficiency, u64 latency_ns),
+
+	TP_ARGS(ml_model, old_mode, new_mode, reason, efficiency, latency_ns),
+
+	TP_STRUCT__entry(
+		__string(subsystem, ml_model->subsystem_name)
+		__string(model, ml_model->model_name)
+		__field(int, old_mode)
+		__field(int, new_mode)
+		__field(int, reason)
+		__field(int, efficiency)
+		__field(u64, latency_ns)
+	),
+
+	TP_fast_assign(
+		__assign_str(subsystem);
+		__assign_str(model);
+		__entry->old_mode = old_mode;
+		__entry->new_mode = new_mode;
+		__entry->reason = reason;
+		__entry->efficiency = efficiency;
+		__entry->latency_ns = latency_ns;
+	),
+
+	TP_printk("%s/%s: %s -> %s reason %s efficiency %d latency_ns %llu",
+		  __get_str(subsystem), __get_str(model),
+		  show_ml_lib_mode(__entry->old_mode),
+		  show_ml_lib_mode(__entry->new_mode),
+		  show_ml_lib_mode_change(__entry->reason),
+		  __entry->efficiency, __entry->latency_ns)
+);
+
+#endif /* _TRACE_ML_LIB_H */
+
+/* This part must be outside protection */
+#include <trace/define_trace.h>
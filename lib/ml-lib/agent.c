@@ -0,0 +1,559 @@
+// SPDX-License-Identifier: GPL-2.0-only
+/*
+ * Machine Learning (ML) library
+ *
+ * Copyright (C) 2025-2026 Viacheslav Dubeyko <slava@dubeyko.com>
+ */
+
+#include <linux/module.h>
+#include <linux/kernel.h>
+#include <linux/ktime.h>
+#include <linux/math64.h>
+#include <linux/rculist.h>
+#include <linux/slab.h>
+#include <linux/spinlock.h>
+#include <linux/srcu.h>
+
+#include <linux/ml-lib/ml_lib.h>
+
+#include "decision.h"
+#include "agent.h"
+
+/*
+ * Several user-space agents can be attached to one ML model.
+ * The request of ml_model_decide() that isn't answered by the cache
+ * or by execute_operation() is hedged: it is sent to hedge_agents
+ * live agents (selected round-robin) and the first recommendation
+ * wins. The other agents receive cancel_request() and their answers
+ * are counted as late ones and dropped.
+ *
+ * The shadow agent receives every request of ml_model_decide() in
+ * COLLABORATION and RECOMMENDATION modes, but its recommendations
+ * are never applied. Every answer of shadow agent is scored by
+ * estimate_efficiency() method for the features of the answered
+ * request (the inflight slot keeps their copy), so a new agent can
+ * be compared with the live ones before it is trusted.
+ *
+ * Every agent remembers the last ML_LIB_AGENT_INFLIGHT_MAX requests
+ * (indexed by request id) in order to measure the latency of its
+ * answers. If the slot has been reused by the newer request, then
+ * the answer of live agent is passed to ml_model_submit_recommendation()
+ * that drops the answers of finished decisions.
+ */
+
+/*
+ * The agents are used by ml_model_decide() and by the answers of agents
+ * in SRCU read-side critical sections. The answer can sleep in
+ * estimate_efficiency() method, so the detaching of agent waits
+ * for the answers in progress by synchronize_srcu().
+ */
+DEFINE_STATIC_SRCU(ml_lib_agent_srcu);
+
+#define ml_lib_agent_for_each(agent, ml_model)				\
+	list_for_each_entry_srcu(agent, &(ml_model)->agents, node,	\
+				 srcu_read_lock_held(&ml_lib_agent_srcu))
+
+void ml_lib_agent_init(struct ml_lib_model *ml_model)
+{
+	spin_lock_init(&ml_model->agents_lock);
+	INIT_LIST_HEAD(&ml_model->agents);
+	atomic_set(&ml_model->agent_cursor, 0);
+}
+
+static inline bool ml_lib_agent_is_shadow(struct ml_lib_agent *agent)
+{
+	return agent->flags & ML_LIB_AGENT_SHADOW;
+}
+
+static inline struct ml_lib_agent_inflight *
+ml_lib_agent_slot(struct ml_lib_agent *agent, u64 request_id)
+{
+	return &agent->inflight[request_id & (ML_LIB_AGENT_INFLIGHT_MAX - 1)];
+}
+
+/*
+ * ml_model_attach_agent() - attach user-space agent to ML model
+ * @ml_model: ML model object
+ * @agent: agent object
+ *
+ * The agent object should stay valid until ml_model_detach_agent()
+ * or destruction of ML model.
+ */
+int ml_model_attach_agent(struct ml_lib_model *ml_model,
+			  struct ml_lib_agent *agent)
+{
+	int i;
+
+	if (!ml_model || !agent || !agent->ops || !agent->ops->send_request)
+		return -EINVAL;
+
+	if (atomic_read(&ml_model->state) == ML_LIB_MODEL_SHUTTING_DOWN)
+		return -ENODEV;
+
+	spin_lock(&ml_model->agents_lock);
+
+	if (agent->ml_model) {
+		spin_unlock(&ml_model->agents_lock);
+		return -EBUSY;
+	}
+
+	memset(&agent->stats, 0, sizeof(agent->stats));
+	spin_lock_init(&agent->lock);
+	for (i = 0; i < ML_LIB_AGENT_INFLIGHT_MAX; i++) {
+		agent->inflight[i].request_id = U64_MAX;
+		agent->inflight[i].start_ns = 0;
+		agent->inflight[i].nr_features = 0;
+		agent->inflight[i].features = NULL;
+	}
+
+	WRITE_ONCE(agent->ml_model, ml_model);
+	list_add_tail_rcu(&agent->node, &ml_model->agents);
+
+	spin_unlock(&ml_model->agents_lock);
+
+	return 0;
+}
+EXPORT_SYMBOL(ml_model_attach_agent);
+
+/*
+ * The features of detached agent's requests are freed. The request
+ * that is being sent concurrently sees the detached agent under
+ * the agent's lock and doesn't keep its features.
+ */
+static void ml_lib_agent_release(struct ml_lib_agent *agent)
+{
+	unsigned long flags;
+	int i;
+
+	spin_lock_irqsave(&agent->lock, flags);
+	for (i = 0; i < ML_LIB_AGENT_INFLIGHT_MAX; i++) {
+		kfree(agent->inflight[i].features);
+		agent->inflight[i].features = NULL;
+		agent->inflight[i].nr_features = 0;
+	}
+	spin_unlock_irqrestore(&agent->lock, flags);
+}
+
+/*
+ * ml_model_detach_agent() - detach user-space agent from ML model
+ * @agent: agent object
+ *
+ * The method waits until ml_model_decide() and the answers
+ * in progress stop to use the agent. The next answers of detached
+ * agent are rejected.
+ */
+void ml_model_detach_agent(struct ml_lib_agent *agent)
+{
+	struct ml_lib_model *ml_model;
+
+	if (!agent)
+		return;
+
+	ml_model = READ_ONCE(agent->ml_model);
+	if (!ml_model)
+		return;
+
+	spin_lock(&ml_model->agents_lock);
+	if (agent->ml_model == ml_model) {
+		list_del_rcu(&agent->node);
+		WRITE_ONCE(agent->ml_model, NULL);
+		ml_lib_agent_release(agent);
+	}
+	spin_unlock(&ml_model->agents_lock);
+
+	synchronize_srcu(&ml_lib_agent_srcu);
+}
+EXPORT_SYMBOL(ml_model_detach_agent);
+
+void ml_lib_agent_detach_all(struct ml_lib_model *ml_model)
+{
+	struct ml_lib_agent *agent, *tmp;
+
+	spin_lock(&ml_model->agents_lock);
+	list_for_each_entry_safe(agent, tmp, &ml_model->agents, node) {
+		list_del_rcu(&agent->node);
+		WRITE_ONCE(agent->ml_model, NULL);
+		ml_lib_agent_release(agent);
+	}
+	spin_unlock(&ml_model->agents_lock);
+
+	synchronize_srcu(&ml_lib_agent_srcu);
+}
+
+static int ml_lib_agent_send(struct ml_lib_agent *agent,
+			     struct ml_lib_user_space_request *request)
+{
+	struct ml_lib_agent_inflight *slot;
+	s64 *features = NULL;
+	unsigned long flags;
+	int err;
+
+	/* the answer of shadow agent is scored for the same features */
+	if (ml_lib_agent_is_shadow(agent) && request->features &&
+	    request->nr_features) {
+		features = kmemdup(request->features,
+				   request->nr_features * sizeof(s64),
+				   GFP_NOWAIT | __GFP_NOWARN);
+		if (unlikely(!features))
+			return -ENOMEM;
+	}
+
+	slot = ml_lib_agent_slot(agent, request->id);
+
+	/* the answer cannot outrun the slot of request */
+	spin_lock_irqsave(&agent->lock, flags);
+	if (likely(READ_ONCE(agent->ml_model))) {
+		swap(slot->features, features);
+		slot->nr_features = slot->features ? request->nr_features : 0;
+	}
+	slot->request_id = request->id;
+	slot->start_ns = ktime_get_ns();
+	spin_unlock_irqrestore(&agent->lock, flags);
+
+	/* the features of overwritten request or of detached agent */
+	kfree(features);
+	features = NULL;
+
+	err = agent->ops->send_request(agent, request);
+	if (unlikely(err)) {
+		spin_lock_irqsave(&agent->lock, flags);
+		if (slot->request_id == request->id) {
+			swap(slot->features, features);
+			slot->nr_features = 0;
+			slot->request_id = U64_MAX;
+			slot->start_ns = 0;
+		}
+		spin_unlock_irqrestore(&agent->lock, flags);
+		kfree(features);
+		return err;
+	}
+
+	atomic64_inc(&agent->stats.requests);
+	return 0;
+}
+
+/*
+ * ml_lib_agent_shadow() - send the request to shadow agents
+ * @ml_model: ML model object
+ * @request: request of decision
+ */
+void ml_lib_agent_shadow(struct ml_lib_model *ml_model,
+			 struct ml_lib_user_space_request *request)
+{
+	struct ml_lib_agent *agent;
+	int idx;
+
+	if (list_empty(&ml_model->agents))
+		return;
+
+	idx = srcu_read_lock(&ml_lib_agent_srcu);
+	ml_lib_agent_for_each(agent, ml_model) {
+		if (ml_lib_agent_is_shadow(agent))
+			ml_lib_agent_send(agent, request);
+	}
+	srcu_read_unlock(&ml_lib_agent_srcu, idx);
+}
+
+static u32 ml_lib_agent_hedge_agents(struct ml_lib_model *ml_model)
+{
+	struct ml_lib_model_options *options;
+	u32 hedge_agents = 0;
+
+	rcu_read_lock();
+	options = rcu_dereference(ml_model->options);
+	if (options)
+		hedge_agents = options->hedge_agents;
+	rcu_read_unlock();
+
+	return hedge_agents ? hedge_agents : ML_LIB_HEDGE_AGENTS_DEFAULT;
+}
+
+/*
+ * ml_lib_agent_hedge() - send the request to several live agents
+ * @ml_model: ML model object
+ * @request: request of decision
+ *
+ * Returns the number of agents that have received the request.
+ */
+int ml_lib_agent_hedge(struct ml_lib_model *ml_model,
+		       struct ml_lib_user_space_request *request)
+{
+	struct ml_lib_agent *agent;
+	u32 hedge_agents;
+	u32 nr_agents = 0;
+	u32 start, index = 0;
+	int sent = 0;
+	int idx;
+
+	if (list_empty(&ml_model->agents))
+		return 0;
+
+	hedge_agents = ml_lib_agent_hedge_agents(ml_model);
+
+	idx = srcu_read_lock(&ml_lib_agent_srcu);
+
+	ml_lib_agent_for_each(agent, ml_model) {
+		if (!ml_lib_agent_is_shadow(agent))
+			nr_agents++;
+	}
+
+	if (!nr_agents)
+		goto finish_hedge;
+
+	/* the load is spread over all live agents */
+	start = (u32)atomic_inc_return(&ml_model->agent_cursor) % nr_agents;
+
+	ml_lib_agent_for_each(agent, ml_model) {
+		if (ml_lib_agent_is_shadow(agent))
+			continue;
+
+		if ((index++ + nr_agents - start) % nr_agents >= hedge_agents)
+			continue;
+
+		if (!ml_lib_agent_send(agent, request))
+			sent++;
+	}
+
+finish_hedge:
+	srcu_read_unlock(&ml_lib_agent_srcu, idx);
+
+	return sent;
+}
+
+/*
+ * ml_lib_agent_cancel() - cancel the request in other live agents
+ * @ml_model: ML model object
+ * @request_id: identification of request
+ * @winner: agent that has answered (NULL - nobody)
+ */
+void ml_lib_agent_cancel(struct ml_lib_model *ml_model, u64 request_id,
+			 struct ml_lib_agent *winner)
+{
+	struct ml_lib_agent_inflight *slot;
+	struct ml_lib_agent *agent;
+	unsigned long flags;
+	bool pending;
+	int idx;
+
+	if (list_empty(&ml_model->agents))
+		return;
+
+	idx = srcu_read_lock(&ml_lib_agent_srcu);
+	ml_lib_agent_for_each(agent, ml_model) {
+		if (agent == winner || ml_lib_agent_is_shadow(agent))
+			continue;
+
+		slot = ml_lib_agent_slot(agent, request_id);
+
+		spin_lock_irqsave(&agent->lock, flags);
+		pending = slot->request_id == request_id && slot->start_ns;
+		if (pending)
+			slot->start_ns = 0;
+		spin_unlock_irqrestore(&agent->lock, flags);
+
+		if (!pending)
+			continue;
+
+		atomic64_inc(&agent->stats.cancelled);
+
+		if (agent->ops->cancel_request)
+			agent->ops->cancel_request(agent, request_id);
+	}
+	srcu_read_unlock(&ml_lib_agent_srcu, idx);
+}
+
+/*
+ * Returns 0 if the answer is expected, -ESTALE if the request has been
+ * answered or cancelled already and -ENOENT if the request is unknown.
+ * The answered @request takes the features of inflight slot and
+ * the caller should free them.
+ */
+static int ml_lib_agent_answer(struct ml_lib_agent *agent, u64 request_id,
+			       struct ml_lib_user_space_request *request)
+{
+	struct ml_lib_agent_stats *stats = &agent->stats;
+	struct ml_lib_agent_inflight *slot;
+	unsigned long flags;
+	u64 latency_ns = 0;
+	s64 max_latency_ns;
+	s64 old;
+	int err = 0;
+
+	slot = ml_lib_agent_slot(agent, request_id);
+
+	spin_lock_irqsave(&agent->lock, flags);
+	if (slot->request_id != request_id)
+		err = -ENOENT;
+	else if (!slot->start_ns)
+		err = -ESTALE;
+	else {
+		latency_ns = ktime_get_ns() - slot->start_ns;
+		slot->start_ns = 0;
+
+		request->id = request_id;
+		request->nr_features = slot->nr_features;
+		request->features = slot->features;
+		slot->nr_features = 0;
+		slot->features = NULL;
+	}
+	spin_unlock_irqrestore(&agent->lock, flags);
+
+	if (err)
+		return err;
+
+	atomic64_inc(&stats->answers);
+	atomic64_add(latency_ns, &stats->latency_ns);
+
+	max_latency_ns = atomic64_read(&stats->max_latency_ns);
+	while ((s64)latency_ns > max_latency_ns) {
+		old = atomic64_cmpxchg(&stats->max_latency_ns,
+				       max_latency_ns, latency_ns);
+		if (old == max_latency_ns)
+			break;
+		max_latency_ns = old;
+	}
+
+	return 0;
+}
+
+static void ml_lib_agent_score(struct ml_lib_model *ml_model,
+			struct ml_lib_agent *agent,
+			const struct ml_lib_user_space_recommendation *hint,
+			struct ml_lib_user_space_request *request)
+{
+	struct ml_lib_user_space_recommendation shadow_hint;
+	int efficiency;
+
+	memcpy(&shadow_hint, hint, sizeof(shadow_hint));
+
+	efficiency = estimate_ml_model_efficiency(ml_model, &shadow_hint,
+						  request);
+	if (efficiency < 0)
+		return;
+
+	atomic64_add(efficiency, &agent->stats.score);
+	atomic64_inc(&agent->stats.scored);
+}
+
+static int ml_lib_agent_submit(struct ml_lib_model *ml_model,
+			struct ml_lib_agent *agent,
+			const struct ml_lib_user_space_recommendation *hint)
+{
+	struct ml_lib_user_space_request request = {0};
+	int err;
+
+	err = ml_lib_agent_answer(agent, hint->request_id, &request);
+
+	if (ml_lib_agent_is_shadow(agent)) {
+		if (err) {
+			atomic64_inc(&agent->stats.late);
+			return -ESTALE;
+		}
+
+		ml_lib_agent_score(ml_model, agent, hint, &request);
+		kfree(request.features);
+		return 0;
+	}
+
+	switch (err) {
+	case 0:
+		err = ml_lib_decision_complete(ml_model, hint, agent);
+		if (!err) {
+			atomic64_inc(&agent->stats.wins);
+			return 0;
+		}
+		/* the waiter has timed out before cancellation */
+		break;
+
+	case -ESTALE:
+		break;
+
+	default:
+		/* the slot has been reused by the newer request */
+		err = ml_model_submit_recommendation(ml_model, hint);
+		break;
+	}
+
+	if (err == -ESTALE)
+		atomic64_inc(&agent->stats.late);
+
+	return err;
+}
+
+/*
+ * ml_model_submit_agent_recommendation() - submit answer of agent
+ * @agent: agent object
+ * @hint: recommendation record
+ *
+ * The first answer of live agent to the hedged request is delivered
+ * to ml_model_decide(). The answer of shadow agent is scored by
+ * estimate_efficiency() method of ML model and it is never applied.
+ * The answers to the finished requests are dropped.
+ *
+ * Returns -ESTALE if the request has been answered by another agent,
+ * cancelled or timed out.
+ */
+int ml_model_submit_agent_recommendation(struct ml_lib_agent *agent,
+			const struct ml_lib_user_space_recommendation *hint)
+{
+	struct ml_lib_model *ml_model;
+	int err;
+	int idx;
+
+	if (!agent || !hint)
+		return -EINVAL;
+
+	/* ml_model_detach_agent() waits for the end of the answer */
+	idx = srcu_read_lock(&ml_lib_agent_srcu);
+
+	ml_model = READ_ONCE(agent->ml_model);
+	if (ml_model)
+		err = ml_lib_agent_submit(ml_model, agent, hint);
+	else
+		err = -ENODEV;
+
+	srcu_read_unlock(&ml_lib_agent_srcu, idx);
+
+	return err;
+}
+EXPORT_SYMBOL(ml_model_submit_agent_recommendation);
+
+/*
+ * ml_lib_agent_info() - show the agents' statistics in sysfs
+ * @ml_model: ML model object
+ * @buf: sysfs buffer
+ */
+ssize_t ml_lib_agent_info(struct ml_lib_model *ml_model, char *buf)
+{
+	struct ml_lib_agent_stats *stats;
+	struct ml_lib_agent *agent;
+	u64 answers, scored;
+	int count = 0;
+	int idx;
+
+	idx = srcu_read_lock(&ml_lib_agent_srcu);
+	ml_lib_agent_for_each(agent, ml_model) {
+		stats = &agent->stats;
+		answers = atomic64_read(&stats->answers);
+		scored = atomic64_read(&stats->scored);
+
+		count += sysfs_emit_at(buf, count,
+			"%s shadow %d requests %llu answers %llu wins %llu "
+			"late %llu cancelled %llu avg_latency_ns %llu "
+			"max_latency_ns %llu score %llu\n",
+			agent->name ? agent->name : "unknown",
+			ml_lib_agent_is_shadow(agent),
+			atomic64_read(&stats->requests), answers,
+			atomic64_read(&stats->wins),
+			atomic64_read(&stats->late),
+			atomic64_read(&stats->cancelled),
+			answers ? div64_u64(atomic64_read(&stats->latency_ns),
+					    answers) : 0,
+			atomic64_read(&stats->max_latency_ns),
+			scored ? div64_u64(atomic64_read(&stats->score),
+					   scored) : 0);
+	}
+	srcu_read_unlock(&ml_lib_agent_srcu, idx);
+
+	return count;
+}
@@ -0,0 +1,21 @@
+// SPDX-License-Identifier: GPL-2.0-only
+/*
+ * Machine Learning (ML) library
+ *
+ * Copyright (C) 2025-2026 Viacheslav Dubeyko <slava@dubeyko.com>
+ */
+
+#ifndef _LINUX_ML_LIB_AGENT_H
+#define _LINUX_ML_LIB_AGENT_H
+
+void ml_lib_agent_init(struct ml_lib_model *ml_model);
+void ml_lib_agent_detach_all(struct ml_lib_model *ml_model);
+void ml_lib_agent_shadow(struct ml_lib_model *ml_model,
+			 struct ml_lib_user_space_request *request);
+int ml_lib_agent_hedge(struct ml_lib_model *ml_model,
+		       struct ml_lib_user_space_request *request);
+void ml_lib_agent_cancel(struct ml_lib_model *ml_model, u64 request_id,
+			 struct ml_lib_agent *winner);
+ssize_t ml_lib_agent_info(struct ml_lib_model *ml_model, char *buf);
+
+#endif /* _LINUX_ML_LIB_AGENT_H */
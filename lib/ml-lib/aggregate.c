@@ -0,0 +1,463 @@
+// SPDX-License-Identifier: GPL-2.0-only
+/*
+ * Machine Learning (ML) library
+ *
+ * Copyright (C) 2025-2026 Viacheslav Dubeyko <slava@dubeyko.com>
+ */
+
+#include <linux/module.h>
+#include <linux/kernel.h>
+#include <linux/slab.h>
+#include <linux/random.h>
+#include <linux/bitops.h>
+#include <linux/sizes.h>
+#ifdef CONFIG_ARCH_HAS_KERNEL_FPU_SUPPORT
+#include <linux/fpu.h>
+#include <asm/simd.h>
+#endif /* CONFIG_ARCH_HAS_KERNEL_FPU_SUPPORT */
+#ifdef CONFIG_X86
+#include <asm/cpufeature.h>
+#include <asm/fpu/api.h>
+#endif /* CONFIG_X86 */
+
+#include <linux/ml-lib/ml_lib.h>
+
+#include "aggregate.h"
+
+/*
+ * The aggregation kernels reduce the records of dataset into
+ * statistics of features. The vectorized implementation is selected
+ * at module initialization time among the implementations that are
+ * supported by CPU. The selected implementation is checked against
+ * the scalar reference by self-test. The scalar reference is used
+ * if the self-test fails.
+ *
+ * The vectorized kernels are executed with disabled preemption.
+ * So, the payload is aggregated by chunks, and small payloads
+ * are aggregated by scalar code that doesn't need to save
+ * the FPU state.
+ */
+
+#define ML_LIB_AGGREGATE_FPU_CHUNK		SZ_64K
+#define ML_LIB_AGGREGATE_FPU_THRESHOLD		(256)
+
+#define ML_LIB_SELFTEST_RECORDS			(67)
+#define ML_LIB_SELFTEST_FEATURES		(9)
+#define ML_LIB_SELFTEST_DOT_COUNT		(259)
+
+static void ml_lib_scalar_columns(const s64 *records, u32 nr_records,
+				  u32 nr_features,
+				  s64 *sum, s64 *min, s64 *max)
+{
+	u32 i, j;
+
+	for (i = 0; i < nr_records; i++, records += nr_features) {
+		for (j = 0; j < nr_features; j++) {
+			sum[j] += records[j];
+			if (records[j] < min[j])
+				min[j] = records[j];
+			if (records[j] > max[j])
+				max[j] = records[j];
+		}
+	}
+}
+
+static s32 ml_lib_scalar_dot_s8(const s8 *a, const s8 *b, u32 count)
+{
+	s32 result = 0;
+	u32 i;
+
+	for (i = 0; i < count; i++)
+		result += (s32)a[i] * (s32)b[i];
+
+	return result;
+}
+
+static const struct ml_lib_aggregate_ops ml_lib_aggregate_scalar_ops = {
+	.name		= "scalar",
+	.fpu		= false,
+	.columns	= ml_lib_scalar_columns,
+	.dot_s8		= ml_lib_scalar_dot_s8,
+};
+
+static const struct ml_lib_aggregate_ops *ml_lib_aggregate_ops __read_mostly =
+						&ml_lib_aggregate_scalar_ops;
+
+#ifdef CONFIG_ARCH_HAS_KERNEL_FPU_SUPPORT
+static inline void ml_lib_aggregate_fpu_begin(void)
+{
+	kernel_fpu_begin();
+}
+
+static inline void ml_lib_aggregate_fpu_end(void)
+{
+	kernel_fpu_end();
+}
+
+static inline bool ml_lib_aggregate_may_use_fpu(void)
+{
+	return may_use_simd();
+}
+#else
+static inline void ml_lib_aggregate_fpu_begin(void)
+{
+}
+
+static inline void ml_lib_aggregate_fpu_end(void)
+{
+}
+
+static inline bool ml_lib_aggregate_may_use_fpu(void)
+{
+	return false;
+}
+#endif /* CONFIG_ARCH_HAS_KERNEL_FPU_SUPPORT */
+
+static void ml_lib_run_columns(const struct ml_lib_aggregate_ops *ops,
+				const s64 *records, u32 nr_records,
+				u32 nr_features,
+				s64 *sum, s64 *min, s64 *max)
+{
+	u32 chunk;
+
+	if (!ops->fpu) {
+		ops->columns(records, nr_records, nr_features, sum, min, max);
+		return;
+	}
+
+	chunk = max_t(u32, 1, ML_LIB_AGGREGATE_FPU_CHUNK /
+				(nr_features * sizeof(s64)));
+
+	while (nr_records > 0) {
+		u32 count = min_t(u32, nr_records, chunk);
+
+		ml_lib_aggregate_fpu_begin();
+		ops->columns(records, count, nr_features, sum, min, max);
+		ml_lib_aggregate_fpu_end();
+
+		records += (size_t)count * nr_features;
+		nr_records -= count;
+	}
+}
+
+static s32 ml_lib_run_dot_s8(const struct ml_lib_aggregate_ops *ops,
+			     const s8 *a, const s8 *b, u32 count)
+{
+	s32 result = 0;
+	u32 chunk;
+
+	if (!ops->fpu)
+		return ops->dot_s8(a, b, count);
+
+	while (count > 0) {
+		chunk = min_t(u32, count, ML_LIB_AGGREGATE_FPU_CHUNK);
+
+		ml_lib_aggregate_fpu_begin();
+		result += ops->dot_s8(a, b, chunk);
+		ml_lib_aggregate_fpu_end();
+
+		a += chunk;
+		b += chunk;
+		count -= chunk;
+	}
+
+	return result;
+}
+
+static inline
+const struct ml_lib_aggregate_ops *ml_lib_aggregate_select(size_t bytes)
+{
+	const struct ml_lib_aggregate_ops *ops = READ_ONCE(ml_lib_aggregate_ops);
+
+	if (ops->fpu && (bytes < ML_LIB_AGGREGATE_FPU_THRESHOLD ||
+			 !ml_lib_aggregate_may_use_fpu()))
+		return &ml_lib_aggregate_scalar_ops;
+
+	return ops;
+}
+
+/*
+ * ml_lib_aggregate_columns() - accumulate statistics of features
+ * @records: array of records (@nr_features 64-bit values per record)
+ * @nr_records: number of records
+ * @nr_features: number of features in one record
+ * @sum: per-feature sums [in|out]
+ * @min: per-feature minimums [in|out]
+ * @max: per-feature maximums [in|out]
+ */
+void ml_lib_aggregate_columns(const s64 *records, u32 nr_records,
+			      u32 nr_features,
+			      s64 *sum, s64 *min, s64 *max)
+{
+	const struct ml_lib_aggregate_ops *ops;
+
+	if (!nr_records || !nr_features)
+		return;
+
+	ops = ml_lib_aggregate_select((size_t)nr_records * nr_features *
+					sizeof(s64));
+	ml_lib_run_columns(ops, records, nr_records, nr_features,
+			   sum, min, max);
+}
+
+/*
+ * ml_lib_log2_histogram() - accumulate log2 histograms of features
+ * @records: array of records (@nr_features 64-bit values per record)
+ * @nr_records: number of records
+ * @nr_features: number of features in one record
+ * @histogram: ML_LIB_HISTOGRAM_BUCKETS counters per feature [in|out]
+ *
+ * The bucket of value is fls64() of its bit pattern, so the negative
+ * values fall into the last bucket. Neither SSE/AVX2 nor NEON can
+ * count leading zeros of 64-bit lanes or increment the scattered
+ * counters without conflicts, so histogramming is scalar.
+ */
+void ml_lib_log2_histogram(const s64 *records, u32 nr_records,
+			   u32 nr_features, u64 *histogram)
+{
+	u32 i, j;
+
+	for (i = 0; i < nr_records; i++, records += nr_features) {
+		u64 *counters = histogram;
+
+		for (j = 0; j < nr_features; j++) {
+			counters[fls64((u64)records[j])]++;
+			counters += ML_LIB_HISTOGRAM_BUCKETS;
+		}
+	}
+}
+
+/*
+ * ml_lib_dot_s8() - dot product of int8 vectors
+ * @a: first vector
+ * @b: second vector
+ * @count: number of elements in vectors
+ *
+ * The result wraps around if it doesn't fit into 32 bits.
+ */
+s32 ml_lib_dot_s8(const s8 *a, const s8 *b, u32 count)
+{
+	const struct ml_lib_aggregate_ops *ops;
+
+	if (!a || !b || !count)
+		return 0;
+
+	ops = ml_lib_aggregate_select(count);
+
+	return ml_lib_run_dot_s8(ops, a, b, count);
+}
+EXPORT_SYMBOL(ml_lib_dot_s8);
+
+/*
+ * ml_lib_gemv_s8() - int8 matrix-vector product with int32 accumulation
+ * @weights: row-major matrix of @out_size rows by @in_size columns
+ * @bias: per-row bias
+ * @x: input vector of @in_size elements
+ * @in_size: number of columns
+ * @out_size: number of rows
+ * @y: output vector of @out_size elements [out]
+ *
+ * The rows are processed by chunks in one FPU section,
+ * so the FPU state isn't saved for every row.
+ */
+void ml_lib_gemv_s8(const s8 *weights, const s32 *bias, const s8 *x,
+		    u32 in_size, u32 out_size, s32 *y)
+{
+	const struct ml_lib_aggregate_ops *ops;
+	u32 chunk;
+	u32 i = 0;
+
+	if (!in_size || !out_size)
+		return;
+
+	ops = ml_lib_aggregate_select((size_t)in_size * out_size);
+	chunk = max_t(u32, 1, ML_LIB_AGGREGATE_FPU_CHUNK / in_size);
+
+	while (i < out_size) {
+		u32 end = min_t(u32, out_size, i + chunk);
+
+		if (ops->fpu)
+			ml_lib_aggregate_fpu_begin();
+
+		for (; i < end; i++) {
+			y[i] = bias[i] + ops->dot_s8(weights, x, in_size);
+			weights += in_size;
+		}
+
+		if (ops->fpu)
+			ml_lib_aggregate_fpu_end();
+	}
+}
+
+const char *ml_lib_aggregate_kernel(void)
+{
+	return READ_ONCE(ml_lib_aggregate_ops)->name;
+}
+
+static const struct ml_lib_aggregate_ops *ml_lib_aggregate_candidates[] = {
+#ifdef CONFIG_ARCH_HAS_KERNEL_FPU_SUPPORT
+#ifdef CONFIG_X86
+	&ml_lib_aggregate_avx2_ops,
+#endif /* CONFIG_X86 */
+	&ml_lib_aggregate_simd128_ops,
+#endif /* CONFIG_ARCH_HAS_KERNEL_FPU_SUPPORT */
+};
+
+static bool __init ml_lib_aggregate_supported(const struct ml_lib_aggregate_ops *ops)
+{
+#ifdef CONFIG_ARCH_HAS_KERNEL_FPU_SUPPORT
+	if (!kernel_fpu_available())
+		return false;
+
+#ifdef CONFIG_X86
+	if (ops == &ml_lib_aggregate_avx2_ops) {
+		return boot_cpu_has(X86_FEATURE_AVX2) &&
+			cpu_has_xfeatures(XFEATURE_MASK_SSE | XFEATURE_MASK_YMM,
+					  NULL);
+	}
+#endif /* CONFIG_X86 */
+
+	return true;
+#else
+	return false;
+#endif /* CONFIG_ARCH_HAS_KERNEL_FPU_SUPPORT */
+}
+
+static int __init ml_lib_selftest_columns(const struct ml_lib_aggregate_ops *ops,
+					  const s64 *records, s64 *stats)
+{
+	u32 nr_features;
+
+	for (nr_features = 1; nr_features <= ML_LIB_SELFTEST_FEATURES;
+	     nr_features++) {
+		s64 *sum = stats;
+		s64 *min = sum + ML_LIB_SELFTEST_FEATURES;
+		s64 *max = min + ML_LIB_SELFTEST_FEATURES;
+		s64 *ref_sum = max + ML_LIB_SELFTEST_FEATURES;
+		s64 *ref_min = ref_sum + ML_LIB_SELFTEST_FEATURES;
+		s64 *ref_max = ref_min + ML_LIB_SELFTEST_FEATURES;
+		u32 j;
+
+		for (j = 0; j < nr_features; j++) {
+			sum[j] = ref_sum[j] = records[j];
+			min[j] = ref_min[j] = S64_MAX;
+			max[j] = ref_max[j] = S64_MIN;
+		}
+
+		ml_lib_scalar_columns(records, ML_LIB_SELFTEST_RECORDS,
+				      nr_features, ref_sum, ref_min, ref_max);
+		ml_lib_run_columns(ops, records, ML_LIB_SELFTEST_RECORDS,
+				   nr_features, sum, min, max);
+
+		for (j = 0; j < nr_features; j++) {
+			if (sum[j] != ref_sum[j] ||
+			    min[j] != ref_min[j] ||
+			    max[j] != ref_max[j]) {
+				pr_err("ml_lib: %s columns kernel mismatch: "
+					"features %u, column %u\n",
+					ops->name, nr_features, j);
+				return -EIO;
+			}
+		}
+	}
+
+	return 0;
+}
+
+static int __init ml_lib_selftest_dot_s8(const struct ml_lib_aggregate_ops *ops,
+					 s8 *data)
+{
+	const s8 *a = data;
+	const s8 *b = data + ML_LIB_SELFTEST_DOT_COUNT;
+	u32 count;
+	s32 result, expected;
+
+	/* unaligned start checks the unaligned loads too */
+	for (count = 0; count < ML_LIB_SELFTEST_DOT_COUNT; count++) {
+		expected = ml_lib_scalar_dot_s8(a + 1, b, count);
+		result = ml_lib_run_dot_s8(ops, a + 1, b, count);
+
+		if (result != expected) {
+			pr_err("ml_lib: %s dot_s8 kernel mismatch: "
+				"count %u, result %d, expected %d\n",
+				ops->name, count, result, expected);
+			return -EIO;
+		}
+	}
+
+	/* extreme values shouldn't overflow intermediate lanes */
+	memset(data, 0x80, 2 * ML_LIB_SELFTEST_DOT_COUNT);
+	expected = ml_lib_scalar_dot_s8(a, b, ML_LIB_SELFTEST_DOT_COUNT);
+	result = ml_lib_run_dot_s8(ops, a, b, ML_LIB_SELFTEST_DOT_COUNT);
+	if (result != expected) {
+		pr_err("ml_lib: %s dot_s8 kernel mismatch: "
+			"result %d, expected %d\n",
+			ops->name, result, expected);
+		return -EIO;
+	}
+
+	return 0;
+}
+
+static int __init ml_lib_aggregate_selftest(const struct ml_lib_aggregate_ops *ops)
+{
+	size_t records_size = ML_LIB_SELFTEST_RECORDS *
+				ML_LIB_SELFTEST_FEATURES * sizeof(s64);
+	size_t stats_size = 6 * ML_LIB_SELFTEST_FEATURES * sizeof(s64);
+	size_t dot_size = 2 * ML_LIB_SELFTEST_DOT_COUNT;
+	void *buf;
+	int err;
+
+	buf = kmalloc(records_size + stats_size + dot_size, GFP_KERNEL);
+	if (unlikely(!buf))
+		return -ENOMEM;
+
+	get_random_bytes(buf, records_size);
+	get_random_bytes((u8 *)buf + records_size + stats_size, dot_size);
+
+	err = ml_lib_selftest_columns(ops, buf,
+				      (s64 *)((u8 *)buf + records_size));
+	if (err)
+		goto free_buf;
+
+	err = ml_lib_selftest_dot_s8(ops,
+				     (s8 *)buf + records_size + stats_size);
+
+free_buf:
+	kfree(buf);
+
+	return err;
+}
+
+/*
+ * ml_lib_aggregate_init() - select implementation of aggregation kernels
+ *
+ * The fastest implementation that is supported by CPU
+ * and passes the self-test is selected.
+ */
+void __init ml_lib_aggregate_init(void)
+{
+	const struct ml_lib_aggregate_ops *ops;
+	int i;
+	int err;
+
+	for (i = 0; i < ARRAY_SIZE(ml_lib_aggregate_candidates); i++) {
+		ops = ml_lib_aggregate_candidates[i];
+
+		if (!ml_lib_aggregate_supported(ops))
+			continue;
+
+		err = ml_lib_aggregate_selftest(ops);
+		if (err) {
+			pr_warn("ml_lib: %s aggregation kernels are disabled: "
+				"err %d\n", ops->name, err);
+			continue;
+		}
+
+		WRITE_ONCE(ml_lib_aggregate_ops, ops);
+		break;
+	}
+
+	pr_info("ml_lib: %s aggregation kernels are selected\n",
+		ml_lib_aggregate_kernel());
+}
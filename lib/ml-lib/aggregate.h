@@ -0,0 +1,44 @@
+// SPDX-License-Identifier: GPL-2.0-only
+/*
+ * Machine Learning (ML) library
+ *
+ * Copyright (C) 2025-2026 Viacheslav Dubeyko <slava@dubeyko.com>
+ */
+
+#ifndef _LINUX_ML_LIB_AGGREGATE_H
+#define _LINUX_ML_LIB_AGGREGATE_H
+
+/*
+ * struct ml_lib_aggregate_ops - implementation of aggregation kernels
+ * @name: name of implementation
+ * @fpu: kernels require kernel_fpu_begin()/kernel_fpu_end()
+ * @columns: accumulate per-column sum, minimum and maximum of records
+ * @dot_s8: dot product of int8 vectors
+ */
+struct ml_lib_aggregate_ops {
+	const char *name;
+	bool fpu;
+
+	void (*columns)(const s64 *records, u32 nr_records, u32 nr_features,
+			s64 *sum, s64 *min, s64 *max);
+	s32 (*dot_s8)(const s8 *a, const s8 *b, u32 count);
+};
+
+#ifdef CONFIG_ARCH_HAS_KERNEL_FPU_SUPPORT
+extern const struct ml_lib_aggregate_ops ml_lib_aggregate_simd128_ops;
+#ifdef CONFIG_X86
+extern const struct ml_lib_aggregate_ops ml_lib_aggregate_avx2_ops;
+#endif /* CONFIG_X86 */
+#endif /* CONFIG_ARCH_HAS_KERNEL_FPU_SUPPORT */
+
+void ml_lib_aggregate_init(void);
+const char *ml_lib_aggregate_kernel(void);
+void ml_lib_aggregate_columns(const s64 *records, u32 nr_records,
+			      u32 nr_features,
+			      s64 *sum, s64 *min, s64 *max);
+void ml_lib_gemv_s8(const s8 *weights, const s32 *bias, const s8 *x,
+		    u32 in_size, u32 out_size, s32 *y);
+void ml_lib_log2_histogram(const s64 *records, u32 nr_records,
+			   u32 nr_features, u64 *histogram);
+
+#endif /* _LINUX_ML_LIB_AGGREGATE_H */
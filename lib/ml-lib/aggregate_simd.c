@@ -0,0 +1,115 @@
+// SPDX-License-Identifier: GPL-2.0-only
+/*
+ * Machine Learning (ML) library
+ *
+ * Copyright (C) 2025-2026 Viacheslav Dubeyko <slava@dubeyko.com>
+ */
+
+#include <linux/kernel.h>
+#include <linux/types.h>
+
+#include "aggregate.h"
+
+/*
+ * The vectorized aggregation kernels. This file is compiled with
+ * CC_FLAGS_FPU, so the kernels can be called only between
+ * kernel_fpu_begin() and kernel_fpu_end(). The kernels are written
+ * by means of generic vector extensions of compiler. As a result,
+ * the same code is compiled into SSE2 or NEON instructions (128-bit
+ * vectors) and into AVX2 instructions (256-bit vectors) on x86.
+ *
+ * The columns kernel is vectorized across the features of record,
+ * so every vector accumulates several columns. The features that
+ * don't fill the whole vector are aggregated by scalar code.
+ *
+ * The dot product kernel loads four int8 values into every 32-bit
+ * lane and sign-extends them by shifts. It doesn't require widening
+ * conversions of vectors that are not supported by old compilers.
+ */
+
+#define ML_LIB_DEFINE_AGGREGATE_KERNELS(impl, vbytes, attr)		\
+typedef s64 impl##_vs64 __attribute__((vector_size(vbytes)));		\
+typedef s32 impl##_vs32 __attribute__((vector_size(vbytes)));		\
+									\
+static attr void							\
+ml_lib_##impl##_columns(const s64 *records, u32 nr_records,		\
+			u32 nr_features,				\
+			s64 *sum, s64 *min, s64 *max)			\
+{									\
+	const u32 lanes = (vbytes) / sizeof(s64);			\
+	u32 i, j = 0;							\
+									\
+	for (; j + lanes <= nr_features; j += lanes) {			\
+		const s64 *in = records + j;				\
+		impl##_vs64 vsum, vmin, vmax, value, mask;		\
+									\
+		__builtin_memcpy(&vsum, sum + j, sizeof(vsum));		\
+		__builtin_memcpy(&vmin, min + j, sizeof(vmin));		\
+		__builtin_memcpy(&vmax, max + j, sizeof(vmax));		\
+									\
+		for (i = 0; i < nr_records; i++, in += nr_features) {	\
+			__builtin_memcpy(&value, in, sizeof(value));	\
+			vsum += value;					\
+			mask = value < vmin;				\
+			vmin = (value & mask) | (vmin & ~mask);		\
+			mask = value > vmax;				\
+			vmax = (value & mask) | (vmax & ~mask);		\
+		}							\
+									\
+		__builtin_memcpy(sum + j, &vsum, sizeof(vsum));		\
+		__builtin_memcpy(min + j, &vmin, sizeof(vmin));		\
+		__builtin_memcpy(max + j, &vmax, sizeof(vmax));		\
+	}								\
+									\
+	for (; j < nr_features; j++) {					\
+		const s64 *in = records + j;				\
+									\
+		for (i = 0; i < nr_records; i++, in += nr_features) {	\
+			sum[j] += *in;					\
+			if (*in < min[j])				\
+				min[j] = *in;				\
+			if (*in > max[j])				\
+				max[j] = *in;				\
+		}							\
+	}								\
+}									\
+									\
+static attr s32								\
+ml_lib_##impl##_dot_s8(const s8 *a, const s8 *b, u32 count)		\
+{									\
+	impl##_vs32 acc = {}, va, vb;					\
+	s32 result = 0;							\
+	u32 i = 0;							\
+	u32 j;								\
+									\
+	for (; i + (vbytes) <= count; i += (vbytes)) {			\
+		__builtin_memcpy(&va, a + i, sizeof(va));		\
+		__builtin_memcpy(&vb, b + i, sizeof(vb));		\
+									\
+		acc += ((va << 24) >> 24) * ((vb << 24) >> 24);		\
+		acc += ((va << 16) >> 24) * ((vb << 16) >> 24);		\
+		acc += ((va << 8) >> 24) * ((vb << 8) >> 24);		\
+		acc += (va >> 24) * (vb >> 24);				\
+	}								\
+									\
+	for (j = 0; j < (vbytes) / sizeof(s32); j++)			\
+		result += acc[j];					\
+									\
+	for (; i < count; i++)						\
+		result += (s32)a[i] * (s32)b[i];			\
+									\
+	return result;							\
+}									\
+									\
+const struct ml_lib_aggregate_ops ml_lib_aggregate_##impl##_ops = {	\
+	.name		= #impl,					\
+	.fpu		= true,						\
+	.columns	= ml_lib_##impl##_columns,			\
+	.dot_s8		= ml_lib_##impl##_dot_s8,			\
+}
+
+ML_LIB_DEFINE_AGGREGATE_KERNELS(simd128, 16, );
+
+#ifdef CONFIG_X86
+ML_LIB_DEFINE_AGGREGATE_KERNELS(avx2, 32, __attribute__((target("avx2"))));
+#endif /* CONFIG_X86 */
@@ -0,0 +1,170 @@
+// SPDX-License-Identifier: GPL-2.0-only
+/*
+ * Machine Learning (ML) library
+ *
+ * Copyright (C) 2025-2026 Viacheslav Dubeyko <slava@dubeyko.com>
+ */
+
+#include <linux/module.h>
+#include <linux/kernel.h>
+#include <linux/bpf.h>
+#include <linux/btf.h>
+#include <linux/btf_ids.h>
+#include <linux/rcupdate.h>
+
+#include <linux/ml-lib/ml_lib.h>
+
+#include "dataset_ring.h"
+#include "bpf_ops.h"
+
+/*
+ * The kfuncs give BPF programs the access to datasets of ML model
+ * without any copy into user-space. The tracing program that is
+ * attached to ml_lib_dataset_publish tracepoint (tp_btf) receives
+ * every published dataset and it can mirror the payload into its
+ * BPF ring buffer by bpf_ml_lib_dataset_read(). The struct_ops and
+ * tracing programs that have the ML model pointer can access
+ * the oldest not discarded dataset of the model.
+ */
+
+static void ml_lib_bpf_fill_dataset_info(struct ml_lib_dataset *dataset,
+					 struct ml_lib_dataset_info *info)
+{
+	info->portion_offset = dataset->portion_offset;
+	info->slot_seq = READ_ONCE(dataset->slot_seq);
+	info->type = atomic_read(&dataset->type);
+	info->portion_size = dataset->portion_size;
+	info->compression = dataset->compression;
+	info->raw_size = dataset->raw_size;
+}
+
+static int ml_lib_bpf_copy_payload(struct ml_lib_model *ml_model,
+				   struct ml_lib_dataset *dataset,
+				   u32 offset, void *dst, u32 size)
+{
+	ssize_t copied;
+
+	copied = ml_lib_dataset_copy_payload(ml_model, dataset,
+					     offset, dst, size);
+	if (copied < 0) {
+		memset(dst, 0, size);
+		return copied;
+	}
+
+	/* BPF program should never see stale bytes of its buffer */
+	if (copied < size)
+		memset((u8 *)dst + copied, 0, size - copied);
+
+	return copied;
+}
+
+__bpf_kfunc_start_defs();
+
+/*
+ * bpf_ml_lib_dataset_read() - read payload of published dataset
+ * @ml_model: ML model object (argument of ml_lib_dataset_publish)
+ * @dataset: dataset object (argument of ml_lib_dataset_publish)
+ * @offset: offset in dataset's payload
+ * @dst: buffer of BPF program
+ * @dst__sz: size of the buffer
+ *
+ * Returns number of copied bytes, zero if @offset is beyond the payload,
+ * -ENODATA if the dataset has no payload, or -ESTALE if the slot of
+ * dataset ring has been overwritten.
+ */
+__bpf_kfunc int bpf_ml_lib_dataset_read(struct ml_lib_model *ml_model,
+					struct ml_lib_dataset *dataset,
+					u32 offset, void *dst, u32 dst__sz)
+{
+	int err;
+
+	rcu_read_lock();
+	err = ml_lib_bpf_copy_payload(ml_model, dataset,
+				      offset, dst, dst__sz);
+	rcu_read_unlock();
+
+	return err;
+}
+
+/*
+ * bpf_ml_lib_model_dataset_info() - get descriptor of current dataset
+ * @ml_model: ML model object
+ * @info: descriptor of the oldest not discarded dataset [out]
+ *
+ * Returns -ENODATA if no dataset is waiting for consumer.
+ */
+__bpf_kfunc int bpf_ml_lib_model_dataset_info(struct ml_lib_model *ml_model,
+					      struct ml_lib_dataset_info *info)
+{
+	struct ml_lib_dataset *dataset;
+	int err = 0;
+
+	rcu_read_lock();
+	dataset = ml_model_peek_dataset(ml_model);
+	if (dataset)
+		ml_lib_bpf_fill_dataset_info(dataset, info);
+	else {
+		memset(info, 0, sizeof(*info));
+		err = -ENODATA;
+	}
+	rcu_read_unlock();
+
+	return err;
+}
+
+/*
+ * bpf_ml_lib_model_dataset_read() - read payload of current dataset
+ * @ml_model: ML model object
+ * @offset: offset in dataset's payload
+ * @dst: buffer of BPF program
+ * @dst__sz: size of the buffer
+ *
+ * The oldest not discarded dataset of @ml_model is read.
+ * The return values are the same as bpf_ml_lib_dataset_read() has.
+ */
+__bpf_kfunc int bpf_ml_lib_model_dataset_read(struct ml_lib_model *ml_model,
+					      u32 offset, void *dst,
+					      u32 dst__sz)
+{
+	struct ml_lib_dataset *dataset;
+	int err;
+
+	rcu_read_lock();
+	dataset = ml_model_peek_dataset(ml_model);
+	if (dataset) {
+		err = ml_lib_bpf_copy_payload(ml_model, dataset,
+					      offset, dst, dst__sz);
+	} else {
+		memset(dst, 0, dst__sz);
+		err = -ENODATA;
+	}
+	rcu_read_unlock();
+
+	return err;
+}
+
+__bpf_kfunc_end_defs();
+
+BTF_KFUNCS_START(ml_lib_kfunc_ids)
+BTF_ID_FLAGS(func, bpf_ml_lib_dataset_read, KF_TRUSTED_ARGS)
+BTF_ID_FLAGS(func, bpf_ml_lib_model_dataset_info, KF_TRUSTED_ARGS)
+BTF_ID_FLAGS(func, bpf_ml_lib_model_dataset_read, KF_TRUSTED_ARGS)
+BTF_KFUNCS_END(ml_lib_kfunc_ids)
+
+static const struct btf_kfunc_id_set ml_lib_kfunc_set = {
+	.owner	= THIS_MODULE,
+	.set	= &ml_lib_kfunc_ids,
+};
+
+int __init ml_lib_bpf_kfuncs_init(void)
+{
+	int err;
+
+	err = register_btf_kfunc_id_set(BPF_PROG_TYPE_TRACING,
+					&ml_lib_kfunc_set);
+	if (err)
+		return err;
+
+	return register_btf_kfunc_id_set(BPF_PROG_TYPE_STRUCT_OPS,
+					 &ml_lib_kfunc_set);
+}
@@ -0,0 +1,354 @@
+// SPDX-License-Identifier: GPL-2.0-only
+/*
+ * Machine Learning (ML) library
+ *
+ * Copyright (C) 2025-2026 Viacheslav Dubeyko <slava@dubeyko.com>
+ */
+
+#include <linux/module.h>
+#include <linux/kernel.h>
+#include <linux/bpf.h>
+#include <linux/bpf_verifier.h>
+#include <linux/btf.h>
+#include <linux/rcupdate.h>
+
+#include <linux/ml-lib/ml_lib.h>
+
+#include "registry.h"
+#include "bpf_ops.h"
+
+/*
+ * BPF struct_ops implementation of selected ML model operations.
+ * The struct_ops map names the ML model (subsystem_name and
+ * model_name), and the registration of the map attaches the BPF
+ * programs to the ML model. The attached callbacks have priority
+ * over the model_ops of kernel subsystem. So, the policy can be
+ * replaced at runtime without reloading of any kernel module:
+ * bpf_link__update_map() swaps the attached callbacks in one step,
+ * so the ML model is never left without the policy.
+ *
+ * The callbacks are called under RCU read lock, and detach waits
+ * for RCU grace period. As a result, the BPF programs are never
+ * freed while they are executed.
+ */
+
+static const struct btf_type *ml_lib_recommendation_type;
+
+static const struct bpf_func_proto *
+ml_lib_bpf_get_func_proto(enum bpf_func_id func_id,
+			  const struct bpf_prog *prog)
+{
+	return bpf_base_func_proto(func_id, prog);
+}
+
+static bool ml_lib_bpf_is_valid_access(int off, int size,
+				       enum bpf_access_type type,
+				       const struct bpf_prog *prog,
+				       struct bpf_insn_access_aux *info)
+{
+	return bpf_tracing_btf_ctx_access(off, size, type, prog, info);
+}
+
+/* BPF program can fill the recommendation except its request ID */
+static int ml_lib_bpf_btf_struct_access(struct bpf_verifier_log *log,
+					const struct bpf_reg_state *reg,
+					int off, int size)
+{
+	const struct btf_type *t;
+	size_t request_id_off;
+	size_t request_id_end;
+
+	t = btf_type_by_id(reg->btf, reg->btf_id);
+	if (t != ml_lib_recommendation_type) {
+		bpf_log(log, "only read is supported\n");
+		return -EACCES;
+	}
+
+	request_id_off = offsetof(struct ml_lib_user_space_recommendation,
+				  request_id);
+	request_id_end = offsetofend(struct ml_lib_user_space_recommendation,
+				     request_id);
+
+	if (off < 0 || off + size > sizeof(struct ml_lib_user_space_recommendation) ||
+	    (off < request_id_end && off + size > request_id_off)) {
+		bpf_log(log,
+			"no write support to ml_lib_user_space_recommendation at off %d\n",
+			off);
+		return -EACCES;
+	}
+
+	return 0;
+}
+
+static const struct bpf_verifier_ops ml_lib_bpf_verifier_ops = {
+	.get_func_proto		= ml_lib_bpf_get_func_proto,
+	.is_valid_access	= ml_lib_bpf_is_valid_access,
+	.btf_struct_access	= ml_lib_bpf_btf_struct_access,
+};
+
+static int ml_lib_bpf_ops_init(struct btf *btf)
+{
+	s32 type_id;
+
+	type_id = btf_find_by_name_kind(btf, "ml_lib_user_space_recommendation",
+					BTF_KIND_STRUCT);
+	if (type_id < 0)
+		return -EINVAL;
+
+	ml_lib_recommendation_type = btf_type_by_id(btf, type_id);
+
+	return 0;
+}
+
+static int ml_lib_bpf_ops_init_member(const struct btf_type *t,
+				      const struct btf_member *member,
+				      void *kdata, const void *udata)
+{
+	const struct ml_lib_bpf_ops *uops = udata;
+	struct ml_lib_bpf_ops *ops = kdata;
+	u32 moff = __btf_member_bit_offset(t, member) / 8;
+
+	switch (moff) {
+	case offsetof(struct ml_lib_bpf_ops, subsystem_name):
+		if (bpf_obj_name_cpy(ops->subsystem_name, uops->subsystem_name,
+				     sizeof(ops->subsystem_name)) <= 0)
+			return -EINVAL;
+		return 1;
+
+	case offsetof(struct ml_lib_bpf_ops, model_name):
+		if (bpf_obj_name_cpy(ops->model_name, uops->model_name,
+				     sizeof(ops->model_name)) <= 0)
+			return -EINVAL;
+		return 1;
+	}
+
+	return 0;
+}
+
+static int ml_lib_bpf_ops_attach(struct ml_lib_model *ml_model, void *data)
+{
+	struct ml_lib_bpf_ops *ops = data;
+	int err = 0;
+
+	spin_lock(&ml_model->options_lock);
+	if (rcu_access_pointer(ml_model->bpf_ops))
+		err = -EBUSY;
+	else
+		rcu_assign_pointer(ml_model->bpf_ops, ops);
+	spin_unlock(&ml_model->options_lock);
+
+	return err;
+}
+
+static int ml_lib_bpf_ops_detach(struct ml_lib_model *ml_model, void *data)
+{
+	struct ml_lib_bpf_ops *ops = data;
+	bool detached = false;
+
+	spin_lock(&ml_model->options_lock);
+	if (rcu_access_pointer(ml_model->bpf_ops) == ops) {
+		rcu_assign_pointer(ml_model->bpf_ops, NULL);
+		detached = true;
+	}
+	spin_unlock(&ml_model->options_lock);
+
+	if (detached)
+		synchronize_rcu();
+
+	return 0;
+}
+
+struct ml_lib_bpf_ops_swap {
+	struct ml_lib_bpf_ops *new_ops;
+	struct ml_lib_bpf_ops *old_ops;
+};
+
+static int ml_lib_bpf_ops_replace(struct ml_lib_model *ml_model, void *data)
+{
+	struct ml_lib_bpf_ops_swap *swap = data;
+	int err = 0;
+
+	spin_lock(&ml_model->options_lock);
+	if (rcu_access_pointer(ml_model->bpf_ops) != swap->old_ops)
+		err = -ENOENT;
+	else
+		rcu_assign_pointer(ml_model->bpf_ops, swap->new_ops);
+	spin_unlock(&ml_model->options_lock);
+
+	if (!err)
+		synchronize_rcu();
+
+	return err;
+}
+
+static int ml_lib_bpf_ops_reg(void *kdata, struct bpf_link *link)
+{
+	struct ml_lib_bpf_ops *ops = kdata;
+	int err;
+
+	err = ml_lib_model_registry_call(ops->subsystem_name, ops->model_name,
+					 ml_lib_bpf_ops_attach, ops);
+	if (err) {
+		pr_err("ml_lib: failed to attach BPF ops: "
+			"subsystem %s, model %s, err %d\n",
+			ops->subsystem_name, ops->model_name, err);
+	}
+
+	return err;
+}
+
+static void ml_lib_bpf_ops_unreg(void *kdata, struct bpf_link *link)
+{
+	struct ml_lib_bpf_ops *ops = kdata;
+
+	/* the ML model could be destroyed already */
+	ml_lib_model_registry_call(ops->subsystem_name, ops->model_name,
+				   ml_lib_bpf_ops_detach, ops);
+}
+
+/* the new policy has to name the ML model of the replaced one */
+static int ml_lib_bpf_ops_update(void *kdata, void *old_kdata,
+				 struct bpf_link *link)
+{
+	struct ml_lib_bpf_ops_swap swap = {
+		.new_ops = kdata,
+		.old_ops = old_kdata,
+	};
+	int err;
+
+	if (strcmp(swap.new_ops->subsystem_name,
+		   swap.old_ops->subsystem_name) ||
+	    strcmp(swap.new_ops->model_name, swap.old_ops->model_name))
+		return -EINVAL;
+
+	err = ml_lib_model_registry_call(swap.new_ops->subsystem_name,
+					 swap.new_ops->model_name,
+					 ml_lib_bpf_ops_replace, &swap);
+	if (err) {
+		pr_err("ml_lib: failed to update BPF ops: "
+			"subsystem %s, model %s, err %d\n",
+			swap.new_ops->subsystem_name,
+			swap.new_ops->model_name, err);
+	}
+
+	return err;
+}
+
+static int ml_lib_bpf_ops_validate(void *kdata)
+{
+	struct ml_lib_bpf_ops *ops = kdata;
+
+	if (!ops->subsystem_name[0] || !ops->model_name[0])
+		return -EINVAL;
+
+	return 0;
+}
+
+static int ml_lib_bpf_estimate_system_state__stub(struct ml_lib_model *ml_model)
+{
+	return -EOPNOTSUPP;
+}
+
+static int
+ml_lib_bpf_apply_recommendation__stub(struct ml_lib_model *ml_model,
+			struct ml_lib_user_space_recommendation *hint)
+{
+	return -EOPNOTSUPP;
+}
+
+static int
+ml_lib_bpf_estimate_efficiency__stub(struct ml_lib_model *ml_model,
+			struct ml_lib_user_space_recommendation *hint,
+			struct ml_lib_user_space_request *request)
+{
+	return -EOPNOTSUPP;
+}
+
+static struct ml_lib_bpf_ops __bpf_ops_ml_lib_bpf_ops = {
+	.estimate_system_state	= ml_lib_bpf_estimate_system_state__stub,
+	.apply_recommendation	= ml_lib_bpf_apply_recommendation__stub,
+	.estimate_efficiency	= ml_lib_bpf_estimate_efficiency__stub,
+};
+
+static struct bpf_struct_ops bpf_ml_lib_bpf_ops = {
+	.verifier_ops	= &ml_lib_bpf_verifier_ops,
+	.init		= ml_lib_bpf_ops_init,
+	.init_member	= ml_lib_bpf_ops_init_member,
+	.reg		= ml_lib_bpf_ops_reg,
+	.unreg		= ml_lib_bpf_ops_unreg,
+	.update		= ml_lib_bpf_ops_update,
+	.validate	= ml_lib_bpf_ops_validate,
+	.cfi_stubs	= &__bpf_ops_ml_lib_bpf_ops,
+	.name		= "ml_lib_bpf_ops",
+	.owner		= THIS_MODULE,
+};
+
+bool ml_lib_bpf_estimate_system_state(struct ml_lib_model *ml_model,
+				      int *ret)
+{
+	struct ml_lib_bpf_ops *ops;
+	bool handled = false;
+
+	rcu_read_lock();
+	ops = rcu_dereference(ml_model->bpf_ops);
+	if (ops && ops->estimate_system_state) {
+		*ret = ops->estimate_system_state(ml_model);
+		handled = true;
+	}
+	rcu_read_unlock();
+
+	return handled;
+}
+
+bool ml_lib_bpf_apply_recommendation(struct ml_lib_model *ml_model,
+			struct ml_lib_user_space_recommendation *hint,
+			int *ret)
+{
+	struct ml_lib_bpf_ops *ops;
+	bool handled = false;
+
+	rcu_read_lock();
+	ops = rcu_dereference(ml_model->bpf_ops);
+	if (ops && ops->apply_recommendation) {
+		*ret = ops->apply_recommendation(ml_model, hint);
+		handled = true;
+	}
+	rcu_read_unlock();
+
+	return handled;
+}
+
+bool ml_lib_bpf_estimate_efficiency(struct ml_lib_model *ml_model,
+			struct ml_lib_user_space_recommendation *hint,
+			struct ml_lib_user_space_request *request,
+			int *ret)
+{
+	struct ml_lib_bpf_ops *ops;
+	bool handled = false;
+
+	rcu_read_lock();
+	ops = rcu_dereference(ml_model->bpf_ops);
+	if (ops && ops->estimate_efficiency) {
+		*ret = ops->estimate_efficiency(ml_model, hint, request);
+		handled = true;
+	}
+	rcu_read_unlock();
+
+	return handled;
+}
+
+void ml_lib_bpf_detach(struct ml_lib_model *ml_model)
+{
+	ml_lib_bpf_ops_detach(ml_model, rcu_access_pointer(ml_model->bpf_ops));
+}
+
+int __init ml_lib_bpf_init(void)
+{
+	int err;
+
+	err = ml_lib_bpf_kfuncs_init();
+	if (err)
+		return err;
+
+	return register_bpf_struct_ops(&bpf_ml_lib_bpf_ops, ml_lib_bpf_ops);
+}
@@ -0,0 +1,64 @@
+// SPDX-License-Identifier: GPL-2.0-only
+/*
+ * Machine Learning (ML) library
+ *
+ * Copyright (C) 2025-2026 Viacheslav Dubeyko <slava@dubeyko.com>
+ */
+
+#ifndef _LINUX_ML_LIB_BPF_OPS_H
+#define _LINUX_ML_LIB_BPF_OPS_H
+
+/*
+ * The methods return true if the operation has been executed
+ * by attached BPF program. The result of BPF program is @ret.
+ */
+
+#ifdef CONFIG_ML_LIB_BPF
+int ml_lib_bpf_init(void);
+int ml_lib_bpf_kfuncs_init(void);
+void ml_lib_bpf_detach(struct ml_lib_model *ml_model);
+bool ml_lib_bpf_estimate_system_state(struct ml_lib_model *ml_model,
+				      int *ret);
+bool ml_lib_bpf_apply_recommendation(struct ml_lib_model *ml_model,
+			struct ml_lib_user_space_recommendation *hint,
+			int *ret);
+bool ml_lib_bpf_estimate_efficiency(struct ml_lib_model *ml_model,
+			struct ml_lib_user_space_recommendation *hint,
+			struct ml_lib_user_space_request *request,
+			int *ret);
+#else
+static inline int ml_lib_bpf_init(void)
+{
+	return 0;
+}
+
+static inline void ml_lib_bpf_detach(struct ml_lib_model *ml_model)
+{
+}
+
+static inline
+bool ml_lib_bpf_estimate_system_state(struct ml_lib_model *ml_model,
+				      int *ret)
+{
+	return false;
+}
+
+static inline
+bool ml_lib_bpf_apply_recommendation(struct ml_lib_model *ml_model,
+			struct ml_lib_user_space_recommendation *hint,
+			int *ret)
+{
+	return false;
+}
+
+static inline
+bool ml_lib_bpf_estimate_efficiency(struct ml_lib_model *ml_model,
+			struct ml_lib_user_space_recommendation *hint,
+			struct ml_lib_user_space_request *request,
+			int *ret)
+{
+	return false;
+}
+#endif /* CONFIG_ML_LIB_BPF */
+
+#endif /* _LINUX_ML_LIB_BPF_OPS_H */
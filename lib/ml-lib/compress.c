@@ -0,0 +1,202 @@
+// SPDX-License-Identifier: GPL-2.0-only
+/*
+ * Machine Learning (ML) library
+ *
+ * Copyright (C) 2025-2026 Viacheslav Dubeyko <slava@dubeyko.com>
+ */
+
+#include <linux/module.h>
+#include <linux/kernel.h>
+#include <linux/slab.h>
+#include <linux/mm.h>
+#include <linux/string.h>
+#include <linux/lz4.h>
+#include <linux/zstd.h>
+
+#include <linux/ml-lib/ml_lib.h>
+
+#include "compress.h"
+
+/*
+ * The portion is compressed into the scratch buffer and copied
+ * back in place only if it has become smaller. As a result,
+ * the compressed portion never needs more space than the raw one
+ * and incompressible portions are published as is.
+ *
+ * The compressor isn't reentrant: the caller serializes the calls.
+ */
+
+#define ML_LIB_ZSTD_LEVEL		(1)
+#define ML_LIB_ZSTD_ESTIMATED_SIZE	(128 * 1024)
+
+/*
+ * struct ml_lib_compressor - dataset compressor
+ * @algorithm: compression algorithm (ML_LIB_*_COMPRESSION)
+ * @workspace: working memory of compression algorithm
+ * @cctx: zstd compression context (lives in @workspace)
+ * @params: zstd compression parameters
+ * @scratch: buffer of compressed data
+ * @scratch_size: capacity of scratch buffer
+ */
+struct ml_lib_compressor {
+	u32 algorithm;
+	void *workspace;
+	zstd_cctx *cctx;
+	zstd_parameters params;
+	u8 *scratch;
+	size_t scratch_size;
+};
+
+struct ml_lib_compressor *ml_lib_compressor_create(u32 algorithm)
+{
+	struct ml_lib_compressor *compressor;
+	size_t workspace_size;
+
+	compressor = kzalloc(sizeof(struct ml_lib_compressor), GFP_KERNEL);
+	if (!compressor)
+		return ERR_PTR(-ENOMEM);
+
+	compressor->algorithm = algorithm;
+
+	switch (algorithm) {
+	case ML_LIB_LZ4_COMPRESSION:
+		compressor->workspace = kvmalloc(LZ4_MEM_COMPRESS, GFP_KERNEL);
+		if (!compressor->workspace)
+			goto fail_create_compressor;
+		break;
+
+	case ML_LIB_ZSTD_COMPRESSION:
+		compressor->params = zstd_get_params(ML_LIB_ZSTD_LEVEL,
+						ML_LIB_ZSTD_ESTIMATED_SIZE);
+		workspace_size =
+			zstd_cctx_workspace_bound(&compressor->params.cParams);
+		compressor->workspace = kvmalloc(workspace_size, GFP_KERNEL);
+		if (!compressor->workspace)
+			goto fail_create_compressor;
+
+		compressor->cctx = zstd_init_cctx(compressor->workspace,
+						  workspace_size);
+		if (!compressor->cctx)
+			goto fail_create_compressor;
+		break;
+
+	default:
+		kfree(compressor);
+		return ERR_PTR(-EOPNOTSUPP);
+	}
+
+	return compressor;
+
+fail_create_compressor:
+	kvfree(compressor->workspace);
+	kfree(compressor);
+	return ERR_PTR(-ENOMEM);
+}
+
+void ml_lib_compressor_destroy(struct ml_lib_compressor *compressor)
+{
+	if (!compressor)
+		return;
+
+	kvfree(compressor->scratch);
+	kvfree(compressor->workspace);
+	kfree(compressor);
+}
+
+u32 ml_lib_compressor_algorithm(struct ml_lib_compressor *compressor)
+{
+	if (!compressor)
+		return ML_LIB_NO_COMPRESSION;
+
+	return compressor->algorithm;
+}
+
+static size_t ml_lib_compress_bound(u32 algorithm, u32 size)
+{
+	switch (algorithm) {
+	case ML_LIB_LZ4_COMPRESSION:
+		return LZ4_compressBound(size);
+
+	case ML_LIB_ZSTD_COMPRESSION:
+		return zstd_compress_bound(size);
+	}
+
+	return size;
+}
+
+static int ml_lib_compressor_reserve(struct ml_lib_compressor *compressor,
+				     size_t size)
+{
+	u8 *scratch;
+
+	if (compressor->scratch_size >= size)
+		return 0;
+
+	scratch = kvmalloc(size, GFP_KERNEL);
+	if (!scratch)
+		return -ENOMEM;
+
+	kvfree(compressor->scratch);
+	compressor->scratch = scratch;
+	compressor->scratch_size = size;
+
+	return 0;
+}
+
+/*
+ * ml_lib_compressor_compress() - compress buffer in place
+ * @compressor: dataset compressor
+ * @buf: buffer with raw data
+ * @size: number of raw bytes in the buffer
+ * @compressed_size: pointer on number of compressed bytes [out]
+ *
+ * Returns -E2BIG if the data is incompressible. The buffer
+ * is untouched in the case of any error.
+ */
+int ml_lib_compressor_compress(struct ml_lib_compressor *compressor,
+			       void *buf, u32 size, u32 *compressed_size)
+{
+	size_t bound;
+	size_t res;
+	int err;
+
+	if (!compressor || !buf || !compressed_size)
+		return -EINVAL;
+
+	if (size == 0)
+		return -E2BIG;
+
+	bound = ml_lib_compress_bound(compressor->algorithm, size);
+	err = ml_lib_compressor_reserve(compressor, bound);
+	if (unlikely(err))
+		return err;
+
+	switch (compressor->algorithm) {
+	case ML_LIB_LZ4_COMPRESSION:
+		res = LZ4_compress_default(buf, (char *)compressor->scratch,
+					   size, bound,
+					   compressor->workspace);
+		if (res == 0)
+			return -E2BIG;
+		break;
+
+	case ML_LIB_ZSTD_COMPRESSION:
+		res = zstd_compress_cctx(compressor->cctx,
+					 compressor->scratch, bound,
+					 buf, size, &compressor->params);
+		if (zstd_is_error(res))
+			return -EIO;
+		break;
+
+	default:
+		return -EOPNOTSUPP;
+	}
+
+	if (res >= size)
+		return -E2BIG;
+
+	memcpy(buf, compressor->scratch, res);
+	*compressed_size = res;
+
+	return 0;
+}
@@ -0,0 +1,19 @@
+// SPDX-License-Identifier: GPL-2.0-only
+/*
+ * Machine Learning (ML) library
+ *
+ * Copyright (C) 2025-2026 Viacheslav Dubeyko <slava@dubeyko.com>
+ */
+
+#ifndef _LINUX_ML_LIB_COMPRESS_H
+#define _LINUX_ML_LIB_COMPRESS_H
+
+struct ml_lib_compressor;
+
+struct ml_lib_compressor *ml_lib_compressor_create(u32 algorithm);
+void ml_lib_compressor_destroy(struct ml_lib_compressor *compressor);
+u32 ml_lib_compressor_algorithm(struct ml_lib_compressor *compressor);
+int ml_lib_compressor_compress(struct ml_lib_compressor *compressor,
+			       void *buf, u32 size, u32 *compressed_size);
+
+#endif /* _LINUX_ML_LIB_COMPRESS_H */
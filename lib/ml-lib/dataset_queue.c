@@ -0,0 +1,226 @@
+// SPDX-License-Identifier: GPL-2.0-only
+/*
+ * Machine Learning (ML) library
+ *
+ * Copyright (C) 2025-2026 Viacheslav Dubeyko <slava@dubeyko.com>
+ */
+
+#include <linux/module.h>
+#include <linux/kernel.h>
+#include <linux/slab.h>
+#include <linux/log2.h>
+#include <linux/atomic.h>
+#include <linux/cache.h>
+
+#include <linux/ml-lib/ml_lib.h>
+
+#include "dataset_queue.h"
+
+/*
+ * The dataset queue is a bounded lock-free MPMC ring of dataset
+ * descriptors. Every cell keeps a sequence number that defines
+ * who (producer or consumer) owns the cell at the moment:
+ * (1) seq == pos - the cell is free for the producer of @pos;
+ * (2) seq == pos + 1 - the cell contains dataset for the consumer
+ *                      of @pos.
+ * Producers and consumers claim positions by cmpxchg on @head and
+ * @tail correspondingly, so they never wait for each other.
+ */
+
+/*
+ * struct ml_lib_dataset_queue_cell - dataset queue's cell
+ * @seq: sequence number of the cell
+ * @dataset: dataset descriptor
+ */
+struct ml_lib_dataset_queue_cell {
+	atomic_long_t seq;
+	struct ml_lib_dataset *dataset;
+};
+
+/*
+ * struct ml_lib_dataset_queue - dataset queue
+ * @depth: number of cells (power of two)
+ * @mask: cell index mask
+ * @head: position of the next enqueue
+ * @tail: position of the next dequeue
+ * @cells: array of cells
+ */
+struct ml_lib_dataset_queue {
+	u32 depth;
+	u32 mask;
+
+	atomic_long_t head ____cacheline_aligned_in_smp;
+	atomic_long_t tail ____cacheline_aligned_in_smp;
+
+	struct ml_lib_dataset_queue_cell cells[] ____cacheline_aligned_in_smp;
+};
+
+struct ml_lib_dataset_queue *ml_lib_dataset_queue_alloc(u32 depth, gfp_t gfp)
+{
+	struct ml_lib_dataset_queue *queue;
+	u32 i;
+
+	if (depth == 0 || depth > ML_LIB_DATASET_QUEUE_DEPTH_MAX)
+		return ERR_PTR(-EINVAL);
+
+	depth = roundup_pow_of_two(depth);
+
+	queue = kzalloc(struct_size(queue, cells, depth), gfp);
+	if (unlikely(!queue))
+		return ERR_PTR(-ENOMEM);
+
+	queue->depth = depth;
+	queue->mask = depth - 1;
+	atomic_long_set(&queue->head, 0);
+	atomic_long_set(&queue->tail, 0);
+
+	for (i = 0; i < depth; i++)
+		atomic_long_set(&queue->cells[i].seq, i);
+
+	return queue;
+}
+
+void ml_lib_dataset_queue_free(struct ml_lib_dataset_queue *queue)
+{
+	kfree(queue);
+}
+
+/*
+ * ml_lib_dataset_queue_reserve() - claim the cell for enqueue
+ * @queue: dataset queue
+ * @pos: position of the claimed cell [out]
+ *
+ * The claimed cell cannot be released, so the producer should
+ * publish the dataset by ml_lib_dataset_queue_publish() without
+ * any failure point in between. The consumers see the queue
+ * as empty at @pos until the publication.
+ *
+ * Return: 0 on success, -ENOSPC if the queue is full.
+ */
+int ml_lib_dataset_queue_reserve(struct ml_lib_dataset_queue *queue,
+				 long *pos)
+{
+	struct ml_lib_dataset_queue_cell *cell;
+	long head = atomic_long_read(&queue->head);
+	long diff;
+
+	for (;;) {
+		cell = &queue->cells[head & queue->mask];
+		diff = atomic_long_read_acquire(&cell->seq) - head;
+
+		if (diff == 0) {
+			if (atomic_long_try_cmpxchg_relaxed(&queue->head,
+							    &head, head + 1))
+				break;
+		} else if (diff < 0) {
+			return -ENOSPC;
+		} else
+			head = atomic_long_read(&queue->head);
+	}
+
+	*pos = head;
+
+	return 0;
+}
+
+void ml_lib_dataset_queue_publish(struct ml_lib_dataset_queue *queue,
+				  long pos, struct ml_lib_dataset *dataset)
+{
+	struct ml_lib_dataset_queue_cell *cell = &queue->cells[pos & queue->mask];
+
+	WRITE_ONCE(cell->dataset, dataset);
+	atomic_long_set_release(&cell->seq, pos + 1);
+}
+
+/*
+ * ml_lib_dataset_queue_push() - enqueue dataset
+ * @queue: dataset queue
+ * @dataset: dataset descriptor
+ *
+ * Return: 0 on success, -ENOSPC if the queue is full.
+ */
+int ml_lib_dataset_queue_push(struct ml_lib_dataset_queue *queue,
+			      struct ml_lib_dataset *dataset)
+{
+	long pos;
+	int err;
+
+	err = ml_lib_dataset_queue_reserve(queue, &pos);
+	if (err)
+		return err;
+
+	ml_lib_dataset_queue_publish(queue, pos, dataset);
+
+	return 0;
+}
+
+/*
+ * ml_lib_dataset_queue_pop() - dequeue the oldest dataset
+ * @queue: dataset queue
+ *
+ * Return: dataset descriptor or NULL if the queue is empty.
+ */
+struct ml_lib_dataset *
+ml_lib_dataset_queue_pop(struct ml_lib_dataset_queue *queue)
+{
+	struct ml_lib_dataset_queue_cell *cell;
+	struct ml_lib_dataset *dataset;
+	long pos = atomic_long_read(&queue->tail);
+	long diff;
+
+	for (;;) {
+		cell = &queue->cells[pos & queue->mask];
+		diff = atomic_long_read_acquire(&cell->seq) - (pos + 1);
+
+		if (diff == 0) {
+			if (atomic_long_try_cmpxchg_relaxed(&queue->tail,
+							    &pos, pos + 1))
+				break;
+		} else if (diff < 0) {
+			return NULL;
+		} else
+			pos = atomic_long_read(&queue->tail);
+	}
+
+	dataset = READ_ONCE(cell->dataset);
+	atomic_long_set_release(&cell->seq, pos + queue->depth);
+
+	return dataset;
+}
+
+/*
+ * ml_lib_dataset_queue_peek() - get the oldest dataset without dequeue
+ * @queue: dataset queue
+ *
+ * The returned dataset can be dequeued concurrently. The caller
+ * should be in RCU read-side critical section because dequeued
+ * datasets are freed after the grace period.
+ */
+struct ml_lib_dataset *
+ml_lib_dataset_queue_peek(struct ml_lib_dataset_queue *queue)
+{
+	struct ml_lib_dataset_queue_cell *cell;
+	long pos = atomic_long_read(&queue->tail);
+
+	cell = &queue->cells[pos & queue->mask];
+	if (atomic_long_read_acquire(&cell->seq) != pos + 1)
+		return NULL;
+
+	return READ_ONCE(cell->dataset);
+}
+
+u32 ml_lib_dataset_queue_count(struct ml_lib_dataset_queue *queue)
+{
+	long tail = atomic_long_read(&queue->tail);
+	long head = atomic_long_read(&queue->head);
+
+	if (head <= tail)
+		return 0;
+
+	return min_t(long, head - tail, queue->depth);
+}
+
+u32 ml_lib_dataset_queue_depth(struct ml_lib_dataset_queue *queue)
+{
+	return queue->depth;
+}
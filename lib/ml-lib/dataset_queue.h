@@ -0,0 +1,31 @@
+// SPDX-License-Identifier: GPL-2.0-only
+/*
+ * Machine Learning (ML) library
+ *
+ * Copyright (C) 2025-2026 Viacheslav Dubeyko <slava@dubeyko.com>
+ */
+
+#ifndef _LINUX_ML_LIB_DATASET_QUEUE_H
+#define _LINUX_ML_LIB_DATASET_QUEUE_H
+
+#define ML_LIB_DATASET_QUEUE_DEPTH_MAX		(4096)
+
+struct ml_lib_dataset_queue *ml_lib_dataset_queue_alloc(u32 depth, gfp_t gfp);
+void ml_lib_dataset_queue_free(struct ml_lib_dataset_queue *queue);
+int ml_lib_dataset_queue_reserve(struct ml_lib_dataset_queue *queue,
+				 long *pos);
+void ml_lib_dataset_queue_publish(struct ml_lib_dataset_queue *queue,
+				  long pos, struct ml_lib_dataset *dataset);
+int ml_lib_dataset_queue_push(struct ml_lib_dataset_queue *queue,
+			      struct ml_lib_dataset *dataset);
+struct ml_lib_dataset *
+ml_lib_dataset_queue_pop(struct ml_lib_dataset_queue *queue);
+struct ml_lib_dataset *
+ml_lib_dataset_queue_peek(struct ml_lib_dataset_queue *queue);
+u32 ml_lib_dataset_queue_count(struct ml_lib_dataset_queue *queue);
+u32 ml_lib_dataset_queue_depth(struct ml_lib_dataset_queue *queue);
+ssize_t ml_lib_dataset_fetch(struct ml_lib_model *ml_model,
+			     char __user *buf, size_t count,
+			     bool keep, bool nowait, u32 *size);
+
+#endif /* _LINUX_ML_LIB_DATASET_QUEUE_H */
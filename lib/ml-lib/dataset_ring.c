@@ -0,0 +1,400 @@
+// SPDX-License-Identifier: GPL-2.0-only
+/*
+ * Machine Learning (ML) library
+ *
+ * Copyright (C) 2025-2026 Viacheslav Dubeyko <slava@dubeyko.com>
+ */
+
+#include <linux/module.h>
+#include <linux/kernel.h>
+#include <linux/mm.h>
+#include <linux/vmalloc.h>
+#include <linux/slab.h>
+#include <linux/mutex.h>
+#include <linux/overflow.h>
+#include <linux/uaccess.h>
+
+#include <linux/ml-lib/ml_lib.h>
+
+#include "dataset_ring.h"
+
+/*
+ * struct ml_lib_dataset_ring - mmap'able ring of dataset portions
+ * @area: vmalloc_user() area shared with user-space
+ * @area_size: size of the area in bytes
+ * @ctrl: control page (the first page of the area)
+ * @nr_slots: number of slots in the ring
+ * @slot_size: size of one slot in bytes (header + payload)
+ * @capacity: payload capacity of one slot
+ * @producer_lock: serializes the producers
+ * @reserved: index of the reserved slot
+ */
+struct ml_lib_dataset_ring {
+	void *area;
+	size_t area_size;
+	struct ml_lib_dataset_ring_ctrl *ctrl;
+
+	u32 nr_slots;
+	u32 slot_size;
+	u32 capacity;
+
+	struct mutex producer_lock;
+	u64 reserved;
+};
+
+static inline
+struct ml_lib_dataset_slot *
+ml_lib_dataset_ring_slot(struct ml_lib_dataset_ring *ring, u64 index)
+{
+	u32 slot_index = do_div(index, ring->nr_slots);
+
+	return (struct ml_lib_dataset_slot *)((u8 *)ring->area +
+				ring->ctrl->data_offset +
+				(size_t)slot_index * ring->slot_size);
+}
+
+int ml_model_create_dataset_ring(struct ml_lib_model *ml_model,
+				 u32 nr_slots, u32 portion_size)
+{
+	struct ml_lib_dataset_ring *ring;
+	size_t slot_size;
+	size_t data_size;
+	int err;
+
+	if (!ml_model || !nr_slots || !portion_size)
+		return -EINVAL;
+
+	if (ml_model->ring)
+		return -EEXIST;
+
+	slot_size = ALIGN(sizeof(struct ml_lib_dataset_slot) +
+			  (size_t)portion_size, SMP_CACHE_BYTES);
+	if (slot_size > U32_MAX)
+		return -E2BIG;
+
+	if (check_mul_overflow((size_t)nr_slots, slot_size, &data_size))
+		return -E2BIG;
+
+	ring = kzalloc(sizeof(struct ml_lib_dataset_ring), GFP_KERNEL);
+	if (unlikely(!ring))
+		return -ENOMEM;
+
+	ring->area_size = PAGE_SIZE + PAGE_ALIGN(data_size);
+	ring->area = vmalloc_user(ring->area_size);
+	if (unlikely(!ring->area)) {
+		err = -ENOMEM;
+		pr_err("ml_lib: failed to allocate dataset ring: size %zu\n",
+			ring->area_size);
+		goto free_ring;
+	}
+
+	ring->nr_slots = nr_slots;
+	ring->slot_size = slot_size;
+	ring->capacity = slot_size - sizeof(struct ml_lib_dataset_slot);
+	mutex_init(&ring->producer_lock);
+
+	ring->ctrl = (struct ml_lib_dataset_ring_ctrl *)ring->area;
+	ring->ctrl->nr_slots = nr_slots;
+	ring->ctrl->slot_size = slot_size;
+	ring->ctrl->data_offset = PAGE_SIZE;
+	ring->ctrl->head = 0;
+	ring->ctrl->tail = 0;
+
+	ml_model->ring = ring;
+
+	return 0;
+
+free_ring:
+	kfree(ring);
+
+	return err;
+}
+EXPORT_SYMBOL(ml_model_create_dataset_ring);
+
+void ml_model_destroy_dataset_ring(struct ml_lib_model *ml_model)
+{
+	struct ml_lib_dataset_ring *ring;
+
+	if (!ml_model || !ml_model->ring)
+		return;
+
+	ring = ml_model->ring;
+	ml_model->ring = NULL;
+
+	/*
+	 * Pages of existing user-space mappings are pinned
+	 * by remap_vmalloc_range(). They will be freed
+	 * after the last munmap().
+	 */
+	vfree(ring->area);
+	mutex_destroy(&ring->producer_lock);
+	kfree(ring);
+}
+EXPORT_SYMBOL(ml_model_destroy_dataset_ring);
+
+int ml_model_dataset_ring_mmap(struct ml_lib_model *ml_model,
+			       struct vm_area_struct *vma)
+{
+	struct ml_lib_dataset_ring *ring;
+
+	if (!ml_model || !vma)
+		return -EINVAL;
+
+	ring = ml_model->ring;
+	if (!ring)
+		return -ENODEV;
+
+	/* only the producer can modify the ring */
+	if (vma->vm_flags & VM_WRITE)
+		return -EPERM;
+
+	vm_flags_clear(vma, VM_MAYWRITE);
+
+	return remap_vmalloc_range(vma, ring->area, vma->vm_pgoff);
+}
+EXPORT_SYMBOL(ml_model_dataset_ring_mmap);
+
+/*
+ * ml_lib_dataset_ring_reserve() - reserve the next slot of the ring
+ * @ring: dataset ring
+ * @capacity: payload capacity of the slot [out]
+ *
+ * The producer lock is held until ml_lib_dataset_ring_commit()
+ * or ml_lib_dataset_ring_abort() call. The oldest slot is
+ * invalidated before any modification of the payload.
+ */
+void *ml_lib_dataset_ring_reserve(struct ml_lib_dataset_ring *ring,
+				  u32 *capacity)
+{
+	struct ml_lib_dataset_slot *slot;
+	u64 index;
+
+	mutex_lock(&ring->producer_lock);
+
+	index = ring->ctrl->head;
+	slot = ml_lib_dataset_ring_slot(ring, index);
+
+	if (index >= ring->nr_slots)
+		WRITE_ONCE(ring->ctrl->tail, index - ring->nr_slots + 1);
+
+	WRITE_ONCE(slot->seq, 0);
+	/* invalidate the slot before the payload modification */
+	smp_wmb();
+
+	ring->reserved = index;
+	*capacity = ring->capacity;
+
+	return (u8 *)slot + sizeof(struct ml_lib_dataset_slot);
+}
+
+void ml_lib_dataset_ring_commit(struct ml_lib_dataset_ring *ring,
+				struct ml_lib_dataset *dataset)
+{
+	struct ml_lib_dataset_slot *slot;
+	u64 index = ring->reserved;
+
+	slot = ml_lib_dataset_ring_slot(ring, index);
+
+	slot->portion_offset = dataset->portion_offset;
+	slot->portion_size = min_t(u32, dataset->portion_size,
+				   ring->capacity);
+	slot->type = atomic_read(&dataset->type);
+	slot->compression = dataset->compression;
+	if (dataset->compression == ML_LIB_NO_COMPRESSION)
+		slot->raw_size = slot->portion_size;
+	else
+		slot->raw_size = dataset->raw_size;
+
+	dataset->slot_seq = index + 1;
+
+	/* payload and header should be visible before the sequence */
+	smp_store_release(&slot->seq, index + 1);
+	smp_store_release(&ring->ctrl->head, index + 1);
+
+	mutex_unlock(&ring->producer_lock);
+}
+
+void ml_lib_dataset_ring_abort(struct ml_lib_dataset_ring *ring)
+{
+	/* the reserved slot stays invalid */
+	mutex_unlock(&ring->producer_lock);
+}
+
+u32 ml_lib_dataset_ring_nr_slots(struct ml_lib_dataset_ring *ring)
+{
+	return ring->nr_slots;
+}
+
+/* size of bounce buffer of ml_lib_dataset_ring_read() */
+#define ML_LIB_DATASET_BOUNCE_SIZE	PAGE_SIZE
+
+/*
+ * Copy the payload of published slot into user-space buffer.
+ * The slot can be overwritten by producer during the copy, so
+ * the payload is copied by chunks through the bounce buffer and
+ * the sequence number is re-checked before every chunk is given
+ * to user-space. As a result, user-space never receives the data
+ * of overwritten slot. The chunks copied before the overwrite are
+ * reported; the next read returns -ESTALE.
+ */
+static ssize_t ml_lib_dataset_ring_read(struct ml_lib_dataset_ring *ring,
+					u64 seq, char __user *buf,
+					size_t count, loff_t *ppos)
+{
+	struct ml_lib_dataset_slot *slot;
+	u8 *payload;
+	u8 *bounce;
+	u32 portion_size;
+	size_t to_read;
+	size_t copied = 0;
+	size_t chunk;
+	int err = 0;
+
+	slot = ml_lib_dataset_ring_slot(ring, seq - 1);
+	payload = (u8 *)slot + sizeof(struct ml_lib_dataset_slot);
+
+	if (smp_load_acquire(&slot->seq) != seq)
+		return -ESTALE;
+
+	portion_size = READ_ONCE(slot->portion_size);
+	if (*ppos >= portion_size)
+		return 0;
+
+	to_read = min_t(size_t, count, portion_size - *ppos);
+
+	bounce = kmalloc(min_t(size_t, to_read, ML_LIB_DATASET_BOUNCE_SIZE),
+			 GFP_KERNEL);
+	if (unlikely(!bounce))
+		return -ENOMEM;
+
+	while (copied < to_read) {
+		chunk = min_t(size_t, to_read - copied,
+			      ML_LIB_DATASET_BOUNCE_SIZE);
+
+		memcpy(bounce, payload + *ppos + copied, chunk);
+
+		/* the payload should be read before the sequence re-check */
+		smp_rmb();
+		if (READ_ONCE(slot->seq) != seq) {
+			err = -ESTALE;
+			break;
+		}
+
+		if (copy_to_user(buf + copied, bounce, chunk)) {
+			err = -EFAULT;
+			break;
+		}
+
+		copied += chunk;
+	}
+
+	kfree(bounce);
+
+	if (!copied)
+		return err;
+
+	*ppos += copied;
+
+	return copied;
+}
+
+/*
+ * ml_lib_dataset_copy_payload() - copy dataset's payload into kernel buffer
+ * @ml_model: ML model object
+ * @dataset: dataset object
+ * @offset: offset in dataset's payload
+ * @dst: kernel buffer
+ * @size: size of kernel buffer
+ *
+ * The caller should be in RCU read-side critical section, so
+ * the dataset cannot be reclaimed during the copy. The published
+ * slot of the ring is checked by its sequence number like
+ * ml_lib_dataset_ring_read() does. Returns number of copied bytes,
+ * zero if @offset is beyond the payload, -ENODATA if the dataset
+ * has no payload, or -ESTALE if the slot has been overwritten.
+ */
+ssize_t ml_lib_dataset_copy_payload(struct ml_lib_model *ml_model,
+				    struct ml_lib_dataset *dataset,
+				    u32 offset, void *dst, u32 size)
+{
+	struct ml_lib_dataset_ring *ring = ml_model->ring;
+	struct ml_lib_dataset_slot *slot;
+	u64 seq = READ_ONCE(dataset->slot_seq);
+	u32 portion_size;
+	size_t to_copy;
+	u8 *payload;
+
+	if (atomic_read(&dataset->type) != ML_LIB_MEMORY_STREAM_DATASET)
+		return -ENODATA;
+
+	if (!seq || !ring) {
+		if (!dataset->payload)
+			return -ENODATA;
+
+		if (offset >= dataset->portion_size)
+			return 0;
+
+		to_copy = min_t(size_t, size, dataset->portion_size - offset);
+		memcpy(dst, (u8 *)dataset->payload + offset, to_copy);
+
+		return to_copy;
+	}
+
+	slot = ml_lib_dataset_ring_slot(ring, seq - 1);
+	payload = (u8 *)slot + sizeof(struct ml_lib_dataset_slot);
+
+	if (smp_load_acquire(&slot->seq) != seq)
+		return -ESTALE;
+
+	portion_size = READ_ONCE(slot->portion_size);
+	if (offset >= portion_size)
+		return 0;
+
+	to_copy = min_t(size_t, size, portion_size - offset);
+	memcpy(dst, payload + offset, to_copy);
+
+	/* the payload should be read before the sequence re-check */
+	smp_rmb();
+	if (READ_ONCE(slot->seq) != seq)
+		return -ESTALE;
+
+	return to_copy;
+}
+
+/*
+ * ml_model_read_dataset() - read the oldest not discarded dataset
+ * @ml_model: ML model object
+ * @buf: user-space buffer
+ * @count: size of user-space buffer
+ * @ppos: offset in dataset's payload [in|out]
+ *
+ * The payload is copied directly from the dataset ring, so
+ * any size of portion can be read by several read() calls
+ * without intermediate buffer. Returns zero if there is no
+ * published dataset or the whole payload has been read.
+ * Returns -ESTALE if the slot has been overwritten.
+ */
+ssize_t ml_model_read_dataset(struct ml_lib_model *ml_model,
+			      char __user *buf, size_t count, loff_t *ppos)
+{
+	struct ml_lib_dataset *dataset;
+	u64 seq = 0;
+
+	if (!ml_model || !buf || !ppos || *ppos < 0)
+		return -EINVAL;
+
+	if (!ml_model->ring)
+		return -ENODEV;
+
+	rcu_read_lock();
+	dataset = ml_model_peek_dataset(ml_model);
+	if (dataset)
+		seq = READ_ONCE(dataset->slot_seq);
+	rcu_read_unlock();
+
+	if (!seq)
+		return 0;
+
+	return ml_lib_dataset_ring_read(ml_model->ring, seq, buf, count, ppos);
+}
+EXPORT_SYMBOL(ml_model_read_dataset);
@@ -0,0 +1,21 @@
+// SPDX-License-Identifier: GPL-2.0-only
+/*
+ * Machine Learning (ML) library
+ *
+ * Copyright (C) 2025-2026 Viacheslav Dubeyko <slava@dubeyko.com>
+ */
+
+#ifndef _LINUX_ML_LIB_DATASET_RING_H
+#define _LINUX_ML_LIB_DATASET_RING_H
+
+void *ml_lib_dataset_ring_reserve(struct ml_lib_dataset_ring *ring,
+				  u32 *capacity);
+void ml_lib_dataset_ring_commit(struct ml_lib_dataset_ring *ring,
+				struct ml_lib_dataset *dataset);
+void ml_lib_dataset_ring_abort(struct ml_lib_dataset_ring *ring);
+u32 ml_lib_dataset_ring_nr_slots(struct ml_lib_dataset_ring *ring);
+ssize_t ml_lib_dataset_copy_payload(struct ml_lib_model *ml_model,
+				    struct ml_lib_dataset *dataset,
+				    u32 offset, void *dst, u32 size);
+
+#endif /* _LINUX_ML_LIB_DATASET_RING_H */
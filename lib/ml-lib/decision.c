@@ -0,0 +1,320 @@
+// SPDX-License-Identifier: GPL-2.0-only
+/*
+ * Machine Learning (ML) library
+ *
+ * Copyright (C) 2025-2026 Viacheslav Dubeyko <slava@dubeyko.com>
+ */
+
+#include <linux/module.h>
+#include <linux/kernel.h>
+#include <linux/ktime.h>
+#include <linux/list.h>
+#include <linux/spinlock.h>
+#include <linux/wait.h>
+
+#include <linux/ml-lib/ml_lib.h>
+
+#include "decision.h"
+#include "agent.h"
+
+/*
+ * The decision with deadline bounds the latency that the subsystem
+ * spends waiting for ML model. The sources of the answer are tried
+ * in the order of their cost:
+ * (1) the cached recommendation for the same features (the answers
+ *     of the following sources are cached);
+ * (2) execute_ml_model_operation() - the in-kernel ML model or
+ *     the subsystem's synchronous method;
+ * (3) the recommendation of user-space agent, if execute_operation()
+ *     has sent the request to the agent (-EINPROGRESS) or the request
+ *     has been hedged to the attached agents (the first answer wins).
+ *
+ * The waiting for the agent is limited by the rest of latency budget.
+ * The recommendation with the request's id is delivered to the waiter
+ * by ml_model_submit_recommendation() instead of the hint ring,
+ * so it is never applied twice. If the budget is exhausted, then
+ * the request is answered by the default algorithm and the late
+ * recommendation is dropped (the request has been answered already).
+ * The timeout affects the single request only and the mode of
+ * ML model is not changed: the mode governor is responsible for
+ * the model's mode.
+ */
+
+/*
+ * struct ml_lib_decision_waiter - request waiting for agent
+ * @node: entry in the list of waiters
+ * @request_id: identification of request
+ * @done: the recommendation has been delivered
+ * @agent: attached agent that has answered (NULL - unknown)
+ * @hint: delivered recommendation
+ */
+struct ml_lib_decision_waiter {
+	struct list_head node;
+	u64 request_id;
+	bool done;
+	struct ml_lib_agent *agent;
+	struct ml_lib_user_space_recommendation hint;
+};
+
+void ml_lib_decision_init(struct ml_lib_model *ml_model)
+{
+	spin_lock_init(&ml_model->decision_lock);
+	INIT_LIST_HEAD(&ml_model->decision_waiters);
+	atomic_set(&ml_model->nr_decision_waiters, 0);
+	init_waitqueue_head(&ml_model->decision_wq);
+	memset(&ml_model->decision_stats, 0, sizeof(ml_model->decision_stats));
+	atomic64_set(&ml_model->decision_seq, 0);
+}
+
+static void ml_lib_decision_add_waiter(struct ml_lib_model *ml_model,
+				struct ml_lib_decision_waiter *waiter)
+{
+	unsigned long flags;
+
+	spin_lock_irqsave(&ml_model->decision_lock, flags);
+	list_add_tail(&waiter->node, &ml_model->decision_waiters);
+	atomic_inc(&ml_model->nr_decision_waiters);
+	spin_unlock_irqrestore(&ml_model->decision_lock, flags);
+}
+
+/*
+ * Returns true if the recommendation has been delivered
+ * before the removal of the waiter.
+ */
+static bool ml_lib_decision_del_waiter(struct ml_lib_model *ml_model,
+				struct ml_lib_decision_waiter *waiter)
+{
+	unsigned long flags;
+	bool done;
+
+	spin_lock_irqsave(&ml_model->decision_lock, flags);
+	done = waiter->done;
+	if (!done) {
+		list_del(&waiter->node);
+		atomic_dec(&ml_model->nr_decision_waiters);
+	}
+	spin_unlock_irqrestore(&ml_model->decision_lock, flags);
+
+	return done;
+}
+
+/*
+ * ml_lib_decision_complete() - deliver recommendation to waiter
+ * @ml_model: ML model object
+ * @hint: recommendation record
+ * @agent: attached agent that has answered (NULL - unknown)
+ *
+ * Returns 0 if the recommendation has been delivered to the waiter,
+ * -ESTALE if the request of ml_model_decide() has been finished
+ * already (the recommendation should be dropped) and -ENOENT if
+ * the recommendation doesn't answer ml_model_decide().
+ */
+int ml_lib_decision_complete(struct ml_lib_model *ml_model,
+			const struct ml_lib_user_space_recommendation *hint,
+			struct ml_lib_agent *agent)
+{
+	struct ml_lib_decision_waiter *waiter;
+	unsigned long flags;
+	bool found = false;
+
+	if (!(hint->request_id & ML_LIB_DECISION_REQUEST_ID))
+		return -ENOENT;
+
+	if (!atomic_read(&ml_model->nr_decision_waiters))
+		goto late_answer;
+
+	spin_lock_irqsave(&ml_model->decision_lock, flags);
+	list_for_each_entry(waiter, &ml_model->decision_waiters, node) {
+		if (waiter->request_id != hint->request_id)
+			continue;
+
+		memcpy(&waiter->hint, hint, sizeof(waiter->hint));
+		waiter->agent = agent;
+		list_del(&waiter->node);
+		atomic_dec(&ml_model->nr_decision_waiters);
+		WRITE_ONCE(waiter->done, true);
+		found = true;
+		break;
+	}
+	spin_unlock_irqrestore(&ml_model->decision_lock, flags);
+
+	if (found) {
+		wake_up_all(&ml_model->decision_wq);
+		return 0;
+	}
+
+late_answer:
+	atomic64_inc(&ml_model->decision_stats.late);
+	return -ESTALE;
+}
+
+static int ml_lib_decision_default(struct ml_lib_model *ml_model,
+			struct ml_lib_user_space_recommendation *hint,
+			struct ml_lib_user_space_request *request)
+{
+	int err;
+
+	atomic64_inc(&ml_model->decision_stats.fallback);
+
+	if (!ml_model->model_ops || !ml_model->model_ops->default_operation)
+		err = generic_default_operation(ml_model, hint, request);
+	else
+		err = ml_model->model_ops->default_operation(ml_model, hint,
+							     request);
+
+	/* the caller executes its default algorithm itself */
+	if (err == -EOPNOTSUPP)
+		err = 0;
+
+	return err ? err : ML_LIB_DECISION_DEFAULT;
+}
+
+static bool ml_lib_decision_allowed(struct ml_lib_model *ml_model)
+{
+	switch (atomic_read(&ml_model->mode)) {
+	case ML_LIB_COLLABORATION_MODE:
+	case ML_LIB_RECOMMENDATION_MODE:
+		return true;
+	}
+
+	return false;
+}
+
+/*
+ * ml_model_decide() - make decision within latency budget
+ * @ml_model: ML model object
+ * @hint: recommendation record [out]
+ * @request: request of decision
+ * @budget_ns: latency budget of decision in nanoseconds
+ *
+ * The method assigns the unique id (ML_LIB_DECISION_REQUEST_ID bit
+ * and the ML model's sequence number) to @request, so the answers
+ * of concurrent requests cannot be confused. The execute_operation()
+ * method should send this id to user-space agent.
+ *
+ * The method answers by ML model in COLLABORATION and RECOMMENDATION
+ * modes only. If no recommendation is available within @budget_ns,
+ * then the request is answered by default_operation() method of
+ * ML model. If ML model has no such method, then the method returns
+ * ML_LIB_DECISION_DEFAULT without touching @hint and the caller
+ * should execute its default algorithm.
+ *
+ * If execute_operation() cannot answer (-EOPNOTSUPP or -ENODATA),
+ * then the request is hedged to the attached live agents. The shadow
+ * agents receive every request, but their answers are never used.
+ *
+ * The method can sleep up to @budget_ns, if the request has been
+ * sent to user-space agent. The caller in atomic context should
+ * define zero @budget_ns.
+ *
+ * Returns the source of decision (ML_LIB_DECISION_*) or negative
+ * error code.
+ */
+int ml_model_decide(struct ml_lib_model *ml_model,
+		    struct ml_lib_user_space_recommendation *hint,
+		    struct ml_lib_user_space_request *request,
+		    u64 budget_ns)
+{
+	struct ml_lib_decision_stats *stats;
+	struct ml_lib_decision_waiter waiter;
+	u64 signature = 0;
+	u64 deadline_ns;
+	s64 remaining_ns;
+	int err;
+
+	if (!ml_model || !hint || !request)
+		return -EINVAL;
+
+	stats = &ml_model->decision_stats;
+
+	request->id = ML_LIB_DECISION_REQUEST_ID |
+			atomic64_inc_return(&ml_model->decision_seq);
+
+	if (!ml_lib_decision_allowed(ml_model))
+		return ml_lib_decision_default(ml_model, hint, request);
+
+	deadline_ns = ktime_get_ns() + budget_ns;
+
+	/* the shadow agent is scored even for the cached answers */
+	ml_lib_agent_shadow(ml_model, request);
+
+	if (ml_model->hint_cache && request->features) {
+		signature = ml_model_state_signature(ml_model,
+					request->features,
+					request->nr_features * sizeof(s64));
+
+		if (!ml_model_lookup_recommendation(ml_model, signature,
+						    hint)) {
+			hint->request_id = request->id;
+			atomic64_inc(&stats->cached);
+			return ML_LIB_DECISION_CACHED;
+		}
+	}
+
+	/* the agent's answer cannot outrun the waiter */
+	INIT_LIST_HEAD(&waiter.node);
+	waiter.request_id = request->id;
+	waiter.done = false;
+	waiter.agent = NULL;
+	ml_lib_decision_add_waiter(ml_model, &waiter);
+
+	err = execute_ml_model_operation(ml_model, hint, request);
+	if ((err == -EOPNOTSUPP || err == -ENODATA) && budget_ns &&
+	    ml_lib_agent_hedge(ml_model, request) > 0)
+		err = -EINPROGRESS;
+
+	if (err != -EINPROGRESS) {
+		/* the request hasn't been sent to the agent */
+		ml_lib_decision_del_waiter(ml_model, &waiter);
+
+		if (err)
+			return ml_lib_decision_default(ml_model, hint, request);
+
+		if (signature)
+			ml_model_cache_recommendation(ml_model, signature, hint);
+
+		atomic64_inc(&stats->model);
+		return ML_LIB_DECISION_MODEL;
+	}
+
+	remaining_ns = deadline_ns - ktime_get_ns();
+	if (remaining_ns > 0) {
+		wait_event_hrtimeout(ml_model->decision_wq,
+				     READ_ONCE(waiter.done),
+				     ns_to_ktime(remaining_ns));
+	}
+
+	if (!ml_lib_decision_del_waiter(ml_model, &waiter)) {
+		ml_lib_agent_cancel(ml_model, request->id, NULL);
+		atomic64_inc(&stats->timeouts);
+		return ml_lib_decision_default(ml_model, hint, request);
+	}
+
+	/* the slower agents don't need to answer */
+	ml_lib_agent_cancel(ml_model, request->id, waiter.agent);
+
+	memcpy(hint, &waiter.hint, sizeof(*hint));
+	atomic64_inc(&stats->agent);
+
+	/* the next request with the same features doesn't wait */
+	if (signature)
+		ml_model_cache_recommendation(ml_model, signature, hint);
+
+	return ML_LIB_DECISION_AGENT;
+}
+EXPORT_SYMBOL(ml_model_decide);
+
+ssize_t ml_lib_decision_info(struct ml_lib_model *ml_model, char *buf)
+{
+	struct ml_lib_decision_stats *stats = &ml_model->decision_stats;
+
+	return sysfs_emit(buf,
+			  "cached %llu model %llu agent %llu default %llu "
+			  "timeouts %llu late %llu\n",
+			  atomic64_read(&stats->cached),
+			  atomic64_read(&stats->model),
+			  atomic64_read(&stats->agent),
+			  atomic64_read(&stats->fallback),
+			  atomic64_read(&stats->timeouts),
+			  atomic64_read(&stats->late));
+}
@@ -0,0 +1,17 @@
+// SPDX-License-Identifier: GPL-2.0-only
+/*
+ * Machine Learning (ML) library
+ *
+ * Copyright (C) 2025-2026 Viacheslav Dubeyko <slava@dubeyko.com>
+ */
+
+#ifndef _LINUX_ML_LIB_DECISION_H
+#define _LINUX_ML_LIB_DECISION_H
+
+void ml_lib_decision_init(struct ml_lib_model *ml_model);
+int ml_lib_decision_complete(struct ml_lib_model *ml_model,
+			const struct ml_lib_user_space_recommendation *hint,
+			struct ml_lib_agent *agent);
+ssize_t ml_lib_decision_info(struct ml_lib_model *ml_model, char *buf);
+
+#endif /* _LINUX_ML_LIB_DECISION_H */
@@ -0,0 +1,331 @@
+// SPDX-License-Identifier: GPL-2.0-only
+/*
+ * Machine Learning (ML) library
+ *
+ * Copyright (C) 2025-2026 Viacheslav Dubeyko <slava@dubeyko.com>
+ */
+
+#include <linux/module.h>
+#include <linux/kernel.h>
+#include <linux/jiffies.h>
+#include <linux/math64.h>
+#include <linux/workqueue.h>
+#include <linux/rcupdate.h>
+
+#include <linux/ml-lib/ml_lib.h>
+
+#include "worker.h"
+#include "governor.h"
+
+#include <trace/events/ml_lib.h>
+
+/*
+ * The mode governor of started ML model evaluates every
+ * governor_interval milliseconds:
+ * (1) the efficiency of ML-driven results in percent of the default
+ *     algorithm's efficiency (estimate_efficiency() method);
+ * (2) the average latency of decisions (execute_ml_model_operation()
+ *     calls) during the interval.
+ *
+ * The mode is promoted by one step (LEARNING -> COLLABORATION ->
+ * RECOMMENDATION) after promote_intervals consecutive intervals with
+ * efficiency of promote_efficiency or better. The interval with
+ * efficiency below demote_efficiency or with latency above
+ * max_decision_latency drops the ML model into EMERGENCY mode
+ * immediately. The EMERGENCY mode is left for LEARNING mode after
+ * the same number of won intervals as promotion requires, so
+ * estimate_efficiency() should compare the results that ML model
+ * would have produced even if they are not applied.
+ *
+ * The evaluations of one ML model never run concurrently, so
+ * the governor's state needs no lock. The mode can be changed
+ * manually at any time; the governor never overrides the mode
+ * that has been changed after its evaluation had begun.
+ */
+
+struct ml_lib_governor_params {
+	u32 interval;
+	int promote;
+	int demote;
+	u32 intervals;
+	u64 max_latency;
+};
+
+static bool ml_lib_governor_get_params(struct ml_lib_model *ml_model,
+				       struct ml_lib_governor_params *params)
+{
+	struct ml_lib_model_options *options;
+
+	params->interval = 0;
+	params->promote = ML_LIB_PROMOTE_EFFICIENCY_DEFAULT;
+	params->demote = ML_LIB_DEMOTE_EFFICIENCY_DEFAULT;
+	params->intervals = ML_LIB_PROMOTE_INTERVALS_DEFAULT;
+	params->max_latency = 0;
+
+	rcu_read_lock();
+	options = rcu_dereference(ml_model->options);
+	if (options) {
+		params->interval = options->governor_interval;
+		if (options->promote_efficiency)
+			params->promote = min_t(u32, options->promote_efficiency,
+						INT_MAX);
+		if (options->demote_efficiency)
+			params->demote = min_t(u32, options->demote_efficiency,
+					       INT_MAX);
+		if (options->promote_intervals)
+			params->intervals = options->promote_intervals;
+		params->max_latency = options->max_decision_latency;
+	}
+	rcu_read_unlock();
+
+	/* the efficiency cannot promote and demote at the same time */
+	params->demote = min(params->demote, params->promote);
+
+	return params->interval != 0;
+}
+
+static int ml_lib_governor_efficiency(struct ml_lib_model *ml_model)
+{
+	struct ml_lib_user_space_recommendation hint = {0};
+	struct ml_lib_user_space_request request = {
+		.id = ML_LIB_GOVERNOR_REQUEST_ID,
+	};
+	int efficiency;
+
+	efficiency = estimate_ml_model_efficiency(ml_model, &hint, &request);
+	switch (efficiency) {
+	case -ENODATA:		/* nothing has been measured */
+	case -EOPNOTSUPP:	/* subsystem cannot estimate efficiency */
+		break;
+
+	default:
+		if (efficiency < 0) {
+			pr_err_ratelimited("ml_lib: failed to estimate efficiency: "
+					   "subsystem %s, model %s, err %d\n",
+					   ml_model->subsystem_name,
+					   ml_model->model_name, efficiency);
+		}
+		break;
+	}
+
+	return efficiency;
+}
+
+static u64 ml_lib_governor_latency(struct ml_lib_model *ml_model,
+				   u64 *decisions)
+{
+	struct ml_lib_governor *gov = &ml_model->governor;
+	u64 total = atomic64_read(&ml_model->decisions);
+	u64 total_ns = atomic64_read(&ml_model->decision_ns);
+	u64 latency_ns = 0;
+
+	*decisions = total - gov->last_decisions;
+	if (*decisions) {
+		latency_ns = div64_u64(total_ns - gov->last_decision_ns,
+				       *decisions);
+	}
+
+	gov->last_decisions = total;
+	gov->last_decision_ns = total_ns;
+
+	return latency_ns;
+}
+
+static void ml_lib_governor_transition(struct ml_lib_model *ml_model,
+				       int old_mode, int new_mode, int reason)
+{
+	struct ml_lib_governor *gov = &ml_model->governor;
+
+	gov->wins = 0;
+
+	/* the mode has been changed manually during evaluation */
+	if (atomic_cmpxchg(&ml_model->mode, old_mode, new_mode) != old_mode)
+		return;
+
+	if (new_mode > old_mode)
+		WRITE_ONCE(gov->promotions, gov->promotions + 1);
+	else
+		WRITE_ONCE(gov->demotions, gov->demotions + 1);
+
+	trace_ml_lib_mode_change(ml_model, old_mode, new_mode, reason,
+				 gov->efficiency, gov->latency_ns);
+
+	if (new_mode == ML_LIB_EMERGENCY_MODE) {
+		pr_warn_ratelimited("ml_lib: ML model falls into emergency mode: "
+				    "subsystem %s, model %s, efficiency %d, "
+				    "latency_ns %llu\n",
+				    ml_model->subsystem_name,
+				    ml_model->model_name,
+				    gov->efficiency, gov->latency_ns);
+	}
+}
+
+static void ml_lib_governor_evaluate(struct ml_lib_model *ml_model,
+				     struct ml_lib_governor_params *params)
+{
+	struct ml_lib_governor *gov = &ml_model->governor;
+	int mode = atomic_read(&ml_model->mode);
+	int efficiency = gov->efficiency;
+	bool slow = params->max_latency &&
+			gov->latency_ns > params->max_latency;
+
+	switch (mode) {
+	case ML_LIB_UNKNOWN_MODE:
+		/* ML model starts to learn under the governor's control */
+		ml_lib_governor_transition(ml_model, mode,
+					   ML_LIB_LEARNING_MODE,
+					   ML_LIB_MODE_CHANGE_PROMOTION);
+		return;
+
+	case ML_LIB_EMERGENCY_MODE:
+		if (slow) {
+			gov->wins = 0;
+			return;
+		}
+		break;
+
+	default:
+		if (slow) {
+			ml_lib_governor_transition(ml_model, mode,
+						   ML_LIB_EMERGENCY_MODE,
+						   ML_LIB_MODE_CHANGE_LATENCY);
+			return;
+		}
+
+		if (efficiency >= 0 && efficiency < params->demote) {
+			ml_lib_governor_transition(ml_model, mode,
+						   ML_LIB_EMERGENCY_MODE,
+						   ML_LIB_MODE_CHANGE_EFFICIENCY);
+			return;
+		}
+		break;
+	}
+
+	/* the interval without measurements doesn't break the series */
+	if (efficiency < 0)
+		return;
+
+	if (efficiency < params->promote) {
+		gov->wins = 0;
+		return;
+	}
+
+	if (mode >= ML_LIB_RECOMMENDATION_MODE)
+		return;
+
+	if (++gov->wins < params->intervals)
+		return;
+
+	/* EMERGENCY mode is followed by LEARNING one */
+	ml_lib_governor_transition(ml_model, mode, mode + 1,
+				   ML_LIB_MODE_CHANGE_PROMOTION);
+}
+
+static void ml_lib_governor_func(struct work_struct *work)
+{
+	struct ml_lib_model *ml_model =
+		container_of(to_delayed_work(work), struct ml_lib_model,
+			     governor_work);
+	struct ml_lib_governor *gov = &ml_model->governor;
+	struct ml_lib_governor_params params;
+	u64 decisions;
+
+	/* re_init() has disabled the governor */
+	if (!ml_lib_governor_get_params(ml_model, &params)) {
+		WRITE_ONCE(gov->interval, 0);
+		return;
+	}
+
+	WRITE_ONCE(gov->efficiency, ml_lib_governor_efficiency(ml_model));
+	WRITE_ONCE(gov->latency_ns,
+		   ml_lib_governor_latency(ml_model, &decisions));
+
+	trace_ml_lib_governor_sample(ml_model, atomic_read(&ml_model->mode),
+				     gov->efficiency, gov->latency_ns,
+				     decisions);
+
+	ml_lib_governor_evaluate(ml_model, &params);
+
+	WRITE_ONCE(gov->interval, params.interval);
+	ml_lib_worker_queue_delayed_work(ml_model, &ml_model->governor_work,
+					 msecs_to_jiffies(params.interval));
+}
+
+void ml_lib_governor_init(struct ml_lib_model *ml_model)
+{
+	INIT_DELAYED_WORK(&ml_model->governor_work, ml_lib_governor_func);
+	atomic64_set(&ml_model->decisions, 0);
+	atomic64_set(&ml_model->decision_ns, 0);
+	memset(&ml_model->governor, 0, sizeof(ml_model->governor));
+	ml_model->governor.efficiency = -ENODATA;
+}
+
+/*
+ * ml_lib_governor_start() - start the mode governor of ML model
+ * @ml_model: ML model object
+ *
+ * The governor is started only if the options define
+ * governor_interval. The first evaluation happens after
+ * the first interval because there is nothing to evaluate yet.
+ */
+void ml_lib_governor_start(struct ml_lib_model *ml_model)
+{
+	struct ml_lib_governor *gov = &ml_model->governor;
+	struct ml_lib_governor_params params;
+
+	mutex_lock(&ml_model->worker_lock);
+
+	if (atomic_read(&ml_model->state) == ML_LIB_MODEL_SHUTTING_DOWN)
+		goto finish_governor_start;
+
+	if (gov->interval || !ml_lib_governor_get_params(ml_model, &params))
+		goto finish_governor_start;
+
+	gov->wins = 0;
+	gov->efficiency = -ENODATA;
+	gov->latency_ns = 0;
+	gov->last_decisions = atomic64_read(&ml_model->decisions);
+	gov->last_decision_ns = atomic64_read(&ml_model->decision_ns);
+
+	/* the latency of decisions is measured while interval isn't zero */
+	WRITE_ONCE(gov->interval, params.interval);
+	ml_lib_worker_queue_delayed_work(ml_model, &ml_model->governor_work,
+					 msecs_to_jiffies(params.interval));
+
+finish_governor_start:
+	mutex_unlock(&ml_model->worker_lock);
+}
+
+/*
+ * ml_lib_governor_stop() - stop the mode governor of ML model
+ * @ml_model: ML model object
+ *
+ * The method waits for the evaluation in progress. The mode
+ * of ML model stays as the governor has left it.
+ */
+void ml_lib_governor_stop(struct ml_lib_model *ml_model)
+{
+	mutex_lock(&ml_model->worker_lock);
+	cancel_delayed_work_sync(&ml_model->governor_work);
+	WRITE_ONCE(ml_model->governor.interval, 0);
+	mutex_unlock(&ml_model->worker_lock);
+}
+
+/*
+ * ml_lib_governor_info() - show the governor's state in sysfs
+ * @ml_model: ML model object
+ * @buf: sysfs buffer
+ */
+ssize_t ml_lib_governor_info(struct ml_lib_model *ml_model, char *buf)
+{
+	struct ml_lib_governor *gov = &ml_model->governor;
+
+	return sysfs_emit(buf,
+			  "interval %u wins %u efficiency %d latency_ns %llu "
+			  "promotions %llu demotions %llu\n",
+			  READ_ONCE(gov->interval), READ_ONCE(gov->wins),
+			  READ_ONCE(gov->efficiency),
+			  READ_ONCE(gov->latency_ns),
+			  READ_ONCE(gov->promotions),
+			  READ_ONCE(gov->demotions));
+}
@@ -0,0 +1,21 @@
+// SPDX-License-Identifier: GPL-2.0-only
+/*
+ * Machine Learning (ML) library
+ *
+ * Copyright (C) 2025-2026 Viacheslav Dubeyko <slava@dubeyko.com>
+ */
+
+#ifndef _LINUX_ML_LIB_GOVERNOR_H
+#define _LINUX_ML_LIB_GOVERNOR_H
+
+void ml_lib_governor_init(struct ml_lib_model *ml_model);
+void ml_lib_governor_start(struct ml_lib_model *ml_model);
+void ml_lib_governor_stop(struct ml_lib_model *ml_model);
+ssize_t ml_lib_governor_info(struct ml_lib_model *ml_model, char *buf);
+
+static inline bool ml_lib_governor_active(struct ml_lib_model *ml_model)
+{
+	return READ_ONCE(ml_model->governor.interval) != 0;
+}
+
+#endif /* _LINUX_ML_LIB_GOVERNOR_H */
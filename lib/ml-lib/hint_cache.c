@@ -0,0 +1,422 @@
+// SPDX-License-Identifier: GPL-2.0-only
+/*
+ * Machine Learning (ML) library
+ *
+ * Copyright (C) 2025-2026 Viacheslav Dubeyko <slava@dubeyko.com>
+ */
+
+#include <linux/module.h>
+#include <linux/kernel.h>
+#include <linux/slab.h>
+#include <linux/mm.h>
+#include <linux/log2.h>
+#include <linux/hash.h>
+#include <linux/xxhash.h>
+#include <linux/jiffies.h>
+#include <linux/percpu.h>
+#include <linux/rculist.h>
+#include <linux/spinlock.h>
+
+#include <linux/ml-lib/ml_lib.h>
+
+#include "hint_cache.h"
+
+/*
+ * The hint cache maps the signature of subsystem's state to
+ * the last recommendation of ML model for this state. The kernel
+ * subsystem looks up the cache before asking user-space and
+ * caches the recommendation that it receives for the missed state.
+ *
+ * The lookup is lockless: the buckets are RCU hash lists and
+ * the entries are never changed after publishing. The update
+ * replaces the entry of the same signature by the new one.
+ * The number of entries is limited by the capacity of the cache.
+ * If the cache is full, then the oldest entry is evicted.
+ * The expired entries are not returned by lookup and they are
+ * reclaimed by the following updates.
+ */
+
+/*
+ * struct ml_lib_hint_cache_entry - hint cache's entry
+ * @node: entry in hash bucket
+ * @lru: entry in the list of entries (oldest first)
+ * @signature: signature of subsystem's state
+ * @expires: expiration time in jiffies (0 - never)
+ * @hint: cached recommendation
+ * @rcu: deferred freeing of entry
+ */
+struct ml_lib_hint_cache_entry {
+	struct hlist_node node;
+	struct list_head lru;
+	u64 signature;
+	unsigned long expires;
+	struct ml_lib_user_space_recommendation hint;
+	struct rcu_head rcu;
+};
+
+/*
+ * struct ml_lib_hint_cache_stats - per-CPU statistics of lookups
+ * @hits: number of lookups that found the recommendation
+ * @misses: number of lookups that found nothing
+ * @expired: number of misses because of expired entry
+ */
+struct ml_lib_hint_cache_stats {
+	u64 hits;
+	u64 misses;
+	u64 expired;
+};
+
+/*
+ * struct ml_lib_hint_cache - hint cache
+ * @capacity: max number of entries
+ * @hash_bits: number of bits of bucket index
+ * @stats: per-CPU statistics of lookups
+ * @lock: serializes the updates
+ * @nr_entries: number of entries
+ * @lru: list of entries (oldest first)
+ * @evictions: number of entries evicted by full cache
+ * @expirations: number of reclaimed expired entries
+ * @buckets: hash buckets
+ */
+struct ml_lib_hint_cache {
+	u32 capacity;
+	u32 hash_bits;
+	struct ml_lib_hint_cache_stats __percpu *stats;
+
+	spinlock_t lock ____cacheline_aligned_in_smp;
+	u32 nr_entries;
+	struct list_head lru;
+	u64 evictions;
+	u64 expirations;
+
+	struct hlist_head buckets[] ____cacheline_aligned_in_smp;
+};
+
+struct ml_lib_hint_cache *ml_lib_hint_cache_alloc(u32 capacity, gfp_t gfp)
+{
+	struct ml_lib_hint_cache *cache;
+	u32 nr_buckets;
+	u32 i;
+
+	if (capacity == 0 || capacity > ML_LIB_HINT_CACHE_ENTRIES_MAX)
+		return ERR_PTR(-EINVAL);
+
+	nr_buckets = roundup_pow_of_two(capacity);
+
+	cache = kvzalloc(struct_size(cache, buckets, nr_buckets), gfp);
+	if (unlikely(!cache))
+		return ERR_PTR(-ENOMEM);
+
+	cache->stats = alloc_percpu_gfp(struct ml_lib_hint_cache_stats, gfp);
+	if (unlikely(!cache->stats)) {
+		kvfree(cache);
+		return ERR_PTR(-ENOMEM);
+	}
+
+	cache->capacity = capacity;
+	cache->hash_bits = ilog2(nr_buckets);
+	spin_lock_init(&cache->lock);
+	cache->nr_entries = 0;
+	INIT_LIST_HEAD(&cache->lru);
+
+	for (i = 0; i < nr_buckets; i++)
+		INIT_HLIST_HEAD(&cache->buckets[i]);
+
+	return cache;
+}
+
+/* the caller should hold the lock */
+static void ml_lib_hint_cache_remove(struct ml_lib_hint_cache *cache,
+				     struct ml_lib_hint_cache_entry *entry)
+{
+	lockdep_assert_held(&cache->lock);
+
+	hlist_del_rcu(&entry->node);
+	list_del(&entry->lru);
+	cache->nr_entries--;
+	kfree_rcu(entry, rcu);
+}
+
+/* the caller should hold the lock */
+static void ml_lib_hint_cache_reclaim(struct ml_lib_hint_cache *cache)
+{
+	struct ml_lib_hint_cache_entry *entry, *tmp;
+
+	lockdep_assert_held(&cache->lock);
+
+	list_for_each_entry_safe(entry, tmp, &cache->lru, lru) {
+		if (!entry->expires || time_before(jiffies, entry->expires))
+			break;
+
+		ml_lib_hint_cache_remove(cache, entry);
+		cache->expirations++;
+	}
+}
+
+/*
+ * The caller should guarantee that nobody looks up
+ * or updates the cache anymore.
+ */
+void ml_lib_hint_cache_free(struct ml_lib_hint_cache *cache)
+{
+	struct ml_lib_hint_cache_entry *entry, *tmp;
+
+	if (!cache)
+		return;
+
+	list_for_each_entry_safe(entry, tmp, &cache->lru, lru) {
+		list_del(&entry->lru);
+		kfree_rcu(entry, rcu);
+	}
+
+	free_percpu(cache->stats);
+	kvfree(cache);
+}
+
+static inline struct hlist_head *
+ml_lib_hint_cache_bucket(struct ml_lib_hint_cache *cache, u64 signature)
+{
+	return &cache->buckets[hash_64(signature, cache->hash_bits)];
+}
+
+static unsigned long ml_lib_hint_cache_expires(struct ml_lib_model *ml_model)
+{
+	struct ml_lib_model_options *options;
+	unsigned long expires = 0;
+
+	rcu_read_lock();
+	options = rcu_dereference(ml_model->options);
+	if (options && options->hint_cache_ttl) {
+		expires = jiffies + msecs_to_jiffies(options->hint_cache_ttl);
+		/* zero means that entry never expires */
+		if (!expires)
+			expires = 1;
+	}
+	rcu_read_unlock();
+
+	return expires;
+}
+
+/*
+ * ml_model_state_signature() - calculate signature of subsystem's state
+ * @ml_model: ML model object
+ * @state: subsystem's state (for example, preprocessed features)
+ * @size: size of state in bytes
+ *
+ * The signature is the key of hint cache. The version of loaded
+ * ML model is the seed of hash, so the new model never reuses
+ * the recommendations of the previous one.
+ */
+u64 ml_model_state_signature(struct ml_lib_model *ml_model,
+			     const void *state, size_t size)
+{
+	if (!ml_model || !state)
+		return 0;
+
+	return xxh64(state, size, READ_ONCE(ml_model->model_version));
+}
+EXPORT_SYMBOL(ml_model_state_signature);
+
+/*
+ * The hint cache is freed by ml_model_destroy() after the grace period
+ * that follows SHUTTING_DOWN state, so the caller should be in RCU
+ * read-side critical section.
+ */
+static struct ml_lib_hint_cache *
+ml_lib_hint_cache_get(struct ml_lib_model *ml_model)
+{
+	if (atomic_read(&ml_model->state) == ML_LIB_MODEL_SHUTTING_DOWN)
+		return NULL;
+
+	return READ_ONCE(ml_model->hint_cache);
+}
+
+/*
+ * ml_model_lookup_recommendation() - find cached recommendation
+ * @ml_model: ML model object
+ * @signature: signature of subsystem's state
+ * @hint: recommendation record [out]
+ *
+ * The method never sleeps and it can be called in any context.
+ * Returns -ENOENT if there is no valid recommendation for
+ * the @signature and -ENODEV if ML model has no hint cache.
+ */
+int ml_model_lookup_recommendation(struct ml_lib_model *ml_model,
+				u64 signature,
+				struct ml_lib_user_space_recommendation *hint)
+{
+	struct ml_lib_hint_cache *cache;
+	struct ml_lib_hint_cache_entry *entry;
+	unsigned long expires;
+	int err = -ENOENT;
+
+	if (!ml_model || !hint)
+		return -EINVAL;
+
+	rcu_read_lock();
+
+	cache = ml_lib_hint_cache_get(ml_model);
+	if (!cache) {
+		rcu_read_unlock();
+		return -ENODEV;
+	}
+
+	hlist_for_each_entry_rcu(entry,
+				 ml_lib_hint_cache_bucket(cache, signature),
+				 node) {
+		if (entry->signature != signature)
+			continue;
+
+		expires = entry->expires;
+		if (expires && time_after_eq(jiffies, expires)) {
+			this_cpu_inc(cache->stats->expired);
+			break;
+		}
+
+		memcpy(hint, &entry->hint, sizeof(*hint));
+		err = 0;
+		break;
+	}
+
+	if (err)
+		this_cpu_inc(cache->stats->misses);
+	else
+		this_cpu_inc(cache->stats->hits);
+
+	rcu_read_unlock();
+
+	return err;
+}
+EXPORT_SYMBOL(ml_model_lookup_recommendation);
+
+/*
+ * ml_model_cache_recommendation() - cache recommendation for state
+ * @ml_model: ML model object
+ * @signature: signature of subsystem's state
+ * @hint: recommendation record
+ *
+ * The recommendation replaces the cached one for the same
+ * @signature. It lives @hint_cache_ttl milliseconds of ML model's
+ * options. The method never sleeps, but it cannot be called
+ * in hardirq context.
+ */
+int ml_model_cache_recommendation(struct ml_lib_model *ml_model,
+			u64 signature,
+			const struct ml_lib_user_space_recommendation *hint)
+{
+	struct ml_lib_hint_cache *cache;
+	struct ml_lib_hint_cache_entry *entry, *old = NULL;
+	struct hlist_head *bucket;
+
+	if (!ml_model || !hint)
+		return -EINVAL;
+
+	entry = kmalloc(sizeof(*entry), GFP_NOWAIT | __GFP_NOWARN);
+	if (unlikely(!entry))
+		return -ENOMEM;
+
+	entry->signature = signature;
+	entry->expires = ml_lib_hint_cache_expires(ml_model);
+	memcpy(&entry->hint, hint, sizeof(entry->hint));
+
+	rcu_read_lock();
+
+	cache = ml_lib_hint_cache_get(ml_model);
+	if (!cache) {
+		rcu_read_unlock();
+		kfree(entry);
+		return -ENODEV;
+	}
+
+	bucket = ml_lib_hint_cache_bucket(cache, signature);
+
+	spin_lock_bh(&cache->lock);
+
+	hlist_for_each_entry(old, bucket, node) {
+		if (old->signature == signature)
+			break;
+	}
+
+	if (old) {
+		hlist_replace_rcu(&old->node, &entry->node);
+		list_del(&old->lru);
+		list_add_tail(&entry->lru, &cache->lru);
+		kfree_rcu(old, rcu);
+	} else {
+		ml_lib_hint_cache_reclaim(cache);
+
+		if (cache->nr_entries >= cache->capacity) {
+			ml_lib_hint_cache_remove(cache,
+				list_first_entry(&cache->lru,
+						 struct ml_lib_hint_cache_entry,
+						 lru));
+			cache->evictions++;
+		}
+
+		hlist_add_head_rcu(&entry->node, bucket);
+		list_add_tail(&entry->lru, &cache->lru);
+		cache->nr_entries++;
+	}
+
+	spin_unlock_bh(&cache->lock);
+	rcu_read_unlock();
+
+	return 0;
+}
+EXPORT_SYMBOL(ml_model_cache_recommendation);
+
+/*
+ * ml_model_invalidate_recommendations() - drop cached recommendations
+ * @ml_model: ML model object
+ *
+ * The method is called when loaded ML model is replaced.
+ * The kernel subsystem can call it when the cached
+ * recommendations are not valid anymore.
+ */
+void ml_model_invalidate_recommendations(struct ml_lib_model *ml_model)
+{
+	struct ml_lib_hint_cache *cache;
+	struct ml_lib_hint_cache_entry *entry, *tmp;
+
+	if (!ml_model)
+		return;
+
+	rcu_read_lock();
+
+	cache = ml_lib_hint_cache_get(ml_model);
+	if (cache) {
+		spin_lock_bh(&cache->lock);
+		list_for_each_entry_safe(entry, tmp, &cache->lru, lru)
+			ml_lib_hint_cache_remove(cache, entry);
+		spin_unlock_bh(&cache->lock);
+	}
+
+	rcu_read_unlock();
+}
+EXPORT_SYMBOL(ml_model_invalidate_recommendations);
+
+ssize_t ml_lib_hint_cache_info(struct ml_lib_model *ml_model, char *buf)
+{
+	struct ml_lib_hint_cache *cache = ml_model->hint_cache;
+	struct ml_lib_hint_cache_stats *stats;
+	u64 hits = 0, misses = 0, expired = 0;
+	int cpu;
+
+	if (!cache)
+		return sysfs_emit(buf, "none\n");
+
+	for_each_possible_cpu(cpu) {
+		stats = per_cpu_ptr(cache->stats, cpu);
+		hits += READ_ONCE(stats->hits);
+		misses += READ_ONCE(stats->misses);
+		expired += READ_ONCE(stats->expired);
+	}
+
+	return sysfs_emit(buf,
+			  "entries %u capacity %u hits %llu misses %llu "
+			  "expired %llu evictions %llu expirations %llu\n",
+			  READ_ONCE(cache->nr_entries), cache->capacity,
+			  hits, misses, expired,
+			  READ_ONCE(cache->evictions),
+			  READ_ONCE(cache->expirations));
+}
@@ -0,0 +1,17 @@
+// SPDX-License-Identifier: GPL-2.0-only
+/*
+ * Machine Learning (ML) library
+ *
+ * Copyright (C) 2025-2026 Viacheslav Dubeyko <slava@dubeyko.com>
+ */
+
+#ifndef _LINUX_ML_LIB_HINT_CACHE_H
+#define _LINUX_ML_LIB_HINT_CACHE_H
+
+#define ML_LIB_HINT_CACHE_ENTRIES_MAX		(65536)
+
+struct ml_lib_hint_cache *ml_lib_hint_cache_alloc(u32 capacity, gfp_t gfp);
+void ml_lib_hint_cache_free(struct ml_lib_hint_cache *cache);
+ssize_t ml_lib_hint_cache_info(struct ml_lib_model *ml_model, char *buf);
+
+#endif /* _LINUX_ML_LIB_HINT_CACHE_H */
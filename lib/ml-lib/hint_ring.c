@@ -0,0 +1,310 @@
+// SPDX-License-Identifier: GPL-2.0-only
+/*
+ * Machine Learning (ML) library
+ *
+ * Copyright (C) 2025-2026 Viacheslav Dubeyko <slava@dubeyko.com>
+ */
+
+#include <linux/module.h>
+#include <linux/kernel.h>
+#include <linux/slab.h>
+#include <linux/mm.h>
+#include <linux/log2.h>
+#include <linux/atomic.h>
+#include <linux/cache.h>
+#include <linux/mutex.h>
+#include <linux/rcupdate.h>
+#include <linux/workqueue.h>
+
+#include <linux/ml-lib/ml_lib.h>
+
+#include "worker.h"
+#include "hint_ring.h"
+#include "decision.h"
+
+/*
+ * The hint ring is a bounded lock-free MPSC ring of recommendations
+ * that user-space (or any other producer) submits for ML model.
+ * The cells keep the records by value and use the same sequence
+ * numbers as the dataset queue:
+ * (1) seq == pos - the cell is free for the producer of @pos;
+ * (2) seq == pos + 1 - the cell contains the record for the consumer.
+ * Producers claim positions by cmpxchg on @head and never wait.
+ * The single consumer (the drain work of ML model) applies
+ * up to ML_LIB_HINT_BATCH_MAX records per execution, so one
+ * wakeup applies hundreds of records.
+ */
+
+/*
+ * struct ml_lib_hint_ring_cell - hint ring's cell
+ * @seq: sequence number of the cell
+ * @hint: recommendation record
+ */
+struct ml_lib_hint_ring_cell {
+	atomic_long_t seq;
+	struct ml_lib_user_space_recommendation hint;
+};
+
+/*
+ * struct ml_lib_hint_ring - hint ring
+ * @depth: number of cells (power of two)
+ * @mask: cell index mask
+ * @head: position of the next enqueue
+ * @submitted: number of submitted records
+ * @dropped: number of records rejected by full ring
+ * @consumer_lock: serializes the consumers
+ * @tail: position of the next dequeue
+ * @applied: number of applied records
+ * @failed: number of records that failed to apply
+ * @batches: number of drained batches
+ * @cells: array of cells
+ */
+struct ml_lib_hint_ring {
+	u32 depth;
+	u32 mask;
+
+	atomic_long_t head ____cacheline_aligned_in_smp;
+	atomic64_t submitted;
+	atomic64_t dropped;
+
+	struct mutex consumer_lock ____cacheline_aligned_in_smp;
+	long tail;
+	u64 applied;
+	u64 failed;
+	u64 batches;
+
+	struct ml_lib_hint_ring_cell cells[] ____cacheline_aligned_in_smp;
+};
+
+struct ml_lib_hint_ring *ml_lib_hint_ring_alloc(u32 depth, gfp_t gfp)
+{
+	struct ml_lib_hint_ring *ring;
+	u32 i;
+
+	if (depth == 0 || depth > ML_LIB_HINT_RING_DEPTH_MAX)
+		return ERR_PTR(-EINVAL);
+
+	depth = roundup_pow_of_two(depth);
+
+	ring = kvzalloc(struct_size(ring, cells, depth), gfp);
+	if (unlikely(!ring))
+		return ERR_PTR(-ENOMEM);
+
+	ring->depth = depth;
+	ring->mask = depth - 1;
+	atomic_long_set(&ring->head, 0);
+	atomic64_set(&ring->submitted, 0);
+	atomic64_set(&ring->dropped, 0);
+	mutex_init(&ring->consumer_lock);
+	ring->tail = 0;
+
+	for (i = 0; i < depth; i++)
+		atomic_long_set(&ring->cells[i].seq, i);
+
+	return ring;
+}
+
+void ml_lib_hint_ring_free(struct ml_lib_hint_ring *ring)
+{
+	kvfree(ring);
+}
+
+static int ml_lib_hint_ring_push(struct ml_lib_hint_ring *ring,
+			const struct ml_lib_user_space_recommendation *hint)
+{
+	struct ml_lib_hint_ring_cell *cell;
+	long pos = atomic_long_read(&ring->head);
+	long diff;
+
+	for (;;) {
+		cell = &ring->cells[pos & ring->mask];
+		diff = atomic_long_read_acquire(&cell->seq) - pos;
+
+		if (diff == 0) {
+			if (atomic_long_try_cmpxchg_relaxed(&ring->head,
+							    &pos, pos + 1))
+				break;
+		} else if (diff < 0) {
+			atomic64_inc(&ring->dropped);
+			return -ENOSPC;
+		} else
+			pos = atomic_long_read(&ring->head);
+	}
+
+	memcpy(&cell->hint, hint, sizeof(cell->hint));
+	atomic_long_set_release(&cell->seq, pos + 1);
+	atomic64_inc(&ring->submitted);
+
+	return 0;
+}
+
+/* the caller should hold consumer_lock */
+static bool ml_lib_hint_ring_pop(struct ml_lib_hint_ring *ring,
+				 struct ml_lib_user_space_recommendation *hint)
+{
+	struct ml_lib_hint_ring_cell *cell;
+	long pos = ring->tail;
+
+	lockdep_assert_held(&ring->consumer_lock);
+
+	cell = &ring->cells[pos & ring->mask];
+	if (atomic_long_read_acquire(&cell->seq) != pos + 1)
+		return false;
+
+	memcpy(hint, &cell->hint, sizeof(*hint));
+	atomic_long_set_release(&cell->seq, pos + ring->depth);
+	WRITE_ONCE(ring->tail, pos + 1);
+
+	return true;
+}
+
+u32 ml_lib_hint_ring_count(struct ml_lib_hint_ring *ring)
+{
+	long tail = READ_ONCE(ring->tail);
+	long head = atomic_long_read(&ring->head);
+
+	if (head <= tail)
+		return 0;
+
+	return min_t(long, head - tail, ring->depth);
+}
+
+/*
+ * ml_lib_hint_ring_kick() - schedule the drain of hint ring
+ * @ml_model: ML model object
+ *
+ * The drain work is queued only if it isn't pending yet, so
+ * the producers of one batch share one wakeup of the consumer.
+ */
+void ml_lib_hint_ring_kick(struct ml_lib_model *ml_model)
+{
+	if (!ml_model->hints || !ml_lib_hint_ring_count(ml_model->hints))
+		return;
+
+	if (!work_pending(&ml_model->hint_work))
+		ml_lib_worker_queue_work(ml_model, &ml_model->hint_work);
+}
+
+void ml_lib_hint_ring_work_func(struct work_struct *work)
+{
+	struct ml_lib_model *ml_model =
+		container_of(work, struct ml_lib_model, hint_work);
+	struct ml_lib_hint_ring *ring = ml_model->hints;
+	struct ml_lib_user_space_recommendation hint;
+	u32 applied = 0;
+	u32 failed = 0;
+	u32 i;
+	int err;
+
+	if (!ring)
+		return;
+
+	mutex_lock(&ring->consumer_lock);
+
+	for (i = 0; i < ML_LIB_HINT_BATCH_MAX; i++) {
+		if (!ml_lib_hint_ring_pop(ring, &hint))
+			break;
+
+		err = ml_model_preprocess_recommendation(ml_model, &hint);
+		if (!err)
+			err = apply_ml_model_recommendation(ml_model, &hint);
+
+		if (err)
+			failed++;
+		else
+			applied++;
+	}
+
+	if (i > 0) {
+		WRITE_ONCE(ring->applied, ring->applied + applied);
+		WRITE_ONCE(ring->failed, ring->failed + failed);
+		WRITE_ONCE(ring->batches, ring->batches + 1);
+	}
+
+	mutex_unlock(&ring->consumer_lock);
+
+	if (failed) {
+		pr_err_ratelimited("ml_lib: failed to apply recommendations: "
+				   "subsystem %s, model %s, failed %u\n",
+				   ml_model->subsystem_name,
+				   ml_model->model_name, failed);
+	}
+
+	/* the rest of records is applied by the next batch */
+	ml_lib_hint_ring_kick(ml_model);
+}
+
+/*
+ * ml_model_submit_recommendation() - submit recommendation to ML model
+ * @ml_model: ML model object
+ * @hint: recommendation record
+ *
+ * The record is copied into the hint ring of ML model and it is
+ * applied asynchronously by preprocess_recommendation() and
+ * apply_recommendation() methods in process context.
+ * If ml_model_decide() waits for the recommendation of the same
+ * request, then the record is delivered to the waiter instead.
+ * The method never sleeps. Returns -ENOSPC if the ring is full,
+ * -ESTALE if the request of ml_model_decide() has been answered
+ * already and -ENODEV if ML model is being destroyed.
+ */
+int ml_model_submit_recommendation(struct ml_lib_model *ml_model,
+			const struct ml_lib_user_space_recommendation *hint)
+{
+	struct ml_lib_hint_ring *ring;
+	int err = 0;
+
+	if (!ml_model || !hint)
+		return -EINVAL;
+
+	/* ml_model_destroy() waits for the submitters before freeing */
+	rcu_read_lock();
+
+	if (atomic_read(&ml_model->state) == ML_LIB_MODEL_SHUTTING_DOWN) {
+		err = -ENODEV;
+		goto finish_submit;
+	}
+
+	/* the answer of ml_model_decide() is never applied by the ring */
+	err = ml_lib_decision_complete(ml_model, hint, NULL);
+	if (err != -ENOENT)
+		goto finish_submit;
+	err = 0;
+
+	ring = READ_ONCE(ml_model->hints);
+	if (!ring) {
+		err = -ENODEV;
+		goto finish_submit;
+	}
+
+	err = ml_lib_hint_ring_push(ring, hint);
+	if (err)
+		goto finish_submit;
+
+	if (!work_pending(&ml_model->hint_work))
+		ml_lib_worker_queue_work(ml_model, &ml_model->hint_work);
+
+finish_submit:
+	rcu_read_unlock();
+
+	return err;
+}
+EXPORT_SYMBOL(ml_model_submit_recommendation);
+
+ssize_t ml_lib_hint_ring_info(struct ml_lib_model *ml_model, char *buf)
+{
+	struct ml_lib_hint_ring *ring = ml_model->hints;
+
+	if (!ring)
+		return sysfs_emit(buf, "none\n");
+
+	return sysfs_emit(buf,
+			  "queued %u depth %u submitted %llu dropped %llu "
+			  "applied %llu failed %llu batches %llu\n",
+			  ml_lib_hint_ring_count(ring), ring->depth,
+			  atomic64_read(&ring->submitted),
+			  atomic64_read(&ring->dropped),
+			  READ_ONCE(ring->applied),
+			  READ_ONCE(ring->failed),
+			  READ_ONCE(ring->batches));
+}
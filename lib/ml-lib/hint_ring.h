@@ -0,0 +1,22 @@
+// SPDX-License-Identifier: GPL-2.0-only
+/*
+ * Machine Learning (ML) library
+ *
+ * Copyright (C) 2025-2026 Viacheslav Dubeyko <slava@dubeyko.com>
+ */
+
+#ifndef _LINUX_ML_LIB_HINT_RING_H
+#define _LINUX_ML_LIB_HINT_RING_H
+
+#define ML_LIB_HINT_RING_DEPTH_DEFAULT		(1024)
+#define ML_LIB_HINT_RING_DEPTH_MAX		(65536)
+#define ML_LIB_HINT_BATCH_MAX			(256)
+
+struct ml_lib_hint_ring *ml_lib_hint_ring_alloc(u32 depth, gfp_t gfp);
+void ml_lib_hint_ring_free(struct ml_lib_hint_ring *ring);
+u32 ml_lib_hint_ring_count(struct ml_lib_hint_ring *ring);
+void ml_lib_hint_ring_work_func(struct work_struct *work);
+void ml_lib_hint_ring_kick(struct ml_lib_model *ml_model);
+ssize_t ml_lib_hint_ring_info(struct ml_lib_model *ml_model, char *buf);
+
+#endif /* _LINUX_ML_LIB_HINT_RING_H */
@@ -7,14 +7,46 @@
 
 #include <linux/module.h>
 #include <linux/kernel.h>
+#include <linux/rcupdate.h>
+#include <linux/llist.h>
+#include <linux/workqueue.h>
+#include <linux/slab.h>
+#include <linux/poll.h>
+#include <linux/nodemask.h>
+#include <linux/numa.h>
 
 #include <linux/ml-lib/ml_lib.h>
 
 #include "sysfs.h"
+#include "dataset_ring.h"
+#include "dataset_queue.h"
+#include "sample.h"
+#include "compress.h"
+#include "aggregate.h"
+#include "mlp.h"
+#include "model_blob.h"
+#include "registry.h"
+#include "bpf_ops.h"
+#include "worker.h"
+#include "hint_ring.h"
+#include "hint_cache.h"
+#include "governor.h"
+#include "decision.h"
+#include "agent.h"
+#include "preprocess.h"
+
+#define CREATE_TRACE_POINTS
+#include <trace/events/ml_lib.h>
 
 #define UNKNOWN_SUBSYSTEM_NAME "unknown_subsystem"
 #define UNKNOWN_ML_MODEL_NAME "unknown_model"
 
+static struct kmem_cache *ml_lib_subsystem_cachep;
+static struct kmem_cache *ml_lib_options_cachep;
+static struct kmem_cache *ml_lib_state_cachep;
+static struct kmem_cache *ml_lib_dataset_cachep;
+static struct kmem_cache *ml_lib_request_config_cachep;
+
 /*
  * default_ml_model_ops - default ML model operations
  */
@@ -28,6 +60,7 @@ struct ml_lib_model_operations default_ml_model_ops = {
 	.get_system_state		= generic_get_system_state,
 	.get_dataset			= generic_get_dataset,
 	.preprocess_data		= generic_preprocess_data,
+	.compress_data			= generic_compress_data,
 	.publish_data			= generic_publish_data,
 	.preprocess_recommendation	= generic_preprocess_recommendation,
 	.estimate_system_state		= generic_estimate_system_state,
@@ -36,8 +69,177 @@ struct ml_lib_model_operations default_ml_model_ops = {
 	.estimate_efficiency		= generic_estimate_efficiency,
 	.error_backpropagation		= generic_error_backpropagation,
 	.correct_system_state		= generic_correct_system_state,
+	.default_operation		= generic_default_operation,
 };
 
+/*
+ * Descriptors of default type are taken from the per-model pool,
+ * so the steady-state cycle of dataset extraction and discarding
+ * doesn't call the allocator. The pool's descriptors are recycled
+ * through lock-free queue of free descriptors. If the pool is
+ * exhausted, then the descriptor is allocated from the slab cache.
+ */
+
+static inline
+bool ml_model_dataset_from_pool(struct ml_lib_model *ml_model,
+				struct ml_lib_dataset *dataset)
+{
+	return ml_model->dataset_pool &&
+		dataset >= ml_model->dataset_pool &&
+		dataset < ml_model->dataset_pool + ml_model->dataset_pool_size;
+}
+
+static void ml_lib_reset_dataset(struct ml_lib_dataset *dataset)
+{
+	memset(dataset, 0, sizeof(struct ml_lib_dataset));
+	dataset->desc_size = sizeof(struct ml_lib_dataset);
+	atomic_set(&dataset->type, ML_LIB_UNKNOWN_DATASET_TYPE);
+	atomic_set(&dataset->state, ML_LIB_UNKNOWN_DATASET_STATE);
+}
+
+static int ml_model_create_dataset_pool(struct ml_lib_model *ml_model,
+					u32 depth)
+{
+	struct ml_lib_dataset_queue *free_datasets;
+	struct ml_lib_dataset *pool;
+	u32 pool_size;
+	u32 i;
+
+	/* descriptors can wait for RCU grace period after discard */
+	pool_size = min_t(u32, depth * 2, ML_LIB_DATASET_QUEUE_DEPTH_MAX);
+
+	pool = kvcalloc(pool_size, sizeof(struct ml_lib_dataset), GFP_KERNEL);
+	if (unlikely(!pool))
+		return -ENOMEM;
+
+	free_datasets = ml_lib_dataset_queue_alloc(pool_size, GFP_KERNEL);
+	if (IS_ERR(free_datasets)) {
+		kvfree(pool);
+		return PTR_ERR(free_datasets);
+	}
+
+	for (i = 0; i < pool_size; i++) {
+		ml_lib_reset_dataset(&pool[i]);
+		ml_lib_dataset_queue_push(free_datasets, &pool[i]);
+	}
+
+	ml_model->dataset_pool = pool;
+	ml_model->dataset_pool_size = pool_size;
+	ml_model->free_datasets = free_datasets;
+
+	return 0;
+}
+
+static void ml_model_destroy_dataset_pool(struct ml_lib_model *ml_model)
+{
+	ml_lib_dataset_queue_free(ml_model->free_datasets);
+	ml_model->free_datasets = NULL;
+	kvfree(ml_model->dataset_pool);
+	ml_model->dataset_pool = NULL;
+	ml_model->dataset_pool_size = 0;
+}
+
+static
+struct ml_lib_dataset *ml_model_alloc_dataset(struct ml_lib_model *ml_model)
+{
+	size_t desc_size = sizeof(struct ml_lib_dataset);
+	struct ml_lib_dataset *dataset;
+
+	if (ml_model->dataset_ops && ml_model->dataset_ops->allocate)
+		return ml_model->dataset_ops->allocate(desc_size, GFP_KERNEL);
+
+	if (ml_model->free_datasets) {
+		dataset = ml_lib_dataset_queue_pop(ml_model->free_datasets);
+		if (dataset)
+			return dataset;
+	}
+
+	return allocate_dataset(desc_size, GFP_KERNEL);
+}
+
+static
+void ml_model_release_dataset(struct ml_lib_model *ml_model,
+			      struct ml_lib_dataset *dataset)
+{
+	if (!dataset)
+		return;
+
+	if (!ml_model->dataset_ops || !ml_model->dataset_ops->destroy) {
+		/*
+		 * Do nothing
+		 */
+	} else
+		ml_model->dataset_ops->destroy(dataset);
+
+	if (ml_model_dataset_from_pool(ml_model, dataset)) {
+		ml_lib_reset_dataset(dataset);
+		ml_lib_dataset_queue_push(ml_model->free_datasets, dataset);
+		return;
+	}
+
+	if (!ml_model->dataset_ops || !ml_model->dataset_ops->free)
+		free_dataset(dataset);
+	else
+		ml_model->dataset_ops->free(dataset);
+}
+
+/*
+ * Replaced options and discarded datasets are freed after
+ * RCU grace period without blocking the caller. Dataset's
+ * destroy/free methods can sleep, so the RCU callback passes
+ * the dataset into the ML model's reclamation work.
+ */
+
+static void ml_model_options_free_rcu(struct rcu_head *head)
+{
+	struct ml_lib_model_options *options =
+		container_of(head, struct ml_lib_model_options, rcu);
+
+	free_ml_model_options(options);
+}
+
+static
+void ml_model_retire_options(struct ml_lib_model_options *options)
+{
+	if (!options)
+		return;
+
+	call_rcu(&options->rcu, ml_model_options_free_rcu);
+}
+
+static void ml_model_dataset_free_rcu(struct rcu_head *head)
+{
+	struct ml_lib_dataset *dataset =
+		container_of(head, struct ml_lib_dataset, rcu);
+	struct ml_lib_model *ml_model = dataset->owner;
+
+	llist_add(&dataset->reclaim_node, &ml_model->reclaim_list);
+	queue_work(system_unbound_wq, &ml_model->reclaim_work);
+}
+
+static
+void ml_model_retire_dataset(struct ml_lib_model *ml_model,
+			     struct ml_lib_dataset *dataset)
+{
+	if (!dataset)
+		return;
+
+	dataset->owner = ml_model;
+	call_rcu(&dataset->rcu, ml_model_dataset_free_rcu);
+}
+
+static void ml_model_reclaim_work_func(struct work_struct *work)
+{
+	struct ml_lib_model *ml_model =
+		container_of(work, struct ml_lib_model, reclaim_work);
+	struct ml_lib_dataset *dataset, *next;
+	struct llist_node *list;
+
+	list = llist_del_all(&ml_model->reclaim_list);
+	llist_for_each_entry_safe(dataset, next, list, reclaim_node)
+		ml_model_release_dataset(ml_model, dataset);
+}
+
 /******************************************************************************
  *                             ML library API                                 *
  ******************************************************************************/
@@ -56,6 +258,33 @@ void *allocate_ml_model(size_t size, gfp_t gfp)
 	atomic_set(&ml_model->mode, ML_LIB_UNKNOWN_MODE);
 	atomic_set(&ml_model->state, ML_LIB_UNKNOWN_MODEL_STATE);
 	ml_model->model_ops = &default_ml_model_ops;
+	init_waitqueue_head(&ml_model->dataset_wq);
+	mutex_init(&ml_model->fetch_lock);
+
+	mutex_init(&ml_model->stream_lock);
+	ml_model->stream_cursor = 0;
+
+	mutex_init(&ml_model->compress_lock);
+	ml_model->compressor = NULL;
+	atomic64_set(&ml_model->uncompressed_bytes, 0);
+	atomic64_set(&ml_model->compressed_bytes, 0);
+	atomic64_set(&ml_model->published_bytes, 0);
+
+	mutex_init(&ml_model->upload_lock);
+	ml_model->model_version = 0;
+
+	RCU_INIT_POINTER(ml_model->bpf_ops, NULL);
+	INIT_LIST_HEAD(&ml_model->registry_node);
+
+	init_llist_head(&ml_model->reclaim_list);
+	INIT_WORK(&ml_model->reclaim_work, ml_model_reclaim_work_func);
+	ml_lib_worker_init(ml_model);
+	ml_lib_governor_init(ml_model);
+	ml_lib_decision_init(ml_model);
+	ml_lib_agent_init(ml_model);
+	ml_model->hints = NULL;
+	INIT_WORK(&ml_model->hint_work, ml_lib_hint_ring_work_func);
+	ml_model->hint_cache = NULL;
 
 	return (void *)ml_model;
 }
@@ -66,6 +295,12 @@ void free_ml_model(struct ml_lib_model *ml_model)
 	if (!ml_model)
 		return;
 
+	/* wait for deferred reclamation of options and datasets */
+	rcu_barrier();
+	flush_work(&ml_model->reclaim_work);
+
+	ml_model_destroy_dataset_pool(ml_model);
+
 	free_subsystem_object(ml_model->parent);
 	kfree(ml_model);
 }
@@ -78,7 +313,11 @@ void *allocate_subsystem_object(size_t size, gfp_t gfp)
 	if (size < sizeof(struct ml_lib_subsystem))
 		return ERR_PTR(-EINVAL);
 
-	subsystem = kzalloc(size, gfp);
+	if (size == sizeof(struct ml_lib_subsystem))
+		subsystem = kmem_cache_zalloc(ml_lib_subsystem_cachep, gfp);
+	else
+		subsystem = kzalloc(size, gfp);
+
 	if (unlikely(!subsystem))
 		return ERR_PTR(-ENOMEM);
 
@@ -94,7 +333,10 @@ void free_subsystem_object(struct ml_lib_subsystem *object)
 	if (!object)
 		return;
 
-	kfree(object);
+	if (object->size == sizeof(struct ml_lib_subsystem))
+		kmem_cache_free(ml_lib_subsystem_cachep, object);
+	else
+		kfree(object);
 }
 EXPORT_SYMBOL(free_subsystem_object);
 
@@ -105,11 +347,17 @@ void *allocate_ml_model_options(size_t size, gfp_t gfp)
 	if (size < sizeof(struct ml_lib_model_options))
 		return ERR_PTR(-EINVAL);
 
-	options = kzalloc(size, gfp);
+	if (size == sizeof(struct ml_lib_model_options))
+		options = kmem_cache_zalloc(ml_lib_options_cachep, gfp);
+	else
+		options = kzalloc(size, gfp);
+
 	if (unlikely(!options))
 		return ERR_PTR(-ENOMEM);
 
+	options->size = size;
 	options->sleep_timeout = U32_MAX;
+	options->dataset_queue_depth = ML_LIB_DATASET_QUEUE_DEPTH_DEFAULT;
 
 	return (void *)options;
 }
@@ -120,18 +368,44 @@ void free_ml_model_options(struct ml_lib_model_options *options)
 	if (!options)
 		return;
 
-	kfree(options);
+	if (options->size == sizeof(struct ml_lib_model_options))
+		kmem_cache_free(ml_lib_options_cachep, options);
+	else
+		kfree(options);
 }
 EXPORT_SYMBOL(free_ml_model_options);
 
 void *allocate_subsystem_state(size_t size, gfp_t gfp)
 {
-	return NULL;
+	struct ml_lib_subsystem_state *state;
+
+	if (size < sizeof(struct ml_lib_subsystem_state))
+		return ERR_PTR(-EINVAL);
+
+	if (size == sizeof(struct ml_lib_subsystem_state))
+		state = kmem_cache_zalloc(ml_lib_state_cachep, gfp);
+	else
+		state = kzalloc(size, gfp);
+
+	if (unlikely(!state))
+		return ERR_PTR(-ENOMEM);
+
+	state->size = size;
+	atomic_set(&state->state, ML_LIB_UNKNOWN_SUBSYSTEM_STATE);
+
+	return (void *)state;
 }
 EXPORT_SYMBOL(allocate_subsystem_state);
 
 void free_subsystem_state(struct ml_lib_subsystem_state *state)
 {
+	if (!state)
+		return;
+
+	if (state->size == sizeof(struct ml_lib_subsystem_state))
+		kmem_cache_free(ml_lib_state_cachep, state);
+	else
+		kfree(state);
 }
 EXPORT_SYMBOL(free_subsystem_state);
 
@@ -142,10 +416,15 @@ void *allocate_dataset(size_t size, gfp_t gfp)
 	if (size < sizeof(struct ml_lib_dataset))
 		return ERR_PTR(-EINVAL);
 
-	dataset = kzalloc(size, gfp);
+	if (size == sizeof(struct ml_lib_dataset))
+		dataset = kmem_cache_zalloc(ml_lib_dataset_cachep, gfp);
+	else
+		dataset = kzalloc(size, gfp);
+
 	if (unlikely(!dataset))
 		return ERR_PTR(-ENOMEM);
 
+	dataset->desc_size = size;
 	atomic_set(&dataset->type, ML_LIB_UNKNOWN_DATASET_TYPE);
 	atomic_set(&dataset->state, ML_LIB_UNKNOWN_DATASET_STATE);
 
@@ -158,18 +437,45 @@ void free_dataset(struct ml_lib_dataset *dataset)
 	if (!dataset)
 		return;
 
-	kfree(dataset);
+	if (dataset->desc_size == sizeof(struct ml_lib_dataset))
+		kmem_cache_free(ml_lib_dataset_cachep, dataset);
+	else
+		kfree(dataset);
 }
 EXPORT_SYMBOL(free_dataset);
 
 void *allocate_request_config(size_t size, gfp_t gfp)
 {
-	return NULL;
+	struct ml_lib_request_config *config;
+
+	if (size < sizeof(struct ml_lib_request_config))
+		return ERR_PTR(-EINVAL);
+
+	if (size == sizeof(struct ml_lib_request_config))
+		config = kmem_cache_zalloc(ml_lib_request_config_cachep, gfp);
+	else
+		config = kzalloc(size, gfp);
+
+	if (unlikely(!config))
+		return ERR_PTR(-ENOMEM);
+
+	config->size = size;
+	atomic_set(&config->type, ML_LIB_UNKNOWN_REQUEST_CONFIG_TYPE);
+	atomic_set(&config->state, ML_LIB_REQUEST_CONFIG_ALLOCATED);
+
+	return (void *)config;
 }
 EXPORT_SYMBOL(allocate_request_config);
 
 void free_request_config(struct ml_lib_request_config *config)
 {
+	if (!config)
+		return;
+
+	if (config->size == sizeof(struct ml_lib_request_config))
+		kmem_cache_free(ml_lib_request_config_cachep, config);
+	else
+		kfree(config);
 }
 EXPORT_SYMBOL(free_request_config);
 
@@ -202,7 +508,6 @@ int ml_model_create(struct ml_lib_model *ml_model,
 
 	spin_lock_init(&ml_model->parent_state_lock);
 	spin_lock_init(&ml_model->options_lock);
-	spin_lock_init(&ml_model->dataset_lock);
 
 	err = ml_model_create_sysfs_group(ml_model, parent);
 	if (err) {
@@ -229,6 +534,7 @@ int ml_model_create(struct ml_lib_model *ml_model,
 		}
 	}
 
+	ml_lib_model_register(ml_model);
 	atomic_set(&ml_model->state, ML_LIB_MODEL_CREATED);
 
 	return 0;
@@ -241,6 +547,40 @@ finish_model_create:
 }
 EXPORT_SYMBOL(ml_model_create);
 
+static int ml_model_setup_compressor(struct ml_lib_model *ml_model,
+				     u32 algorithm)
+{
+	struct ml_lib_compressor *compressor = NULL;
+	int err = 0;
+
+	if (algorithm >= ML_LIB_COMPRESSION_MAX)
+		return -EINVAL;
+
+	mutex_lock(&ml_model->compress_lock);
+
+	if (ml_lib_compressor_algorithm(ml_model->compressor) == algorithm)
+		goto finish_setup_compressor;
+
+	if (algorithm != ML_LIB_NO_COMPRESSION) {
+		compressor = ml_lib_compressor_create(algorithm);
+		if (IS_ERR(compressor)) {
+			err = PTR_ERR(compressor);
+			pr_err("ml_lib: failed to create compressor: "
+				"algorithm %u, err %d\n",
+				algorithm, err);
+			goto finish_setup_compressor;
+		}
+	}
+
+	ml_lib_compressor_destroy(ml_model->compressor);
+	ml_model->compressor = compressor;
+
+finish_setup_compressor:
+	mutex_unlock(&ml_model->compress_lock);
+
+	return err;
+}
+
 int ml_model_init(struct ml_lib_model *ml_model,
 		  struct ml_lib_model_options *options)
 {
@@ -261,13 +601,93 @@ int ml_model_init(struct ml_lib_model *ml_model,
 		}
 	}
 
+	if (!ml_model->datasets) {
+		struct ml_lib_dataset_queue *queue;
+		u32 depth = options->dataset_queue_depth;
+
+		if (!depth)
+			depth = ML_LIB_DATASET_QUEUE_DEPTH_DEFAULT;
+
+		queue = ml_lib_dataset_queue_alloc(depth, GFP_KERNEL);
+		if (IS_ERR(queue)) {
+			err = PTR_ERR(queue);
+			pr_err("ml_lib: failed to allocate dataset queue: "
+				"depth %u, err %d\n",
+				depth, err);
+			goto finish_model_init;
+		}
+
+		ml_model->datasets = queue;
+
+		if (!ml_model->dataset_ops || !ml_model->dataset_ops->allocate) {
+			err = ml_model_create_dataset_pool(ml_model, depth);
+			if (unlikely(err)) {
+				pr_err("ml_lib: failed to create dataset pool: "
+					"err %d\n", err);
+				/* fall back to slab cache allocation */
+				err = 0;
+			}
+		}
+	}
+
+	if (!ml_model->hints) {
+		struct ml_lib_hint_ring *hints;
+		u32 depth = options->hint_ring_depth;
+
+		if (!depth)
+			depth = ML_LIB_HINT_RING_DEPTH_DEFAULT;
+
+		hints = ml_lib_hint_ring_alloc(depth, GFP_KERNEL);
+		if (IS_ERR(hints)) {
+			err = PTR_ERR(hints);
+			pr_err("ml_lib: failed to allocate hint ring: "
+				"depth %u, err %d\n",
+				depth, err);
+			goto finish_model_init;
+		}
+
+		ml_model->hints = hints;
+	}
+
+	if (!ml_model->hint_cache && options->hint_cache_entries) {
+		struct ml_lib_hint_cache *cache;
+
+		cache = ml_lib_hint_cache_alloc(options->hint_cache_entries,
+						GFP_KERNEL);
+		if (IS_ERR(cache)) {
+			err = PTR_ERR(cache);
+			pr_err("ml_lib: failed to allocate hint cache: "
+				"entries %u, err %d\n",
+				options->hint_cache_entries, err);
+			goto finish_model_init;
+		}
+
+		ml_model->hint_cache = cache;
+	}
+
+	if (!ml_model->ring && options->ring_slots) {
+		err = ml_model_create_dataset_ring(ml_model,
+						   options->ring_slots,
+						   options->ring_portion_size);
+		if (unlikely(err)) {
+			pr_err("ml_lib: failed to create dataset ring: "
+				"slots %u, portion size %u, err %d\n",
+				options->ring_slots,
+				options->ring_portion_size, err);
+			goto finish_model_init;
+		}
+	}
+
+	err = ml_model_setup_compressor(ml_model, options->compression);
+	if (unlikely(err))
+		goto finish_model_init;
+
 	spin_lock(&ml_model->options_lock);
 	old_options = rcu_dereference_protected(ml_model->options,
 				lockdep_is_held(&ml_model->options_lock));
 	rcu_assign_pointer(ml_model->options, options);
 	spin_unlock(&ml_model->options_lock);
-	synchronize_rcu();
-	free_ml_model_options(old_options);
+	ml_model_retire_options(old_options);
 
 	atomic_set(&ml_model->state, ML_LIB_MODEL_INITIALIZED);
 
@@ -280,85 +700,248 @@ int ml_model_re_init(struct ml_lib_model *ml_model,
 		     struct ml_lib_model_options *options)
 {
 	struct ml_lib_model_options *old_options;
+	int err;
 
 	if (!ml_model)
 		return -EINVAL;
 
+	err = ml_model_setup_compressor(ml_model, options->compression);
+	if (unlikely(err))
+		return err;
+
 	spin_lock(&ml_model->options_lock);
 	old_options = rcu_dereference_protected(ml_model->options,
 				lockdep_is_held(&ml_model->options_lock));
 	rcu_assign_pointer(ml_model->options, options);
 	spin_unlock(&ml_model->options_lock);
-	synchronize_rcu();
-	free_ml_model_options(old_options);
+	ml_model_retire_options(old_options);
 
 	return 0;
 }
 EXPORT_SYMBOL(ml_model_re_init);
 
+/*
+ * Replace the options by the copy with corrected sleep_timeout.
+ * The options can be replaced concurrently by re_init(),
+ * so the copy is repeated if the size of options has changed.
+ */
+static int ml_model_correct_sleep_timeout(struct ml_lib_model *ml_model,
+					  u32 sleep_timeout)
+{
+	struct ml_lib_model_options *old_options;
+	struct ml_lib_model_options *new_options;
+	size_t size;
+
+try_again:
+	rcu_read_lock();
+	old_options = rcu_dereference(ml_model->options);
+	size = old_options ? old_options->size : 0;
+	rcu_read_unlock();
+
+	if (!size)
+		return -ENODEV;
+
+	new_options = allocate_ml_model_options(size, GFP_KERNEL);
+	if (IS_ERR(new_options))
+		return PTR_ERR(new_options);
+
+	spin_lock(&ml_model->options_lock);
+	old_options = rcu_dereference_protected(ml_model->options,
+				lockdep_is_held(&ml_model->options_lock));
+	if (!old_options || old_options->size != size) {
+		spin_unlock(&ml_model->options_lock);
+		free_ml_model_options(new_options);
+		goto try_again;
+	}
+	memcpy(new_options, old_options, size);
+	new_options->sleep_timeout = sleep_timeout;
+	rcu_assign_pointer(ml_model->options, new_options);
+	spin_unlock(&ml_model->options_lock);
+	ml_model_retire_options(old_options);
+
+	return 0;
+}
+
+/*
+ * ml_model_start() - start the worker of ML model
+ * @ml_model: ML model object
+ * @config: run config
+ *
+ * The worker extracts, preprocesses, compresses and publishes
+ * the datasets every sleep_timeout milliseconds until
+ * ml_model_stop() call.
+ */
 int ml_model_start(struct ml_lib_model *ml_model,
 		   struct ml_lib_model_run_config *config)
 {
+	int err;
+
 	if (!ml_model)
 		return -EINVAL;
 
-	/* TODO: implement ML model start logic*/
-	atomic_set(&ml_model->state, ML_LIB_MODEL_STARTED);
-	pr_err("ml_lib: TODO: implement start ML model\n");
+	if (!ml_model->model_ops || !ml_model->model_ops->start)
+		err = generic_start_ml_model(ml_model, config);
+	else
+		err = ml_model->model_ops->start(ml_model, config);
+
+	if (unlikely(err)) {
+		pr_err("ml_lib: failed to start ML model: err %d\n", err);
+		return err;
+	}
+
+	err = ml_lib_worker_start(ml_model);
+	if (unlikely(err))
+		return err;
+
+	ml_lib_governor_start(ml_model);
+
 	return 0;
 }
 EXPORT_SYMBOL(ml_model_start);
 
+/*
+ * ml_model_stop() - stop the worker of ML model
+ * @ml_model: ML model object
+ *
+ * The method waits for the end of worker's cycle in progress.
+ * The published datasets stay in the queue.
+ */
 int ml_model_stop(struct ml_lib_model *ml_model)
 {
+	int err;
+
 	if (!ml_model)
 		return -EINVAL;
 
-	/* TODO: implement ML model stop logic*/
-	atomic_set(&ml_model->state, ML_LIB_MODEL_STOPPED);
-	pr_err("ml_lib: TODO: implement stop ML model\n");
-	return 0;
+	ml_lib_governor_stop(ml_model);
+	ml_lib_worker_stop(ml_model);
+
+	if (!ml_model->model_ops || !ml_model->model_ops->stop)
+		err = generic_stop_ml_model(ml_model);
+	else
+		err = ml_model->model_ops->stop(ml_model);
+
+	if (unlikely(err))
+		pr_err("ml_lib: failed to stop ML model: err %d\n", err);
+
+	return err;
 }
 EXPORT_SYMBOL(ml_model_stop);
 
+/*
+ * ml_model_set_numa_node() - define NUMA node of ML model's worker
+ * @ml_model: ML model object
+ * @node: NUMA node (NUMA_NO_NODE - any node)
+ *
+ * The worker's cycles are executed by the threads of @node, so
+ * the datasets are extracted close to the subsystem's data
+ * (for example, the block device's queue).
+ */
+int ml_model_set_numa_node(struct ml_lib_model *ml_model, int node)
+{
+	if (!ml_model)
+		return -EINVAL;
+
+	if (node != NUMA_NO_NODE &&
+	    (node < 0 || node >= MAX_NUMNODES || !node_online(node)))
+		return -EINVAL;
+
+	WRITE_ONCE(ml_model->numa_node, node);
+
+	return 0;
+}
+EXPORT_SYMBOL(ml_model_set_numa_node);
+
+/*
+ * ml_model_set_mode() - switch the mode of ML model
+ * @ml_model: ML model object
+ * @mode: new mode (enum ml_lib_system_mode)
+ */
+int ml_model_set_mode(struct ml_lib_model *ml_model, int mode)
+{
+	int old_mode;
+
+	if (!ml_model)
+		return -EINVAL;
+
+	if (mode <= ML_LIB_UNKNOWN_MODE || mode >= ML_LIB_MODE_MAX)
+		return -EINVAL;
+
+	old_mode = atomic_xchg(&ml_model->mode, mode);
+	if (old_mode != mode) {
+		trace_ml_lib_mode_change(ml_model, old_mode, mode,
+					 ML_LIB_MODE_CHANGE_MANUAL,
+					 READ_ONCE(ml_model->governor.efficiency),
+					 READ_ONCE(ml_model->governor.latency_ns));
+	}
+
+	return 0;
+}
+EXPORT_SYMBOL(ml_model_set_mode);
+
 void ml_model_destroy(struct ml_lib_model *ml_model)
 {
 	struct ml_lib_model_options *old_options;
 	struct ml_lib_dataset *old_dataset;
+	struct ml_lib_dataset_queue *queue;
 
 	if (!ml_model)
 		return;
 
-	atomic_set(&ml_model->state, ML_LIB_MODEL_SHUTTING_DOWN);
+	/* the BPF struct_ops cannot find the ML model from now */
+	ml_lib_model_unregister(ml_model);
 
+	/* the attributes cannot start the worker or the governor again */
 	ml_model_delete_sysfs_group(ml_model);
 
+	ml_lib_worker_shutdown(ml_model);
+	ml_lib_governor_stop(ml_model);
+	wake_up_interruptible_poll(&ml_model->dataset_wq, EPOLLHUP);
+
+	/* the agents' answers are rejected from now */
+	ml_lib_agent_detach_all(ml_model);
+
+	/*
+	 * The submitters check SHUTTING_DOWN state in RCU read-side
+	 * critical section, so nobody touches the hint ring and the cache
+	 * or queues the drain work after the grace period.
+	 */
+	synchronize_rcu();
+
+	/* the submitted recommendations aren't applied anymore */
+	cancel_work_sync(&ml_model->hint_work);
+	ml_lib_hint_ring_free(ml_model->hints);
+	WRITE_ONCE(ml_model->hints, NULL);
+
+	ml_lib_hint_cache_free(ml_model->hint_cache);
+	WRITE_ONCE(ml_model->hint_cache, NULL);
+
+	ml_lib_bpf_detach(ml_model);
+
 	spin_lock(&ml_model->options_lock);
 	old_options = rcu_dereference_protected(ml_model->options,
 				lockdep_is_held(&ml_model->options_lock));
 	rcu_assign_pointer(ml_model->options, NULL);
 	spin_unlock(&ml_model->options_lock);
-	synchronize_rcu();
-	free_ml_model_options(old_options);
+	ml_model_retire_options(old_options);
 
-	spin_lock(&ml_model->dataset_lock);
-	old_dataset = rcu_dereference_protected(ml_model->dataset,
-				lockdep_is_held(&ml_model->dataset_lock));
-	rcu_assign_pointer(ml_model->dataset, NULL);
-	spin_unlock(&ml_model->dataset_lock);
-	synchronize_rcu();
+	queue = ml_model->datasets;
+	ml_model->datasets = NULL;
 
-	if (!ml_model->dataset_ops || !ml_model->dataset_ops->destroy) {
-		/*
-		 * Do nothing
-		 */
-	} else
-		ml_model->dataset_ops->destroy(old_dataset);
+	if (queue) {
+		while ((old_dataset = ml_lib_dataset_queue_pop(queue)))
+			ml_model_retire_dataset(ml_model, old_dataset);
 
-	if (!ml_model->dataset_ops || !ml_model->dataset_ops->free)
-		free_dataset(old_dataset);
-	else
-		ml_model->dataset_ops->free(old_dataset);
+		ml_lib_dataset_queue_free(queue);
+	}
+
+	ml_model_destroy_sample_buffers(ml_model);
+	ml_model_destroy_dataset_ring(ml_model);
+	ml_model_setup_compressor(ml_model, ML_LIB_NO_COMPRESSION);
+	ml_model_set_preprocess_config(ml_model, NULL);
+	ml_model_unload_tree_ensemble(ml_model);
+	ml_model_unload_mlp(ml_model);
+	ml_lib_model_blob_destroy(ml_model);
 
 	if (!ml_model->model_ops || !ml_model->model_ops->destroy) {
 		atomic_set(&ml_model->parent->type,
@@ -376,48 +959,125 @@ struct ml_lib_subsystem_state *get_system_state(struct ml_lib_model *ml_model)
 }
 EXPORT_SYMBOL(get_system_state);
 
-int ml_model_get_dataset(struct ml_lib_model *ml_model,
-			 struct ml_lib_request_config *config,
-			 struct ml_lib_user_space_request *request)
+static u32 ml_model_portion_limit(struct ml_lib_model *ml_model,
+				  struct ml_lib_dataset *dataset)
 {
-	struct ml_lib_dataset *old_dataset;
-	struct ml_lib_dataset *new_dataset;
-	size_t desc_size = sizeof(struct ml_lib_dataset);
-	int state;
-	int err = 0;
+	struct ml_lib_model_options *options;
+	struct ml_lib_preprocess_config *config;
+	u32 limit = U32_MAX;
 
-	if (!ml_model)
-		return -EINVAL;
+	rcu_read_lock();
+	options = rcu_dereference(ml_model->options);
+	if (options && options->stream_chunk_size)
+		limit = options->stream_chunk_size;
+	rcu_read_unlock();
 
-	atomic_set(&ml_model->state, ML_LIB_MODEL_RUNNING);
+	if (dataset->payload)
+		limit = min_t(size_t, limit, dataset->allocated_size);
 
+	/* preprocessing stage requires whole records */
 	rcu_read_lock();
-	old_dataset = rcu_dereference(ml_model->dataset);
-	if (old_dataset)
-		state = atomic_read(&old_dataset->state);
-	else
-		state = ML_LIB_UNKNOWN_DATASET_STATE;
+	config = rcu_dereference(ml_model->preprocess_config);
+	if (config && limit >= config->in_record_size)
+		limit = rounddown(limit, config->in_record_size);
 	rcu_read_unlock();
 
-	switch (state) {
-	case ML_LIB_DATASET_CLEAN:
+	return limit;
+}
+
+static void ml_model_advance_stream(struct ml_lib_model *ml_model,
+				    struct ml_lib_dataset *dataset)
+{
+	lockdep_assert_held(&ml_model->stream_lock);
+
+	switch (atomic_read(&dataset->state)) {
 	case ML_LIB_DATASET_EXTRACTED_PARTIALLY:
+		ml_model->stream_cursor = dataset->portion_offset +
+						dataset->portion_size;
+		break;
+
 	case ML_LIB_DATASET_EXTRACTED_COMPLETELY:
-		/* nothing should be done */
-		goto finish_get_dataset;
+		/* the next extraction starts a new pass over the stream */
+		ml_model->stream_cursor = 0;
+		break;
 
 	default:
-		/* continue logic */
+		/* extract method doesn't support streaming */
 		break;
 	}
+}
 
-	if (!ml_model->dataset_ops || !ml_model->dataset_ops->allocate)
-		new_dataset = allocate_dataset(desc_size, GFP_KERNEL);
-	else {
-		new_dataset = ml_model->dataset_ops->allocate(desc_size,
-							      GFP_KERNEL);
+u64 ml_model_stream_cursor(struct ml_lib_model *ml_model)
+{
+	u64 cursor;
+
+	if (!ml_model)
+		return 0;
+
+	mutex_lock(&ml_model->stream_lock);
+	cursor = ml_model->stream_cursor;
+	mutex_unlock(&ml_model->stream_lock);
+
+	return cursor;
+}
+EXPORT_SYMBOL(ml_model_stream_cursor);
+
+void ml_model_reset_stream(struct ml_lib_model *ml_model)
+{
+	if (!ml_model)
+		return;
+
+	mutex_lock(&ml_model->stream_lock);
+	ml_model->stream_cursor = 0;
+	mutex_unlock(&ml_model->stream_lock);
+}
+EXPORT_SYMBOL(ml_model_reset_stream);
+
+/*
+ * Every queued dataset keeps its slot of the ring, so the ring cannot
+ * hold more queued datasets than it has slots: the next reservation
+ * would overwrite the payload of the oldest queued dataset.
+ */
+static bool ml_model_dataset_queue_full(struct ml_lib_model *ml_model)
+{
+	u32 limit = ml_lib_dataset_queue_depth(ml_model->datasets);
+
+	if (ml_model->ring)
+		limit = min(limit, ml_lib_dataset_ring_nr_slots(ml_model->ring));
+
+	return ml_lib_dataset_queue_count(ml_model->datasets) >= limit;
+}
+
+int ml_model_get_dataset(struct ml_lib_model *ml_model,
+			 struct ml_lib_request_config *config,
+			 struct ml_lib_user_space_request *request)
+{
+	struct ml_lib_dataset *new_dataset;
+	bool slot_reserved = false;
+	u32 capacity;
+	long pos;
+	int state;
+	int err = 0;
+
+	if (!ml_model)
+		return -EINVAL;
+
+	if (!ml_model->datasets)
+		return -ENODEV;
+
+	/* the destruction of ML model is never undone */
+	state = atomic_read(&ml_model->state);
+	if (state != ML_LIB_MODEL_RUNNING &&
+	    state != ML_LIB_MODEL_SHUTTING_DOWN)
+		atomic_cmpxchg(&ml_model->state, state, ML_LIB_MODEL_RUNNING);
+
+	/* the cheap check only, the limit is enforced before publication */
+	if (ml_model_dataset_queue_full(ml_model)) {
+		/* consumer should discard the oldest dataset */
+		return -ENOSPC;
 	}
 
+	new_dataset = ml_model_alloc_dataset(ml_model);
 	if (IS_ERR(new_dataset)) {
 		err = PTR_ERR(new_dataset);
 		pr_err("ml_lib: Failed to allocate dataset\n");
@@ -441,14 +1101,32 @@ int ml_model_get_dataset(struct ml_lib_model *ml_model,
 		}
 	}
 
+	if (ml_model->ring) {
+		new_dataset->payload =
+			ml_lib_dataset_ring_reserve(ml_model->ring, &capacity);
+		new_dataset->allocated_size = capacity;
+		slot_reserved = true;
+	}
+
 	if (!ml_model->dataset_ops || !ml_model->dataset_ops->extract) {
 		atomic_set(&new_dataset->type, ML_LIB_EMPTY_DATASET);
 		atomic_set(&new_dataset->state, ML_LIB_DATASET_CLEAN);
-		new_dataset->allocated_size = 0;
+		if (!new_dataset->payload)
+			new_dataset->allocated_size = 0;
 		new_dataset->portion_offset = 0;
 		new_dataset->portion_size = 0;
 	} else {
+		mutex_lock(&ml_model->stream_lock);
+		new_dataset->portion_offset = ml_model->stream_cursor;
+		new_dataset->portion_size = 0;
+		new_dataset->portion_limit =
+				ml_model_portion_limit(ml_model, new_dataset);
+
 		err = ml_model->dataset_ops->extract(ml_model, new_dataset);
+		if (!err)
+			ml_model_advance_stream(ml_model, new_dataset);
+		mutex_unlock(&ml_model->stream_lock);
+
 		if (err) {
 			pr_err("ml_lib: Failed to extract dataset: err %d\n",
 				err);
@@ -456,104 +1134,287 @@ int ml_model_get_dataset(struct ml_lib_model *ml_model,
 		}
 	}
 
-	spin_lock(&ml_model->dataset_lock);
-	old_dataset = rcu_dereference_protected(ml_model->dataset,
-				lockdep_is_held(&ml_model->dataset_lock));
-	rcu_assign_pointer(ml_model->dataset, new_dataset);
-	spin_unlock(&ml_model->dataset_lock);
-	synchronize_rcu();
+	if (atomic_read(&new_dataset->type) == ML_LIB_MEMORY_STREAM_DATASET) {
+		err = ml_model_preprocess_data(ml_model, new_dataset);
+		if (err) {
+			pr_err("ml_lib: Failed to preprocess dataset: err %d\n",
+				err);
+			goto fail_get_dataset;
+		}
+	}
 
-	if (!ml_model->dataset_ops || !ml_model->dataset_ops->destroy) {
-		/*
-		 * Do nothing
-		 */
-	} else
-		ml_model->dataset_ops->destroy(old_dataset);
+	/* raw samples cannot be mixed with the preprocessed records */
+	if (!new_dataset->preprocessed &&
+	    ml_lib_samples_drain(ml_model, new_dataset) > 0 &&
+	    atomic_read(&new_dataset->type) == ML_LIB_EMPTY_DATASET) {
+		atomic_set(&new_dataset->type, ML_LIB_MEMORY_STREAM_DATASET);
+		atomic_set(&new_dataset->state,
+			   ML_LIB_DATASET_EXTRACTED_COMPLETELY);
+	}
 
-	if (!ml_model->dataset_ops || !ml_model->dataset_ops->free)
-		free_dataset(old_dataset);
-	else
-		ml_model->dataset_ops->free(old_dataset);
+	if (atomic_read(&new_dataset->type) == ML_LIB_MEMORY_STREAM_DATASET) {
+		err = ml_model_compress_data(ml_model, new_dataset);
+		if (err) {
+			pr_err("ml_lib: Failed to compress dataset: err %d\n",
+				err);
+			goto fail_get_dataset;
+		}
+	}
+
+	/*
+	 * The producers of the ring are serialized by the reserved slot,
+	 * so the limit of queued datasets cannot be exceeded concurrently.
+	 * The cell of the queue is claimed before the slot is committed:
+	 * the consumers never see the slot of the dataset that hasn't
+	 * been queued.
+	 */
+	if (slot_reserved && ml_model_dataset_queue_full(ml_model)) {
+		err = -ENOSPC;
+		goto fail_get_dataset;
+	}
+
+	err = ml_lib_dataset_queue_reserve(ml_model->datasets, &pos);
+	if (err) {
+		/* concurrent producers have occupied the free cells */
+		goto fail_get_dataset;
+	}
+
+	if (slot_reserved) {
+		if (atomic_read(&new_dataset->type) ==
+					ML_LIB_MEMORY_STREAM_DATASET)
+			ml_lib_dataset_ring_commit(ml_model->ring, new_dataset);
+		else
+			ml_lib_dataset_ring_abort(ml_model->ring);
+
+		slot_reserved = false;
+	}
+
+	ml_lib_dataset_queue_publish(ml_model->datasets, pos, new_dataset);
+
+	atomic64_add(new_dataset->portion_size, &ml_model->published_bytes);
+	trace_ml_lib_dataset_publish(ml_model, new_dataset);
+
+	/* wq_has_sleeper() keeps the cycle lockless without waiters */
+	if (wq_has_sleeper(&ml_model->dataset_wq))
+		wake_up_interruptible_poll(&ml_model->dataset_wq,
+					   EPOLLIN | EPOLLRDNORM);
 
-finish_get_dataset:
 	return 0;
 
 fail_get_dataset:
-	if (!ml_model->dataset_ops || !ml_model->dataset_ops->destroy) {
-		/*
-		 * Do nothing
-		 */
-	} else
-		ml_model->dataset_ops->destroy(new_dataset);
+	if (slot_reserved)
+		ml_lib_dataset_ring_abort(ml_model->ring);
 
-	if (!ml_model->dataset_ops || !ml_model->dataset_ops->free)
-		free_dataset(new_dataset);
-	else
-		ml_model->dataset_ops->free(new_dataset);
+	ml_model_release_dataset(ml_model, new_dataset);
 
 	return err;
 }
 EXPORT_SYMBOL(ml_model_get_dataset);
 
-int ml_model_discard_dataset(struct ml_lib_model *ml_model)
+/* the caller should hold fetch_lock */
+static int __ml_model_discard_dataset(struct ml_lib_model *ml_model)
 {
 	struct ml_lib_dataset *old_dataset;
-	struct ml_lib_dataset *new_dataset;
-	size_t desc_size = sizeof(struct ml_lib_dataset);
+
+	lockdep_assert_held(&ml_model->fetch_lock);
+
+	old_dataset = ml_lib_dataset_queue_pop(ml_model->datasets);
+	if (!old_dataset)
+		return -ENODATA;
+
+	atomic_set(&old_dataset->state, ML_LIB_DATASET_OBSOLETE);
+
+	/* readers of ml_model_peek_dataset() can still access it */
+	ml_model_retire_dataset(ml_model, old_dataset);
+
+	return 0;
+}
+
+int ml_model_discard_dataset(struct ml_lib_model *ml_model)
+{
 	int err;
 
-	if (!ml_model->dataset_ops || !ml_model->dataset_ops->allocate)
-		new_dataset = allocate_dataset(desc_size, GFP_KERNEL);
-	else {
-		new_dataset = ml_model->dataset_ops->allocate(desc_size,
-							      GFP_KERNEL);
+	if (!ml_model)
+		return -EINVAL;
+
+	if (!ml_model->datasets)
+		return -ENODEV;
+
+	/* the dataset under ml_lib_dataset_fetch() cannot be discarded */
+	mutex_lock(&ml_model->fetch_lock);
+	err = __ml_model_discard_dataset(ml_model);
+	mutex_unlock(&ml_model->fetch_lock);
+
+	return err;
+}
+EXPORT_SYMBOL(ml_model_discard_dataset);
+
+/*
+ * ml_lib_dataset_fetch() - read the oldest dataset and discard it
+ * @ml_model: ML model object
+ * @buf: user-space buffer
+ * @count: size of user-space buffer
+ * @keep: keep the dataset in the queue
+ * @nowait: don't sleep on the lock of consumers
+ * @size: size of dataset's payload [out]
+ *
+ * The whole payload is copied by one call. The consumers that
+ * discard datasets are serialized by fetch_lock, so the dataset
+ * that has been read is the dataset that is discarded and
+ * the concurrent fetchers never lose the datasets.
+ *
+ * Return: number of copied bytes, -ENODATA if there is no dataset,
+ * -EMSGSIZE if @count is smaller than @size, -EAGAIN if @nowait
+ * and the lock is contended, or -ESTALE if the slot has been
+ * overwritten.
+ */
+ssize_t ml_lib_dataset_fetch(struct ml_lib_model *ml_model,
+			     char __user *buf, size_t count,
+			     bool keep, bool nowait, u32 *size)
+{
+	struct ml_lib_dataset *dataset;
+	loff_t pos = 0;
+	ssize_t copied;
+	u64 seq = 0;
+
+	if (!ml_model->ring || !ml_model->datasets)
+		return -ENODEV;
+
+	if (nowait) {
+		if (!mutex_trylock(&ml_model->fetch_lock))
+			return -EAGAIN;
+	} else
+		mutex_lock(&ml_model->fetch_lock);
+
+	rcu_read_lock();
+	dataset = ml_model_peek_dataset(ml_model);
+	if (dataset) {
+		seq = READ_ONCE(dataset->slot_seq);
+		*size = dataset->portion_size;
 	}
+	rcu_read_unlock();
 
-	if (IS_ERR(new_dataset)) {
-		err = PTR_ERR(new_dataset);
-		pr_err("ml_lib: Failed to allocate dataset\n");
-		return err;
-	} else if (!new_dataset) {
-		err = -ENOMEM;
-		pr_err("ml_lib: Failed to allocate dataset\n");
-		return err;
+	if (!seq) {
+		copied = -ENODATA;
+		goto finish_fetch;
 	}
 
-	spin_lock(&ml_model->dataset_lock);
-	old_dataset = rcu_dereference_protected(ml_model->dataset,
-				lockdep_is_held(&ml_model->dataset_lock));
-	if (old_dataset) {
-		atomic_set(&new_dataset->type, atomic_read(&old_dataset->type));
-		new_dataset->allocated_size = old_dataset->allocated_size;
-		new_dataset->portion_offset = old_dataset->portion_offset;
-		new_dataset->portion_size = old_dataset->portion_size;
-	} else {
-		atomic_set(&new_dataset->type, ML_LIB_EMPTY_DATASET);
-		new_dataset->allocated_size = 0;
-		new_dataset->portion_offset = 0;
-		new_dataset->portion_size = 0;
+	if (count < *size) {
+		copied = -EMSGSIZE;
+		goto finish_fetch;
 	}
-	atomic_set(&new_dataset->state, ML_LIB_DATASET_OBSOLETE);
-	rcu_assign_pointer(ml_model->dataset, new_dataset);
-	spin_unlock(&ml_model->dataset_lock);
-	synchronize_rcu();
 
-	if (!ml_model->dataset_ops || !ml_model->dataset_ops->free)
-		free_dataset(old_dataset);
-	else
-		ml_model->dataset_ops->free(old_dataset);
+	copied = ml_model_read_dataset(ml_model, buf, count, &pos);
+	if (copied == 0)
+		copied = -ENODATA;
+	if (copied < 0 || keep)
+		goto finish_fetch;
 
-	return 0;
+	/* no other consumer could dequeue the dataset under the lock */
+	__ml_model_discard_dataset(ml_model);
+
+finish_fetch:
+	mutex_unlock(&ml_model->fetch_lock);
+
+	return copied;
 }
-EXPORT_SYMBOL(ml_model_discard_dataset);
 
+/*
+ * ml_model_peek_dataset() - get the oldest not discarded dataset
+ * @ml_model: ML model object
+ *
+ * The caller should be in RCU read-side critical section.
+ * The dataset is valid until rcu_read_unlock().
+ */
+struct ml_lib_dataset *ml_model_peek_dataset(struct ml_lib_model *ml_model)
+{
+	if (!ml_model || !ml_model->datasets)
+		return NULL;
+
+	return ml_lib_dataset_queue_peek(ml_model->datasets);
+}
+EXPORT_SYMBOL(ml_model_peek_dataset);
+
+/*
+ * ml_model_poll() - check readiness of published datasets
+ * @ml_model: ML model object
+ * @file: file of kernel subsystem that owns the ML model
+ * @wait: poll table
+ *
+ * The method can be used by file_operations::poll of kernel
+ * subsystem that owns the ML model. EPOLLIN is reported if
+ * any dataset is waiting for consumer; EPOLLHUP is reported
+ * if the ML model is being destroyed.
+ */
+__poll_t ml_model_poll(struct ml_lib_model *ml_model, struct file *file,
+			struct poll_table_struct *wait)
+{
+	struct ml_lib_dataset_queue *queue;
+	__poll_t mask = 0;
+
+	if (!ml_model)
+		return EPOLLERR;
+
+	poll_wait(file, &ml_model->dataset_wq, wait);
+
+	if (atomic_read(&ml_model->state) == ML_LIB_MODEL_SHUTTING_DOWN)
+		return EPOLLHUP;
+
+	queue = READ_ONCE(ml_model->datasets);
+	if (queue && ml_lib_dataset_queue_count(queue) > 0)
+		mask |= EPOLLIN | EPOLLRDNORM;
+
+	return mask;
+}
+EXPORT_SYMBOL(ml_model_poll);
+
+/*
+ * ml_model_preprocess_data() - preprocess dataset's payload
+ * @ml_model: ML model object
+ * @dataset: dataset object
+ *
+ * The generic implementation transforms the payload in place
+ * by the configuration of ml_model_set_preprocess_config().
+ * The method sets @dataset->preprocessed if the layout of payload
+ * has been changed; the recorded samples aren't appended into
+ * such payload.
+ */
 int ml_model_preprocess_data(struct ml_lib_model *ml_model,
 			     struct ml_lib_dataset *dataset)
 {
-	return -EOPNOTSUPP;
+	if (!ml_model || !dataset)
+		return -EINVAL;
+
+	if (!ml_model->model_ops || !ml_model->model_ops->preprocess_data)
+		return generic_preprocess_data(ml_model, dataset);
+
+	return ml_model->model_ops->preprocess_data(ml_model, dataset);
 }
 EXPORT_SYMBOL(ml_model_preprocess_data);
 
+/*
+ * ml_model_compress_data() - compress dataset's payload
+ * @ml_model: ML model object
+ * @dataset: dataset object
+ *
+ * The compression stage is executed between the preprocessing
+ * and publishing of the dataset. The payload is compressed
+ * in place by the algorithm that is defined by model's options.
+ * The payload stays raw if it is incompressible.
+ */
+int ml_model_compress_data(struct ml_lib_model *ml_model,
+			   struct ml_lib_dataset *dataset)
+{
+	if (!ml_model || !dataset)
+		return -EINVAL;
+
+	if (!ml_model->model_ops || !ml_model->model_ops->compress_data)
+		return generic_compress_data(ml_model, dataset);
+
+	return ml_model->model_ops->compress_data(ml_model, dataset);
+}
+EXPORT_SYMBOL(ml_model_compress_data);
+
 int ml_model_publish_data(struct ml_lib_model *ml_model,
 			  struct ml_lib_dataset *dataset,
 			  struct ml_lib_user_space_notification *notify)
@@ -565,20 +1426,50 @@ EXPORT_SYMBOL(ml_model_publish_data);
 int ml_model_preprocess_recommendation(struct ml_lib_model *ml_model,
 			 struct ml_lib_user_space_recommendation *hint)
 {
-	return -EOPNOTSUPP;
+	if (!ml_model || !hint)
+		return -EINVAL;
+
+	if (!ml_model->model_ops ||
+	    !ml_model->model_ops->preprocess_recommendation)
+		return generic_preprocess_recommendation(ml_model, hint);
+
+	return ml_model->model_ops->preprocess_recommendation(ml_model, hint);
 }
 EXPORT_SYMBOL(ml_model_preprocess_recommendation);
 
 int estimate_system_state(struct ml_lib_model *ml_model)
 {
-	return -EOPNOTSUPP;
+	int err;
+
+	if (!ml_model)
+		return -EINVAL;
+
+	if (ml_lib_bpf_estimate_system_state(ml_model, &err))
+		return err;
+
+	if (!ml_model->model_ops ||
+	    !ml_model->model_ops->estimate_system_state)
+		return generic_estimate_system_state(ml_model);
+
+	return ml_model->model_ops->estimate_system_state(ml_model);
 }
 EXPORT_SYMBOL(estimate_system_state);
 
 int apply_ml_model_recommendation(struct ml_lib_model *ml_model,
 			 struct ml_lib_user_space_recommendation *hint)
 {
-	return -EOPNOTSUPP;
+	int err;
+
+	if (!ml_model || !hint)
+		return -EINVAL;
+
+	if (ml_lib_bpf_apply_recommendation(ml_model, hint, &err))
+		return err;
+
+	if (!ml_model->model_ops || !ml_model->model_ops->apply_recommendation)
+		return -EOPNOTSUPP;
+
+	return ml_model->model_ops->apply_recommendation(ml_model, hint);
 }
 EXPORT_SYMBOL(apply_ml_model_recommendation);
 
@@ -586,7 +1477,28 @@ int execute_ml_model_operation(struct ml_lib_model *ml_model,
 			 struct ml_lib_user_space_recommendation *hint,
 			 struct ml_lib_user_space_request *request)
 {
-	return -EOPNOTSUPP;
+	u64 start_ns = 0;
+	int err;
+
+	if (!ml_model || !hint || !request)
+		return -EINVAL;
+
+	/* the governor needs the latency of decisions */
+	if (ml_lib_governor_active(ml_model))
+		start_ns = ktime_get_ns();
+
+	if (!ml_model->model_ops || !ml_model->model_ops->execute_operation)
+		err = generic_execute_operation(ml_model, hint, request);
+	else
+		err = ml_model->model_ops->execute_operation(ml_model, hint,
+							     request);
+
+	if (start_ns && !err) {
+		atomic64_inc(&ml_model->decisions);
+		atomic64_add(ktime_get_ns() - start_ns, &ml_model->decision_ns);
+	}
+
+	return err;
 }
 EXPORT_SYMBOL(execute_ml_model_operation);
 
@@ -594,7 +1506,19 @@ int estimate_ml_model_efficiency(struct ml_lib_model *ml_model,
 			 struct ml_lib_user_space_recommendation *hint,
 			 struct ml_lib_user_space_request *request)
 {
-	return -EOPNOTSUPP;
+	int err;
+
+	if (!ml_model || !hint || !request)
+		return -EINVAL;
+
+	if (ml_lib_bpf_estimate_efficiency(ml_model, hint, request, &err))
+		return err;
+
+	if (!ml_model->model_ops || !ml_model->model_ops->estimate_efficiency)
+		return generic_estimate_efficiency(ml_model, hint, request);
+
+	return ml_model->model_ops->estimate_efficiency(ml_model, hint,
+							request);
 }
 EXPORT_SYMBOL(estimate_ml_model_efficiency);
 
@@ -602,7 +1526,15 @@ int ml_model_error_backpropagation(struct ml_lib_model *ml_model,
 			    struct ml_lib_backpropagation_feedback *feedback,
 			    struct ml_lib_user_space_notification *notify)
 {
-	return -EOPNOTSUPP;
+	if (!ml_model || !feedback)
+		return -EINVAL;
+
+	if (!ml_model->model_ops ||
+	    !ml_model->model_ops->error_backpropagation)
+		return -EOPNOTSUPP;
+
+	return ml_model->model_ops->error_backpropagation(ml_model, feedback,
+							  notify);
 }
 EXPORT_SYMBOL(ml_model_error_backpropagation);
 
@@ -635,6 +1567,9 @@ int generic_init_ml_model(struct ml_lib_model *ml_model,
 			  struct ml_lib_model_options *options)
 {
 	options->sleep_timeout = ML_LIB_SLEEP_TIMEOUT_DEFAULT;
+	if (!options->dataset_queue_depth)
+		options->dataset_queue_depth =
+				ML_LIB_DATASET_QUEUE_DEPTH_DEFAULT;
 	return 0;
 }
 EXPORT_SYMBOL(generic_init_ml_model);
@@ -650,13 +1585,16 @@ EXPORT_SYMBOL(generic_re_init_ml_model);
 int generic_start_ml_model(struct ml_lib_model *ml_model,
 			   struct ml_lib_model_run_config *config)
 {
-	return -EOPNOTSUPP;
+	if (!config || !config->sleep_timeout)
+		return 0;
+
+	return ml_model_correct_sleep_timeout(ml_model, config->sleep_timeout);
 }
 EXPORT_SYMBOL(generic_start_ml_model);
 
 int generic_stop_ml_model(struct ml_lib_model *ml_model)
 {
-	return -EOPNOTSUPP;
+	return 0;
 }
 EXPORT_SYMBOL(generic_stop_ml_model);
 
@@ -690,10 +1628,77 @@ EXPORT_SYMBOL(generic_get_dataset);
 int generic_preprocess_data(struct ml_lib_model *ml_model,
 			    struct ml_lib_dataset *dataset)
 {
-	return -EOPNOTSUPP;
+	struct ml_lib_preprocess_config *config;
+	int err;
+
+	if (!dataset->payload || dataset->portion_size == 0)
+		return 0;
+
+	/* the payload is processed without RCU read lock */
+	config = ml_lib_preprocess_config_get(ml_model);
+	if (!config)
+		return 0;
+
+	err = ml_lib_preprocess_aggregate(config, dataset->payload,
+					  dataset->portion_size);
+	if (err)
+		goto finish_preprocess;
+
+	dataset->portion_size =
+		ml_lib_preprocess_records(config, dataset->payload,
+					  dataset->portion_size);
+	dataset->preprocessed = true;
+
+finish_preprocess:
+	ml_lib_preprocess_config_put(config);
+
+	return err;
 }
 EXPORT_SYMBOL(generic_preprocess_data);
 
+int generic_compress_data(struct ml_lib_model *ml_model,
+			  struct ml_lib_dataset *dataset)
+{
+	u32 raw_size = dataset->portion_size;
+	u32 compressed_size;
+	int err = 0;
+
+	dataset->compression = ML_LIB_NO_COMPRESSION;
+	dataset->raw_size = raw_size;
+
+	if (!dataset->payload || raw_size == 0)
+		return 0;
+
+	mutex_lock(&ml_model->compress_lock);
+
+	if (!ml_model->compressor)
+		goto finish_compress_data;
+
+	err = ml_lib_compressor_compress(ml_model->compressor,
+					 dataset->payload, raw_size,
+					 &compressed_size);
+	if (!err) {
+		dataset->compression =
+			ml_lib_compressor_algorithm(ml_model->compressor);
+		dataset->portion_size = compressed_size;
+	} else if (err == -E2BIG) {
+		/* publish incompressible portion as is */
+		err = 0;
+	}
+
+	if (!err) {
+		atomic64_add(raw_size, &ml_model->uncompressed_bytes);
+		atomic64_add(dataset->portion_size,
+			     &ml_model->compressed_bytes);
+	}
+
+finish_compress_data:
+	mutex_unlock(&ml_model->compress_lock);
+
+	return err;
+}
+EXPORT_SYMBOL(generic_compress_data);
+
 int generic_publish_data(struct ml_lib_model *ml_model,
 			 struct ml_lib_dataset *dataset,
 			 struct ml_lib_user_space_notification *notify)
@@ -702,10 +1707,11 @@ int generic_publish_data(struct ml_lib_model *ml_model,
 }
 EXPORT_SYMBOL(generic_publish_data);
 
+/* the recommendation is applied as is */
 int generic_preprocess_recommendation(struct ml_lib_model *ml_model,
 			 struct ml_lib_user_space_recommendation *hint)
 {
-	return -EOPNOTSUPP;
+	return 0;
 }
 EXPORT_SYMBOL(generic_preprocess_recommendation);
 
@@ -722,11 +1728,42 @@ int generic_apply_recommendation(struct ml_lib_model *ml_model,
 }
 EXPORT_SYMBOL(generic_apply_recommendation);
 
+/*
+ * In RECOMMENDATION_MODE, the decision is evaluated by in-kernel
+ * tree ensemble (or by quantized MLP, if no tree ensemble has been
+ * loaded) and it is applied inline without any round trip
+ * to user-space. Otherwise, the subsystem should use its default
+ * algorithm or the recommendations of user-space ML model.
+ */
 int generic_execute_operation(struct ml_lib_model *ml_model,
 			 struct ml_lib_user_space_recommendation *hint,
 			 struct ml_lib_user_space_request *request)
 {
-	return -EOPNOTSUPP;
+	int err;
+
+	if (atomic_read(&ml_model->mode) != ML_LIB_RECOMMENDATION_MODE)
+		return -EOPNOTSUPP;
+
+	err = ml_model_evaluate_tree_ensemble(ml_model, request->features,
+					      request->nr_features,
+					      &hint->value);
+	if (err == -ENODATA && ml_lib_mlp_loaded(ml_model)) {
+		err = ml_lib_mlp_evaluate(ml_model, request->features,
+					  request->nr_features,
+					  &hint->value);
+	}
+	if (err)
+		return err;
+
+	hint->request_id = request->id;
+
+	if (ml_lib_bpf_apply_recommendation(ml_model, hint, &err))
+		return err;
+
+	if (!ml_model->model_ops || !ml_model->model_ops->apply_recommendation)
+		return 0;
+
+	return ml_model->model_ops->apply_recommendation(ml_model, hint);
 }
 EXPORT_SYMBOL(generic_execute_operation);
 
@@ -752,6 +1789,87 @@ int generic_correct_system_state(struct ml_lib_model *ml_model)
 }
 EXPORT_SYMBOL(generic_correct_system_state);
 
+int generic_default_operation(struct ml_lib_model *ml_model,
+			 struct ml_lib_user_space_recommendation *hint,
+			 struct ml_lib_user_space_request *request)
+{
+	return -EOPNOTSUPP;
+}
+EXPORT_SYMBOL(generic_default_operation);
+
+static int __init ml_lib_init(void)
+{
+	int err;
+
+	ml_lib_aggregate_init();
+
+	ml_lib_subsystem_cachep = KMEM_CACHE(ml_lib_subsystem, 0);
+	if (!ml_lib_subsystem_cachep)
+		goto fail_create_caches;
+
+	ml_lib_options_cachep = KMEM_CACHE(ml_lib_model_options, 0);
+	if (!ml_lib_options_cachep)
+		goto fail_create_caches;
+
+	ml_lib_state_cachep = KMEM_CACHE(ml_lib_subsystem_state, 0);
+	if (!ml_lib_state_cachep)
+		goto fail_create_caches;
+
+	ml_lib_dataset_cachep = KMEM_CACHE(ml_lib_dataset,
+					   SLAB_HWCACHE_ALIGN);
+	if (!ml_lib_dataset_cachep)
+		goto fail_create_caches;
+
+	ml_lib_request_config_cachep = KMEM_CACHE(ml_lib_request_config, 0);
+	if (!ml_lib_request_config_cachep)
+		goto fail_create_caches;
+
+	err = ml_lib_worker_pool_init();
+	if (err) {
+		pr_err("ml_lib: failed to create worker pool: err %d\n", err);
+		goto destroy_caches;
+	}
+
+	err = ml_lib_bpf_init();
+	if (err) {
+		/* ML models are still usable without BPF policies */
+		pr_warn("ml_lib: failed to register BPF struct_ops: err %d\n",
+			err);
+	}
+
+	return 0;
+
+fail_create_caches:
+	pr_err("ml_lib: failed to create slab caches\n");
+	err = -ENOMEM;
+
+destroy_caches:
+	kmem_cache_destroy(ml_lib_request_config_cachep);
+	kmem_cache_destroy(ml_lib_dataset_cachep);
+	kmem_cache_destroy(ml_lib_state_cachep);
+	kmem_cache_destroy(ml_lib_options_cachep);
+	kmem_cache_destroy(ml_lib_subsystem_cachep);
+	return err;
+}
+
+static void __exit ml_lib_exit(void)
+{
+	ml_lib_worker_pool_destroy();
+
+	/* wait for pending call_rcu() callbacks */
+	rcu_barrier();
+
+	kmem_cache_destroy(ml_lib_request_config_cachep);
+	kmem_cache_destroy(ml_lib_dataset_cachep);
+	kmem_cache_destroy(ml_lib_state_cachep);
+	kmem_cache_destroy(ml_lib_options_cachep);
+	kmem_cache_destroy(ml_lib_subsystem_cachep);
+}
+
+/* the caches should exist before built-in subsystems create ML models */
+subsys_initcall(ml_lib_init);
+module_exit(ml_lib_exit);
+
 MODULE_LICENSE("GPL");
 MODULE_AUTHOR("Viacheslav Dubeyko <slava@dubeyko.com>");
 MODULE_DESCRIPTION("ML library");
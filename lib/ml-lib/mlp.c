@@ -0,0 +1,495 @@
+// SPDX-License-Identifier: GPL-2.0-only
+/*
+ * Machine Learning (ML) library
+ *
+ * Copyright (C) 2025-2026 Viacheslav Dubeyko <slava@dubeyko.com>
+ */
+
+#include <linux/module.h>
+#include <linux/kernel.h>
+#include <linux/slab.h>
+#include <linux/percpu.h>
+#include <linux/local_lock.h>
+#include <linux/bottom_half.h>
+#include <linux/overflow.h>
+#include <linux/rcupdate.h>
+
+#include <linux/ml-lib/ml_lib.h>
+
+#include "aggregate.h"
+#include "mlp.h"
+#include "model_blob.h"
+
+/*
+ * The quantized multi-layer perceptron (MLP) is trained in user-space
+ * and its image is loaded into ML model. Every layer multiplies
+ * the int8 input vector by int8 weights with int32 accumulation,
+ * adds int32 bias and applies the activation. The accumulators of
+ * hidden layer are requantized into int8 by arithmetic shift with
+ * saturation. The accumulators of the last layer are the output.
+ *
+ * The inference doesn't allocate memory: the activations are kept
+ * in per-CPU scratch buffer that is allocated at load time.
+ * The scratch buffer is owned under ml_lib_mlp_lock with disabled
+ * bottom halves, so the inference in softirq cannot reuse the buffer
+ * of interrupted inference on the same CPU. The inference cannot be
+ * executed in hardirq context or with disabled interrupts.
+ */
+
+static DEFINE_PER_CPU(local_lock_t, ml_lib_mlp_lock) =
+	INIT_LOCAL_LOCK(ml_lib_mlp_lock);
+
+/*
+ * struct ml_lib_mlp_layer - loaded layer of MLP
+ * @desc: layer descriptor
+ * @bias: per-output bias
+ * @weights: row-major weights (out_size rows by in_size columns)
+ */
+struct ml_lib_mlp_layer {
+	struct ml_lib_mlp_layer_desc desc;
+	s32 *bias;
+	s8 *weights;
+};
+
+/*
+ * struct ml_lib_mlp - loaded MLP
+ * @nr_layers: number of layers
+ * @input_shift: quantization shift of 64-bit features
+ * @max_width: maximal width of layers
+ * @scratch: per-CPU activations (s32 acc[max_width] + s8 x[max_width])
+ * @rcu: deferred freeing of replaced MLP
+ * @layers: layers of MLP
+ */
+struct ml_lib_mlp {
+	u32 nr_layers;
+	u32 input_shift;
+	u32 max_width;
+	void __percpu *scratch;
+
+	struct rcu_head rcu;
+
+	struct ml_lib_mlp_layer layers[];
+};
+
+static void ml_lib_mlp_free(struct ml_lib_mlp *mlp)
+{
+	free_percpu(mlp->scratch);
+	kvfree(mlp);
+}
+
+static void ml_lib_mlp_free_rcu(struct rcu_head *head)
+{
+	ml_lib_mlp_free(container_of(head, struct ml_lib_mlp, rcu));
+}
+
+static int ml_lib_mlp_validate(const struct ml_lib_mlp_header *hdr,
+			       size_t size, size_t *params_size)
+{
+	const struct ml_lib_mlp_layer_desc *desc;
+	size_t expected;
+	u32 i;
+
+	if (size < sizeof(*hdr))
+		return -EINVAL;
+
+	if (hdr->magic != ML_LIB_MLP_MAGIC ||
+	    hdr->version != ML_LIB_MLP_VERSION)
+		return -EINVAL;
+
+	if (!hdr->nr_layers || hdr->nr_layers > ML_LIB_MLP_LAYERS_MAX ||
+	    hdr->input_shift >= BITS_PER_LONG_LONG)
+		return -EINVAL;
+
+	expected = size_add(sizeof(*hdr),
+			    array_size(hdr->nr_layers, sizeof(*desc)));
+	if (size < expected)
+		return -EINVAL;
+
+	desc = (const struct ml_lib_mlp_layer_desc *)(hdr + 1);
+	*params_size = 0;
+
+	for (i = 0; i < hdr->nr_layers; i++, desc++) {
+		if (!desc->in_size || desc->in_size > ML_LIB_MLP_WIDTH_MAX ||
+		    !desc->out_size || desc->out_size > ML_LIB_MLP_WIDTH_MAX)
+			return -ERANGE;
+
+		if (i > 0 && desc->in_size != desc[-1].out_size)
+			return -EINVAL;
+
+		if (desc->activation >= ML_LIB_MLP_ACTIVATION_MAX ||
+		    desc->shift >= BITS_PER_TYPE(s32))
+			return -EINVAL;
+
+		/* s32 bias[out_size] + s8 weights[out_size][in_size] */
+		*params_size += desc->out_size * sizeof(s32) +
+				desc->out_size * desc->in_size;
+	}
+
+	if (size != expected + *params_size)
+		return -EINVAL;
+
+	return 0;
+}
+
+static struct ml_lib_mlp *ml_lib_mlp_create(const void *image, size_t size)
+{
+	const struct ml_lib_mlp_header *hdr = image;
+	const struct ml_lib_mlp_layer_desc *desc;
+	struct ml_lib_mlp *mlp;
+	const u8 *params;
+	size_t params_size;
+	u8 *storage;
+	u32 i;
+	int err;
+
+	err = ml_lib_mlp_validate(hdr, size, &params_size);
+	if (err)
+		return ERR_PTR(err);
+
+	/* parameters are copied after the layers with aligned biases */
+	params_size += hdr->nr_layers * sizeof(s32);
+	mlp = kvzalloc(size_add(struct_size(mlp, layers, hdr->nr_layers),
+				params_size), GFP_KERNEL);
+	if (unlikely(!mlp))
+		return ERR_PTR(-ENOMEM);
+
+	mlp->nr_layers = hdr->nr_layers;
+	mlp->input_shift = hdr->input_shift;
+
+	desc = (const struct ml_lib_mlp_layer_desc *)(hdr + 1);
+	params = (const u8 *)(desc + hdr->nr_layers);
+	storage = (u8 *)&mlp->layers[hdr->nr_layers];
+
+	for (i = 0; i < hdr->nr_layers; i++, desc++) {
+		struct ml_lib_mlp_layer *layer = &mlp->layers[i];
+		size_t bias_size = desc->out_size * sizeof(s32);
+		size_t weights_size = desc->out_size * desc->in_size;
+
+		layer->desc = *desc;
+
+		layer->bias = (s32 *)storage;
+		memcpy(layer->bias, params, bias_size);
+		params += bias_size;
+		storage += bias_size;
+
+		layer->weights = (s8 *)storage;
+		memcpy(layer->weights, params, weights_size);
+		params += weights_size;
+		storage += ALIGN(weights_size, sizeof(s32));
+
+		mlp->max_width = max3(mlp->max_width,
+				      desc->in_size, desc->out_size);
+	}
+
+	mlp->scratch = __alloc_percpu(mlp->max_width * (sizeof(s32) + 1),
+				      SMP_CACHE_BYTES);
+	if (unlikely(!mlp->scratch)) {
+		kvfree(mlp);
+		return ERR_PTR(-ENOMEM);
+	}
+
+	return mlp;
+}
+
+static void ml_lib_mlp_replace(struct ml_lib_model *ml_model,
+			       struct ml_lib_mlp *mlp)
+{
+	struct ml_lib_mlp *old_mlp;
+
+	/* MLP is replaced like ML model's options */
+	spin_lock(&ml_model->options_lock);
+	old_mlp = rcu_dereference_protected(ml_model->mlp,
+				lockdep_is_held(&ml_model->options_lock));
+	rcu_assign_pointer(ml_model->mlp, mlp);
+	spin_unlock(&ml_model->options_lock);
+
+	if (old_mlp)
+		call_rcu(&old_mlp->rcu, ml_lib_mlp_free_rcu);
+
+	/* the cached recommendations belong to the replaced model */
+	ml_model_invalidate_recommendations(ml_model);
+}
+
+int ml_lib_mlp_load(struct ml_lib_model *ml_model,
+		    const void *image, size_t size)
+{
+	struct ml_lib_mlp *mlp;
+
+	mlp = ml_lib_mlp_create(image, size);
+	if (IS_ERR(mlp)) {
+		pr_err("ml_lib: failed to load MLP: err %ld\n",
+			PTR_ERR(mlp));
+		return PTR_ERR(mlp);
+	}
+
+	ml_lib_mlp_replace(ml_model, mlp);
+
+	return 0;
+}
+
+/*
+ * ml_model_load_mlp() - load quantized MLP into ML model
+ * @ml_model: ML model object
+ * @image: MLP image (see struct ml_lib_mlp_header)
+ * @size: size of image in bytes
+ *
+ * The image is validated and copied, so the caller keeps
+ * the ownership of @image. The previously loaded MLP
+ * (or tree ensemble) is freed after RCU grace period.
+ * The MLP receives the next model version.
+ */
+int ml_model_load_mlp(struct ml_lib_model *ml_model,
+		      const void *image, size_t size)
+{
+	if (!ml_model || !image)
+		return -EINVAL;
+
+	return ml_lib_model_install(ml_model, ML_LIB_MODEL_BLOB_MLP,
+				    image, size, 0);
+}
+EXPORT_SYMBOL(ml_model_load_mlp);
+
+void ml_model_unload_mlp(struct ml_lib_model *ml_model)
+{
+	if (!ml_model)
+		return;
+
+	ml_lib_mlp_replace(ml_model, NULL);
+}
+EXPORT_SYMBOL(ml_model_unload_mlp);
+
+static inline s32 ml_lib_mlp_activate(u32 activation, s32 value)
+{
+	if (activation == ML_LIB_MLP_ACTIVATION_RELU && value < 0)
+		return 0;
+
+	return value;
+}
+
+/*
+ * Execute the layers over the quantized input in @x.
+ * The activations of the last layer are stored into @output.
+ */
+static void ml_lib_mlp_run(const struct ml_lib_mlp *mlp, s32 *acc, s8 *x,
+			   s32 *output)
+{
+	const struct ml_lib_mlp_layer *layer = mlp->layers;
+	u32 i, j;
+
+	for (i = 0; i < mlp->nr_layers; i++, layer++) {
+		const struct ml_lib_mlp_layer_desc *desc = &layer->desc;
+		bool last = i + 1 == mlp->nr_layers;
+
+		ml_lib_gemv_s8(layer->weights, layer->bias, x,
+			       desc->in_size, desc->out_size,
+			       last ? output : acc);
+
+		if (last)
+			break;
+
+		/* requantize into the input of the next layer */
+		for (j = 0; j < desc->out_size; j++) {
+			s32 value = ml_lib_mlp_activate(desc->activation,
+							acc[j]);
+
+			x[j] = clamp_t(s32, value >> desc->shift,
+				       S8_MIN, S8_MAX);
+		}
+	}
+
+	layer = &mlp->layers[mlp->nr_layers - 1];
+	for (j = 0; j < layer->desc.out_size; j++)
+		output[j] = ml_lib_mlp_activate(layer->desc.activation,
+						output[j]);
+}
+
+/*
+ * If @output is NULL, then the output is kept in the scratch buffer
+ * and only the first output is returned by @value.
+ */
+static int __ml_lib_mlp_infer(const struct ml_lib_mlp *mlp,
+			      const void *input, u32 input_size, bool features,
+			      s32 *output, u32 output_size, s64 *value)
+{
+	void *scratch;
+	s32 *acc;
+	s8 *x;
+	u32 i;
+
+	if (WARN_ON_ONCE(in_hardirq() || irqs_disabled()))
+		return -EPERM;
+
+	if (input_size < mlp->layers[0].desc.in_size ||
+	    (output &&
+	     output_size < mlp->layers[mlp->nr_layers - 1].desc.out_size))
+		return -EINVAL;
+
+	local_bh_disable();
+	local_lock_nested_bh(&ml_lib_mlp_lock);
+	scratch = this_cpu_ptr(mlp->scratch);
+	acc = scratch;
+	x = (s8 *)(acc + mlp->max_width);
+
+	if (features) {
+		const s64 *values = input;
+
+		for (i = 0; i < mlp->layers[0].desc.in_size; i++) {
+			x[i] = clamp_t(s64, values[i] >> mlp->input_shift,
+				       S8_MIN, S8_MAX);
+		}
+	} else
+		memcpy(x, input, mlp->layers[0].desc.in_size);
+
+	if (output)
+		ml_lib_mlp_run(mlp, acc, x, output);
+	else {
+		ml_lib_mlp_run(mlp, acc, x, acc);
+		*value = acc[0];
+	}
+	local_unlock_nested_bh(&ml_lib_mlp_lock);
+	local_bh_enable();
+
+	return 0;
+}
+
+static int ml_lib_mlp_infer(struct ml_lib_model *ml_model,
+			    const void *input, u32 input_size, bool features,
+			    s32 *output, u32 output_size, s64 *value)
+{
+	struct ml_lib_mlp *mlp;
+	int err;
+
+	rcu_read_lock();
+	mlp = rcu_dereference(ml_model->mlp);
+	if (mlp)
+		err = __ml_lib_mlp_infer(mlp, input, input_size, features,
+					 output, output_size, value);
+	else
+		err = -ENODATA;
+	rcu_read_unlock();
+
+	return err;
+}
+
+/*
+ * ml_model_mlp_infer() - execute inference of loaded MLP
+ * @ml_model: ML model object
+ * @input: quantized input vector
+ * @input_size: number of elements in @input
+ * @output: output vector [out]
+ * @output_size: number of elements in @output
+ *
+ * The method can be used by apply_recommendation or
+ * estimate_system_state operations of kernel subsystem.
+ * It can be called in process or softirq context.
+ * Returns -ENODATA if no MLP has been loaded.
+ */
+int ml_model_mlp_infer(struct ml_lib_model *ml_model,
+		       const s8 *input, u32 input_size,
+		       s32 *output, u32 output_size)
+{
+	if (!ml_model || !input || !output)
+		return -EINVAL;
+
+	return ml_lib_mlp_infer(ml_model, input, input_size, false,
+				output, output_size, NULL);
+}
+EXPORT_SYMBOL(ml_model_mlp_infer);
+
+/*
+ * allocate_mlp() - create MLP that is not loaded into any ML model
+ * @image: MLP image (see struct ml_lib_mlp_header)
+ * @size: size of image in bytes
+ *
+ * The private MLP can be used for benchmarking or evaluation of
+ * the candidate model without any influence on the loaded model
+ * and model_version of ML model.
+ *
+ * Return: MLP object or ERR_PTR() on failure.
+ */
+struct ml_lib_mlp *allocate_mlp(const void *image, size_t size)
+{
+	if (!image)
+		return ERR_PTR(-EINVAL);
+
+	return ml_lib_mlp_create(image, size);
+}
+EXPORT_SYMBOL(allocate_mlp);
+
+void free_mlp(struct ml_lib_mlp *mlp)
+{
+	if (IS_ERR_OR_NULL(mlp))
+		return;
+
+	ml_lib_mlp_free(mlp);
+}
+EXPORT_SYMBOL(free_mlp);
+
+/*
+ * ml_lib_mlp_run_inference() - execute inference of private MLP
+ * @mlp: MLP object of allocate_mlp()
+ * @input: quantized input vector
+ * @input_size: number of elements in @input
+ * @output: output vector [out]
+ * @output_size: number of elements in @output
+ *
+ * The caller owns @mlp, so it cannot be freed during the inference.
+ * It can be called in process or softirq context.
+ */
+int ml_lib_mlp_run_inference(const struct ml_lib_mlp *mlp,
+			     const s8 *input, u32 input_size,
+			     s32 *output, u32 output_size)
+{
+	if (!mlp || !input || !output)
+		return -EINVAL;
+
+	return __ml_lib_mlp_infer(mlp, input, input_size, false,
+				  output, output_size, NULL);
+}
+EXPORT_SYMBOL(ml_lib_mlp_run_inference);
+
+/*
+ * ml_lib_mlp_evaluate() - evaluate decision by loaded MLP
+ * @ml_model: ML model object
+ * @features: 64-bit features (quantized by input_shift)
+ * @nr_features: number of features
+ * @value: the first output of MLP [out]
+ */
+int ml_lib_mlp_evaluate(struct ml_lib_model *ml_model,
+			const s64 *features, u32 nr_features, s64 *value)
+{
+	return ml_lib_mlp_infer(ml_model, features, nr_features, true,
+				NULL, 0, value);
+}
+
+bool ml_lib_mlp_loaded(struct ml_lib_model *ml_model)
+{
+	return rcu_access_pointer(ml_model->mlp) != NULL;
+}
+
+ssize_t ml_lib_mlp_info(struct ml_lib_model *ml_model, char *buf)
+{
+	struct ml_lib_mlp *mlp;
+	ssize_t count;
+	u32 i;
+
+	rcu_read_lock();
+	mlp = rcu_dereference(ml_model->mlp);
+	if (!mlp) {
+		count = sysfs_emit(buf, "none\n");
+		goto finish_info;
+	}
+
+	count = sysfs_emit(buf, "layers %u", mlp->nr_layers);
+	for (i = 0; i < mlp->nr_layers; i++) {
+		count += sysfs_emit_at(buf, count, " %ux%u",
+				       mlp->layers[i].desc.in_size,
+				       mlp->layers[i].desc.out_size);
+	}
+	count += sysfs_emit_at(buf, count, "\n");
+
+finish_info:
+	rcu_read_unlock();
+
+	return count;
+}
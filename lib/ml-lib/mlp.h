@@ -0,0 +1,18 @@
+// SPDX-License-Identifier: GPL-2.0-only
+/*
+ * Machine Learning (ML) library
+ *
+ * Copyright (C) 2025-2026 Viacheslav Dubeyko <slava@dubeyko.com>
+ */
+
+#ifndef _LINUX_ML_LIB_MLP_H
+#define _LINUX_ML_LIB_MLP_H
+
+int ml_lib_mlp_evaluate(struct ml_lib_model *ml_model,
+			const s64 *features, u32 nr_features, s64 *value);
+int ml_lib_mlp_load(struct ml_lib_model *ml_model,
+		    const void *image, size_t size);
+bool ml_lib_mlp_loaded(struct ml_lib_model *ml_model);
+ssize_t ml_lib_mlp_info(struct ml_lib_model *ml_model, char *buf);
+
+#endif /* _LINUX_ML_LIB_MLP_H */
@@ -0,0 +1,267 @@
+// SPDX-License-Identifier: GPL-2.0-only
+/*
+ * Machine Learning (ML) library
+ *
+ * Copyright (C) 2025-2026 Viacheslav Dubeyko <slava@dubeyko.com>
+ */
+
+#include <linux/module.h>
+#include <linux/kernel.h>
+#include <linux/slab.h>
+#include <linux/mutex.h>
+#include <linux/crc32.h>
+#include <linux/overflow.h>
+
+#include <linux/ml-lib/ml_lib.h>
+
+#include "model_blob.h"
+#include "tree_ensemble.h"
+#include "mlp.h"
+
+/*
+ * The model blob is a versioned container of in-kernel model image
+ * (tree ensemble or quantized MLP). The blob is validated and parsed
+ * once into immutable in-kernel representation that is published
+ * by RCU. So, the inference readers never block and never see
+ * partially uploaded model.
+ *
+ * The blob can be uploaded by several writes into "model" binary
+ * attribute of ML model's kobject. The write at zero offset starts
+ * the new upload, and the blob is loaded when the last byte
+ * has been written. The blob is rejected if its model version is
+ * not bigger than the version of currently loaded model.
+ *
+ * ML model has one in-kernel model at a time: the loading of model
+ * unloads the model of the other type, so execute_operation() never
+ * evaluates the model that model_version doesn't describe.
+ */
+
+static int __ml_lib_model_install(struct ml_lib_model *ml_model, u32 type,
+				  const void *image, size_t size, u64 version)
+{
+	int err;
+
+	lockdep_assert_held(&ml_model->upload_lock);
+
+	/* the image without version is the next version of model */
+	if (!version)
+		version = ml_model->model_version + 1;
+	else if (version <= ml_model->model_version)
+		return -ESTALE;
+
+	switch (type) {
+	case ML_LIB_MODEL_BLOB_TREE_ENSEMBLE:
+		err = ml_lib_tree_ensemble_load(ml_model, image, size);
+		if (!err)
+			ml_model_unload_mlp(ml_model);
+		break;
+
+	case ML_LIB_MODEL_BLOB_MLP:
+		err = ml_lib_mlp_load(ml_model, image, size);
+		if (!err)
+			ml_model_unload_tree_ensemble(ml_model);
+		break;
+
+	default:
+		err = -EOPNOTSUPP;
+		break;
+	}
+
+	if (err)
+		return err;
+
+	WRITE_ONCE(ml_model->model_version, version);
+
+	return 0;
+}
+
+/*
+ * ml_lib_model_install() - load in-kernel model of the given type
+ * @ml_model: ML model object
+ * @type: type of model (ML_LIB_MODEL_BLOB_*)
+ * @image: model image
+ * @size: size of image in bytes
+ * @version: model version (0 - the next version)
+ *
+ * The loadings of one ML model are serialized by upload_lock,
+ * so the version check and the update cannot interleave.
+ */
+int ml_lib_model_install(struct ml_lib_model *ml_model, u32 type,
+			 const void *image, size_t size, u64 version)
+{
+	int err;
+
+	mutex_lock(&ml_model->upload_lock);
+	err = __ml_lib_model_install(ml_model, type, image, size, version);
+	mutex_unlock(&ml_model->upload_lock);
+
+	return err;
+}
+
+static int
+ml_lib_model_blob_check_header(const struct ml_lib_model_blob_header *hdr)
+{
+	if (hdr->magic != ML_LIB_MODEL_BLOB_MAGIC ||
+	    hdr->format != ML_LIB_MODEL_BLOB_FORMAT ||
+	    hdr->reserved)
+		return -EINVAL;
+
+	if (hdr->type <= ML_LIB_MODEL_BLOB_UNKNOWN ||
+	    hdr->type >= ML_LIB_MODEL_BLOB_TYPE_MAX)
+		return -EINVAL;
+
+	if (!hdr->payload_size ||
+	    hdr->payload_size > ML_LIB_MODEL_BLOB_SIZE_MAX - sizeof(*hdr))
+		return -E2BIG;
+
+	return 0;
+}
+
+static int ml_lib_model_blob_load(struct ml_lib_model *ml_model,
+				  const void *blob, size_t size)
+{
+	const struct ml_lib_model_blob_header *hdr = blob;
+	const void *payload;
+	int err;
+
+	lockdep_assert_held(&ml_model->upload_lock);
+
+	if (size < sizeof(*hdr))
+		return -EINVAL;
+
+	err = ml_lib_model_blob_check_header(hdr);
+	if (err)
+		return err;
+
+	if (size != sizeof(*hdr) + hdr->payload_size)
+		return -EINVAL;
+
+	payload = hdr + 1;
+
+	if (crc32_le(~0, payload, hdr->payload_size) != hdr->checksum)
+		return -EBADMSG;
+
+	/* zero version is reserved for the images without version */
+	if (!hdr->version)
+		return -ESTALE;
+
+	return __ml_lib_model_install(ml_model, hdr->type, payload,
+				      hdr->payload_size, hdr->version);
+}
+
+/*
+ * ml_model_load_blob() - load versioned model blob into ML model
+ * @ml_model: ML model object
+ * @blob: model blob (see struct ml_lib_model_blob_header)
+ * @size: size of blob in bytes
+ *
+ * The method can be used by ioctl() of kernel subsystem.
+ * The caller keeps the ownership of @blob.
+ */
+int ml_model_load_blob(struct ml_lib_model *ml_model,
+		       const void *blob, size_t size)
+{
+	int err;
+
+	if (!ml_model || !blob)
+		return -EINVAL;
+
+	mutex_lock(&ml_model->upload_lock);
+	err = ml_lib_model_blob_load(ml_model, blob, size);
+	mutex_unlock(&ml_model->upload_lock);
+
+	if (err)
+		pr_err("ml_lib: failed to load model blob: err %d\n", err);
+
+	return err;
+}
+EXPORT_SYMBOL(ml_model_load_blob);
+
+static void ml_lib_model_upload_reset(struct ml_lib_model *ml_model)
+{
+	kvfree(ml_model->upload_buf);
+	ml_model->upload_buf = NULL;
+	ml_model->upload_size = 0;
+	ml_model->upload_received = 0;
+}
+
+/*
+ * ml_lib_model_blob_write() - accept the next chunk of uploaded blob
+ * @ml_model: ML model object
+ * @buf: chunk of blob
+ * @off: offset of chunk in the blob
+ * @count: size of chunk
+ */
+ssize_t ml_lib_model_blob_write(struct ml_lib_model *ml_model,
+				const char *buf, loff_t off, size_t count)
+{
+	const struct ml_lib_model_blob_header *hdr;
+	ssize_t ret = count;
+	int err;
+
+	mutex_lock(&ml_model->upload_lock);
+
+	if (off == 0) {
+		/* new upload discards the incomplete one */
+		ml_lib_model_upload_reset(ml_model);
+
+		if (count < sizeof(*hdr)) {
+			ret = -EINVAL;
+			goto finish_write;
+		}
+
+		hdr = (const struct ml_lib_model_blob_header *)buf;
+		err = ml_lib_model_blob_check_header(hdr);
+		if (err) {
+			ret = err;
+			goto finish_write;
+		}
+
+		ml_model->upload_size = sizeof(*hdr) + hdr->payload_size;
+		ml_model->upload_buf = kvmalloc(ml_model->upload_size,
+						GFP_KERNEL);
+		if (!ml_model->upload_buf) {
+			ml_model->upload_size = 0;
+			ret = -ENOMEM;
+			goto finish_write;
+		}
+	} else if (!ml_model->upload_buf ||
+		   off != ml_model->upload_received) {
+		/* chunks should be written sequentially */
+		ret = -EINVAL;
+		goto finish_write;
+	}
+
+	if (count > ml_model->upload_size - ml_model->upload_received) {
+		ml_lib_model_upload_reset(ml_model);
+		ret = -EFBIG;
+		goto finish_write;
+	}
+
+	memcpy((u8 *)ml_model->upload_buf + off, buf, count);
+	ml_model->upload_received += count;
+
+	if (ml_model->upload_received == ml_model->upload_size) {
+		err = ml_lib_model_blob_load(ml_model, ml_model->upload_buf,
+					     ml_model->upload_size);
+		ml_lib_model_upload_reset(ml_model);
+
+		if (err) {
+			pr_err("ml_lib: failed to load model blob: err %d\n",
+				err);
+			ret = err;
+		}
+	}
+
+finish_write:
+	mutex_unlock(&ml_model->upload_lock);
+
+	return ret;
+}
+
+void ml_lib_model_blob_destroy(struct ml_lib_model *ml_model)
+{
+	mutex_lock(&ml_model->upload_lock);
+	ml_lib_model_upload_reset(ml_model);
+	mutex_unlock(&ml_model->upload_lock);
+}
@@ -0,0 +1,17 @@
+// SPDX-License-Identifier: GPL-2.0-only
+/*
+ * Machine Learning (ML) library
+ *
+ * Copyright (C) 2025-2026 Viacheslav Dubeyko <slava@dubeyko.com>
+ */
+
+#ifndef _LINUX_ML_LIB_MODEL_BLOB_H
+#define _LINUX_ML_LIB_MODEL_BLOB_H
+
+ssize_t ml_lib_model_blob_write(struct ml_lib_model *ml_model,
+				const char *buf, loff_t off, size_t count);
+void ml_lib_model_blob_destroy(struct ml_lib_model *ml_model);
+int ml_lib_model_install(struct ml_lib_model *ml_model, u32 type,
+			 const void *image, size_t size, u64 version);
+
+#endif /* _LINUX_ML_LIB_MODEL_BLOB_H */
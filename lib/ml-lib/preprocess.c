@@ -0,0 +1,426 @@
+// SPDX-License-Identifier: GPL-2.0-only
+/*
+ * Machine Learning (ML) library
+ *
+ * Copyright (C) 2025-2026 Viacheslav Dubeyko <slava@dubeyko.com>
+ */
+
+#include <linux/module.h>
+#include <linux/kernel.h>
+#include <linux/slab.h>
+#include <linux/overflow.h>
+#include <linux/bitops.h>
+#include <linux/hash.h>
+#include <linux/math64.h>
+#include <linux/unaligned.h>
+
+#include <linux/ml-lib/ml_lib.h>
+
+#include "aggregate.h"
+#include "preprocess.h"
+
+/*
+ * The preprocessing stage transforms the records of raw 64-bit
+ * features into the packed records of normalized, quantized,
+ * bucketed or hashed features. Every output feature is not wider
+ * than the input one, so the output record starts not after
+ * the input one and the output feature ends not after the next
+ * input feature. As a result, the records are transformed in place
+ * in one pass if every input feature is read before its output
+ * is stored.
+ */
+
+/*
+ * The aggregates of features follow the descriptors of features
+ * in the same allocation: sum[], min[], max[] and histogram[].
+ */
+void *allocate_preprocess_config(u32 nr_features, gfp_t gfp)
+{
+	struct ml_lib_preprocess_config *config;
+	size_t config_size;
+	size_t stats_size;
+	size_t histogram_size;
+	u32 i;
+
+	if (!nr_features)
+		return ERR_PTR(-EINVAL);
+
+	config_size = struct_size(config, features, nr_features);
+	stats_size = array3_size(3, nr_features, sizeof(s64));
+	histogram_size = array3_size(ML_LIB_HISTOGRAM_BUCKETS, nr_features,
+				     sizeof(u64));
+
+	config = kzalloc(size_add(size_add(config_size, stats_size),
+				  histogram_size), gfp);
+	if (unlikely(!config))
+		return ERR_PTR(-ENOMEM);
+
+	config->nr_features = nr_features;
+	kref_init(&config->ref);
+
+	spin_lock_init(&config->aggregate_lock);
+	config->sum = (s64 *)((u8 *)config + config_size);
+	config->min = config->sum + nr_features;
+	config->max = config->min + nr_features;
+	config->histogram = (u64 *)(config->max + nr_features);
+
+	for (i = 0; i < nr_features; i++) {
+		config->min[i] = S64_MAX;
+		config->max[i] = S64_MIN;
+	}
+
+	return (void *)config;
+}
+EXPORT_SYMBOL(allocate_preprocess_config);
+
+void free_preprocess_config(struct ml_lib_preprocess_config *config)
+{
+	kfree(config);
+}
+EXPORT_SYMBOL(free_preprocess_config);
+
+static bool ml_lib_feature_width_valid(u32 width)
+{
+	return width == 1 || width == 2 || width == 4 || width == 8;
+}
+
+static int ml_lib_feature_validate(const struct ml_lib_feature_desc *desc)
+{
+	if (desc->transform >= ML_LIB_FEATURE_TRANSFORM_MAX)
+		return -EINVAL;
+
+	if (desc->transform == ML_LIB_FEATURE_DROP)
+		return 0;
+
+	if (!ml_lib_feature_width_valid(desc->width))
+		return -EINVAL;
+
+	switch (desc->transform) {
+	case ML_LIB_FEATURE_NORMALIZE:
+	case ML_LIB_FEATURE_LINEAR_BUCKET:
+		if (desc->shift >= 64)
+			return -EINVAL;
+		break;
+	}
+
+	switch (desc->transform) {
+	case ML_LIB_FEATURE_LOG2_BUCKET:
+	case ML_LIB_FEATURE_LINEAR_BUCKET:
+	case ML_LIB_FEATURE_HASH:
+		if (!desc->nr_buckets)
+			return -EINVAL;
+		/* bucket index should fit into output width */
+		if (desc->width < sizeof(u32) &&
+		    desc->nr_buckets > (1U << (BITS_PER_BYTE * desc->width)))
+			return -ERANGE;
+		break;
+	}
+
+	return 0;
+}
+
+static int ml_lib_preprocess_validate(struct ml_lib_preprocess_config *config)
+{
+	u32 out_size = 0;
+	u32 i;
+	int err;
+
+	for (i = 0; i < config->nr_features; i++) {
+		const struct ml_lib_feature_desc *desc = &config->features[i];
+
+		err = ml_lib_feature_validate(desc);
+		if (err) {
+			pr_err("ml_lib: invalid feature descriptor: "
+				"index %u, transform %u, width %u, err %d\n",
+				i, desc->transform, desc->width, err);
+			return err;
+		}
+
+		if (desc->transform != ML_LIB_FEATURE_DROP)
+			out_size += desc->width;
+	}
+
+	if (!out_size)
+		return -EINVAL;
+
+	config->in_record_size = config->nr_features * sizeof(u64);
+	config->out_record_size = out_size;
+
+	return 0;
+}
+
+/*
+ * ml_model_set_preprocess_config() - define preprocessing of datasets
+ * @ml_model: ML model object
+ * @config: preprocessing configuration (NULL disables preprocessing)
+ *
+ * ML model takes the ownership of @config in the case of success.
+ * The replaced configuration is freed after RCU grace period when
+ * the last preprocessing that pins it has finished.
+ */
+int ml_model_set_preprocess_config(struct ml_lib_model *ml_model,
+				   struct ml_lib_preprocess_config *config)
+{
+	struct ml_lib_preprocess_config *old_config;
+	int err;
+
+	if (!ml_model)
+		return -EINVAL;
+
+	if (config) {
+		err = ml_lib_preprocess_validate(config);
+		if (err)
+			return err;
+	}
+
+	/* configuration is replaced like ML model's options */
+	spin_lock(&ml_model->options_lock);
+	old_config = rcu_dereference_protected(ml_model->preprocess_config,
+				lockdep_is_held(&ml_model->options_lock));
+	rcu_assign_pointer(ml_model->preprocess_config, config);
+	spin_unlock(&ml_model->options_lock);
+
+	if (old_config)
+		ml_lib_preprocess_config_put(old_config);
+
+	return 0;
+}
+EXPORT_SYMBOL(ml_model_set_preprocess_config);
+
+/*
+ * ml_lib_preprocess_config_get() - pin the current configuration
+ * @ml_model: ML model object
+ *
+ * The preprocessing of multi-MB payload cannot be executed in RCU
+ * read-side critical section, so the configuration is pinned by
+ * reference that is taken under RCU read lock.
+ *
+ * Return: configuration or NULL if preprocessing is disabled.
+ */
+struct ml_lib_preprocess_config *
+ml_lib_preprocess_config_get(struct ml_lib_model *ml_model)
+{
+	struct ml_lib_preprocess_config *config;
+
+	rcu_read_lock();
+	config = rcu_dereference(ml_model->preprocess_config);
+	if (config && !kref_get_unless_zero(&config->ref))
+		config = NULL;
+	rcu_read_unlock();
+
+	return config;
+}
+
+static void ml_lib_preprocess_config_release(struct kref *ref)
+{
+	struct ml_lib_preprocess_config *config =
+		container_of(ref, struct ml_lib_preprocess_config, ref);
+
+	/* RCU readers can still access the replaced configuration */
+	kfree_rcu(config, rcu);
+}
+
+void ml_lib_preprocess_config_put(struct ml_lib_preprocess_config *config)
+{
+	kref_put(&config->ref, ml_lib_preprocess_config_release);
+}
+
+static inline s64 ml_lib_saturate(s64 value, u32 width)
+{
+	switch (width) {
+	case 1:
+		return clamp_t(s64, value, S8_MIN, S8_MAX);
+	case 2:
+		return clamp_t(s64, value, S16_MIN, S16_MAX);
+	case 4:
+		return clamp_t(s64, value, S32_MIN, S32_MAX);
+	}
+
+	return value;
+}
+
+static inline void ml_lib_store_feature(u8 *out, u64 value, u32 width)
+{
+	switch (width) {
+	case 1:
+		*out = (u8)value;
+		break;
+	case 2:
+		put_unaligned((u16)value, (u16 *)out);
+		break;
+	case 4:
+		put_unaligned((u32)value, (u32 *)out);
+		break;
+	default:
+		put_unaligned(value, (u64 *)out);
+		break;
+	}
+}
+
+static inline s64 ml_lib_normalize(const struct ml_lib_feature_desc *desc,
+				   s64 value)
+{
+	return (s64)mul_s64_u64_shr(value - desc->offset,
+				    desc->scale, desc->shift);
+}
+
+static u64 ml_lib_transform_feature(const struct ml_lib_feature_desc *desc,
+				    s64 value)
+{
+	s64 normalized;
+	u64 bucket;
+
+	switch (desc->transform) {
+	case ML_LIB_FEATURE_RAW:
+		return ml_lib_saturate(value, desc->width);
+
+	case ML_LIB_FEATURE_NORMALIZE:
+		normalized = ml_lib_normalize(desc, value);
+		return ml_lib_saturate(normalized, desc->width);
+
+	case ML_LIB_FEATURE_LOG2_BUCKET:
+		if (value <= desc->offset)
+			return 0;
+		bucket = fls64(value - desc->offset);
+		return min_t(u64, bucket, desc->nr_buckets - 1);
+
+	case ML_LIB_FEATURE_LINEAR_BUCKET:
+		normalized = ml_lib_normalize(desc, value);
+		return clamp_t(s64, normalized, 0, desc->nr_buckets - 1);
+
+	case ML_LIB_FEATURE_HASH:
+		return reciprocal_scale(hash_64(value ^ desc->seed, 32),
+					desc->nr_buckets);
+	}
+
+	return 0;
+}
+
+/*
+ * ml_lib_preprocess_records() - transform records in place
+ * @config: preprocessing configuration
+ * @payload: records of raw features
+ * @size: size of payload in bytes
+ *
+ * The tail of payload that is smaller than input record is dropped.
+ * Returns the size of transformed payload.
+ */
+u32 ml_lib_preprocess_records(const struct ml_lib_preprocess_config *config,
+			      void *payload, u32 size)
+{
+	u32 nr_records = size / config->in_record_size;
+	const u8 *in = payload;
+	u8 *out = payload;
+	u32 i, j;
+
+	for (i = 0; i < nr_records; i++) {
+		for (j = 0; j < config->nr_features; j++) {
+			const struct ml_lib_feature_desc *desc;
+			s64 value;
+
+			desc = &config->features[j];
+			value = get_unaligned((const s64 *)in);
+			in += sizeof(u64);
+
+			if (desc->transform == ML_LIB_FEATURE_DROP)
+				continue;
+
+			ml_lib_store_feature(out,
+					     ml_lib_transform_feature(desc, value),
+					     desc->width);
+			out += desc->width;
+		}
+	}
+
+	return nr_records * config->out_record_size;
+}
+
+/*
+ * The partial aggregates of one payload: sum[], min[], max[]
+ * and histogram[] of @nr_features features.
+ */
+static size_t ml_lib_partial_size(u32 nr_features)
+{
+	return array3_size(3 + ML_LIB_HISTOGRAM_BUCKETS, nr_features,
+			   sizeof(u64));
+}
+
+static void ml_lib_partial_merge(struct ml_lib_preprocess_config *config,
+				 const s64 *partial, u32 nr_records)
+{
+	u32 nr_features = config->nr_features;
+	const s64 *sum = partial;
+	const s64 *min = sum + nr_features;
+	const s64 *max = min + nr_features;
+	const u64 *histogram = (const u64 *)(max + nr_features);
+	u32 i;
+
+	lockdep_assert_held(&config->aggregate_lock);
+
+	for (i = 0; i < nr_features; i++) {
+		config->sum[i] += sum[i];
+		config->min[i] = min_t(s64, config->min[i], min[i]);
+		config->max[i] = max_t(s64, config->max[i], max[i]);
+	}
+
+	for (i = 0; i < nr_features * ML_LIB_HISTOGRAM_BUCKETS; i++)
+		config->histogram[i] += histogram[i];
+
+	config->nr_records += nr_records;
+}
+
+/*
+ * ml_lib_preprocess_aggregate() - aggregate records before transformation
+ * @config: preprocessing configuration
+ * @payload: records of raw features
+ * @size: size of payload in bytes
+ *
+ * The payload (up to several MB) is aggregated into the private
+ * partial aggregates without any lock, and only the merge of
+ * per-feature results is executed under aggregate_lock. So,
+ * the concurrent preprocessing and the sysfs readers never spin
+ * for the whole pass. The caller pins @config by reference and
+ * can sleep.
+ *
+ * Return: 0 on success, -ENOMEM if the partial aggregates cannot
+ * be allocated.
+ */
+int ml_lib_preprocess_aggregate(struct ml_lib_preprocess_config *config,
+				const void *payload, u32 size)
+{
+	u32 nr_features = config->nr_features;
+	u32 nr_records = size / config->in_record_size;
+	const s64 *records = payload;
+	s64 *partial;
+	s64 *min;
+	s64 *max;
+	u32 i;
+
+	if (!nr_records)
+		return 0;
+
+	partial = kzalloc(ml_lib_partial_size(nr_features), GFP_KERNEL);
+	if (unlikely(!partial))
+		return -ENOMEM;
+
+	min = partial + nr_features;
+	max = min + nr_features;
+
+	for (i = 0; i < nr_features; i++) {
+		min[i] = S64_MAX;
+		max[i] = S64_MIN;
+	}
+
+	ml_lib_aggregate_columns(records, nr_records, nr_features,
+				 partial, min, max);
+	ml_lib_log2_histogram(records, nr_records, nr_features,
+			      (u64 *)(max + nr_features));
+
+	spin_lock(&config->aggregate_lock);
+	ml_lib_partial_merge(config, partial, nr_records);
+	spin_unlock(&config->aggregate_lock);
+
+	kfree(partial);
+
+	return 0;
+}
@@ -0,0 +1,19 @@
+// SPDX-License-Identifier: GPL-2.0-only
+/*
+ * Machine Learning (ML) library
+ *
+ * Copyright (C) 2025-2026 Viacheslav Dubeyko <slava@dubeyko.com>
+ */
+
+#ifndef _LINUX_ML_LIB_PREPROCESS_H
+#define _LINUX_ML_LIB_PREPROCESS_H
+
+struct ml_lib_preprocess_config *
+ml_lib_preprocess_config_get(struct ml_lib_model *ml_model);
+void ml_lib_preprocess_config_put(struct ml_lib_preprocess_config *config);
+int ml_lib_preprocess_aggregate(struct ml_lib_preprocess_config *config,
+				const void *payload, u32 size);
+u32 ml_lib_preprocess_records(const struct ml_lib_preprocess_config *config,
+			      void *payload, u32 size);
+
+#endif /* _LINUX_ML_LIB_PREPROCESS_H */
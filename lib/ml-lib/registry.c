@@ -0,0 +1,75 @@
+// SPDX-License-Identifier: GPL-2.0-only
+/*
+ * Machine Learning (ML) library
+ *
+ * Copyright (C) 2025-2026 Viacheslav Dubeyko <slava@dubeyko.com>
+ */
+
+#include <linux/module.h>
+#include <linux/kernel.h>
+#include <linux/list.h>
+#include <linux/mutex.h>
+#include <linux/string.h>
+
+#include <linux/ml-lib/ml_lib.h>
+
+#include "registry.h"
+
+/*
+ * The registry keeps all created ML models, so the objects
+ * that are defined outside of kernel subsystem (for example,
+ * BPF struct_ops) can find the ML model by its names.
+ * The ML model is unregistered at the beginning of destroy,
+ * so the callback of ml_lib_model_registry_call() never sees
+ * the ML model that is being destroyed.
+ */
+
+static LIST_HEAD(ml_lib_models);
+static DEFINE_MUTEX(ml_lib_models_lock);
+
+void ml_lib_model_register(struct ml_lib_model *ml_model)
+{
+	mutex_lock(&ml_lib_models_lock);
+	list_add_tail(&ml_model->registry_node, &ml_lib_models);
+	mutex_unlock(&ml_lib_models_lock);
+}
+
+void ml_lib_model_unregister(struct ml_lib_model *ml_model)
+{
+	mutex_lock(&ml_lib_models_lock);
+	if (!list_empty(&ml_model->registry_node))
+		list_del_init(&ml_model->registry_node);
+	mutex_unlock(&ml_lib_models_lock);
+}
+
+/*
+ * ml_lib_model_registry_call() - execute callback for registered ML model
+ * @subsystem_name: name of kernel subsystem
+ * @model_name: name of ML model
+ * @fn: callback
+ * @data: callback's private data
+ *
+ * The callback is executed under registry lock, so the ML model
+ * cannot be unregistered during the callback execution.
+ * Returns -ENOENT if no ML model with such names has been registered.
+ */
+int ml_lib_model_registry_call(const char *subsystem_name,
+			       const char *model_name,
+			       int (*fn)(struct ml_lib_model *, void *),
+			       void *data)
+{
+	struct ml_lib_model *ml_model;
+	int err = -ENOENT;
+
+	mutex_lock(&ml_lib_models_lock);
+	list_for_each_entry(ml_model, &ml_lib_models, registry_node) {
+		if (strcmp(ml_model->subsystem_name, subsystem_name) == 0 &&
+		    strcmp(ml_model->model_name, model_name) == 0) {
+			err = fn(ml_model, data);
+			break;
+		}
+	}
+	mutex_unlock(&ml_lib_models_lock);
+
+	return err;
+}
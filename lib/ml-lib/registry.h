@@ -0,0 +1,18 @@
+// SPDX-License-Identifier: GPL-2.0-only
+/*
+ * Machine Learning (ML) library
+ *
+ * Copyright (C) 2025-2026 Viacheslav Dubeyko <slava@dubeyko.com>
+ */
+
+#ifndef _LINUX_ML_LIB_REGISTRY_H
+#define _LINUX_ML_LIB_REGISTRY_H
+
+void ml_lib_model_register(struct ml_lib_model *ml_model);
+void ml_lib_model_unregister(struct ml_lib_model *ml_model);
+int ml_lib_model_registry_call(const char *subsystem_name,
+			       const char *model_name,
+			       int (*fn)(struct ml_lib_model *, void *),
+			       void *data);
+
+#endif /* _LINUX_ML_LIB_REGISTRY_H */
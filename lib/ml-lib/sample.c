@@ -0,0 +1,338 @@
+// SPDX-License-Identifier: GPL-2.0-only
+/*
+ * Machine Learning (ML) library
+ *
+ * Copyright (C) 2025-2026 Viacheslav Dubeyko <slava@dubeyko.com>
+ */
+
+#include <linux/module.h>
+#include <linux/kernel.h>
+#include <linux/slab.h>
+#include <linux/percpu.h>
+#include <linux/cpumask.h>
+#include <linux/topology.h>
+#include <linux/log2.h>
+#include <linux/mutex.h>
+#include <linux/irqflags.h>
+#include <linux/overflow.h>
+#include <linux/srcu.h>
+
+#include <linux/ml-lib/ml_lib.h>
+
+#include "sample.h"
+
+/*
+ * Every CPU owns a single-producer/single-consumer ring of
+ * fixed-size samples. The producer is the owning CPU (interrupts
+ * are disabled during the record, so nested producers cannot
+ * interleave), the consumer is the drain step. The indices are
+ * published by release/acquire pairs, so neither side uses
+ * locks or atomic read-modify-write instructions.
+ *
+ * The buffers are allocated for every possible CPU and the drain
+ * step walks all possible CPUs. As a result, samples recorded
+ * by a CPU that goes offline are still drained later and no
+ * CPU hotplug callbacks are required. Every drain starts from
+ * the CPU that follows the last drained one, so the buffers of
+ * high-numbered CPUs are not starved by the full payloads.
+ *
+ * The recorders access the buffers with disabled interrupts
+ * (RCU readers), the drain and statistics sleep on drain_lock
+ * and access the buffers in ml_lib_samples_srcu read-side
+ * section. The destroy waits for both of them.
+ */
+
+DEFINE_STATIC_SRCU(ml_lib_samples_srcu);
+
+/*
+ * struct ml_lib_sample_buffer - per-CPU sample buffer
+ * @head: number of recorded samples (written by the owning CPU)
+ * @tail: number of drained samples (written by the drain step)
+ * @dropped: number of samples dropped because of full buffer
+ * @data: samples storage
+ */
+struct ml_lib_sample_buffer {
+	u64 head;
+	u64 tail;
+	u64 dropped;
+	u8 *data;
+};
+
+/*
+ * struct ml_lib_samples - per-CPU samples collection
+ * @sample_size: size of one sample in bytes
+ * @nr_samples: capacity of per-CPU buffer (power of two)
+ * @buffers: per-CPU buffers
+ * @drain_lock: serializes the drain step
+ * @drain_cpu: the first CPU of the next drain
+ */
+struct ml_lib_samples {
+	u32 sample_size;
+	u32 nr_samples;
+
+	struct ml_lib_sample_buffer __percpu *buffers;
+	struct mutex drain_lock;
+	int drain_cpu;
+};
+
+static void ml_lib_samples_free(struct ml_lib_samples *samples)
+{
+	int cpu;
+
+	if (!samples)
+		return;
+
+	if (samples->buffers) {
+		for_each_possible_cpu(cpu)
+			kvfree(per_cpu_ptr(samples->buffers, cpu)->data);
+
+		free_percpu(samples->buffers);
+	}
+
+	mutex_destroy(&samples->drain_lock);
+	kfree(samples);
+}
+
+int ml_model_create_sample_buffers(struct ml_lib_model *ml_model,
+				   u32 sample_size, u32 nr_samples)
+{
+	struct ml_lib_samples *samples;
+	struct ml_lib_sample_buffer *buffer;
+	size_t size;
+	int cpu;
+
+	if (!ml_model || !sample_size || !nr_samples)
+		return -EINVAL;
+
+	if (ml_model->samples)
+		return -EEXIST;
+
+	nr_samples = roundup_pow_of_two(nr_samples);
+	if (check_mul_overflow((size_t)sample_size, (size_t)nr_samples, &size))
+		return -E2BIG;
+
+	samples = kzalloc(sizeof(struct ml_lib_samples), GFP_KERNEL);
+	if (unlikely(!samples))
+		return -ENOMEM;
+
+	samples->sample_size = sample_size;
+	samples->nr_samples = nr_samples;
+	mutex_init(&samples->drain_lock);
+	samples->drain_cpu = cpumask_first(cpu_possible_mask);
+
+	samples->buffers = alloc_percpu(struct ml_lib_sample_buffer);
+	if (unlikely(!samples->buffers))
+		goto fail_create_buffers;
+
+	for_each_possible_cpu(cpu) {
+		buffer = per_cpu_ptr(samples->buffers, cpu);
+		buffer->data = kvzalloc_node(size, GFP_KERNEL,
+					     cpu_to_node(cpu));
+		if (unlikely(!buffer->data))
+			goto fail_create_buffers;
+	}
+
+	WRITE_ONCE(ml_model->samples, samples);
+
+	return 0;
+
+fail_create_buffers:
+	pr_err("ml_lib: failed to allocate sample buffers: size %zu\n", size);
+	ml_lib_samples_free(samples);
+	return -ENOMEM;
+}
+EXPORT_SYMBOL(ml_model_create_sample_buffers);
+
+void ml_model_destroy_sample_buffers(struct ml_lib_model *ml_model)
+{
+	struct ml_lib_samples *samples;
+
+	if (!ml_model)
+		return;
+
+	samples = READ_ONCE(ml_model->samples);
+	if (!samples)
+		return;
+
+	WRITE_ONCE(ml_model->samples, NULL);
+
+	/* recording happens with disabled interrupts (RCU reader) */
+	synchronize_rcu();
+	/* the drain and statistics sleep on drain_lock */
+	synchronize_srcu(&ml_lib_samples_srcu);
+
+	ml_lib_samples_free(samples);
+}
+EXPORT_SYMBOL(ml_model_destroy_sample_buffers);
+
+/*
+ * ml_lib_record_sample() - record sample into the local CPU's buffer
+ * @ml_model: ML model object
+ * @sample: pointer on sample of the size defined at creation
+ *
+ * It can be called from any context, including hard interrupts.
+ *
+ * Return: 0 on success, -ENOSPC if the local buffer is full,
+ *         -ENODEV if ML model has no sample buffers.
+ */
+int ml_lib_record_sample(struct ml_lib_model *ml_model, const void *sample)
+{
+	struct ml_lib_samples *samples;
+	struct ml_lib_sample_buffer *buffer;
+	unsigned long flags;
+	u32 index;
+	u64 head;
+	int err = 0;
+
+	local_irq_save(flags);
+
+	samples = READ_ONCE(ml_model->samples);
+	if (unlikely(!samples)) {
+		err = -ENODEV;
+		goto finish_record;
+	}
+
+	buffer = this_cpu_ptr(samples->buffers);
+	head = buffer->head;
+
+	if (head - smp_load_acquire(&buffer->tail) >= samples->nr_samples) {
+		buffer->dropped++;
+		err = -ENOSPC;
+		goto finish_record;
+	}
+
+	index = head & (samples->nr_samples - 1);
+	memcpy(buffer->data + (size_t)index * samples->sample_size,
+		sample, samples->sample_size);
+
+	/* sample should be visible before the index */
+	smp_store_release(&buffer->head, head + 1);
+
+finish_record:
+	local_irq_restore(flags);
+
+	return err;
+}
+EXPORT_SYMBOL(ml_lib_record_sample);
+
+static int ml_lib_samples_next_cpu(int cpu)
+{
+	cpu = cpumask_next(cpu, cpu_possible_mask);
+	if (cpu >= nr_cpu_ids)
+		cpu = cpumask_first(cpu_possible_mask);
+
+	return cpu;
+}
+
+static u32 __ml_lib_samples_drain(struct ml_lib_samples *samples,
+				  struct ml_lib_dataset *dataset)
+{
+	struct ml_lib_sample_buffer *buffer;
+	u32 sample_size = samples->sample_size;
+	u32 mask = samples->nr_samples - 1;
+	size_t free_space;
+	u8 *dst;
+	u32 appended = 0;
+	int start;
+	int cpu;
+
+	free_space = dataset->allocated_size - dataset->portion_size;
+	dst = (u8 *)dataset->payload + dataset->portion_size;
+
+	mutex_lock(&samples->drain_lock);
+
+	start = samples->drain_cpu;
+	cpu = start;
+
+	do {
+		u64 head, tail;
+
+		buffer = per_cpu_ptr(samples->buffers, cpu);
+		tail = buffer->tail;
+		head = smp_load_acquire(&buffer->head);
+
+		while (tail != head && free_space >= sample_size) {
+			u32 index = tail & mask;
+
+			memcpy(dst, buffer->data + (size_t)index * sample_size,
+				sample_size);
+			dst += sample_size;
+			free_space -= sample_size;
+			tail++;
+			appended++;
+		}
+
+		/* slots should be read before they are given back */
+		smp_store_release(&buffer->tail, tail);
+
+		cpu = ml_lib_samples_next_cpu(cpu);
+	} while (cpu != start && free_space >= sample_size);
+
+	/* the next drain starts after the last drained CPU */
+	if (cpu == start)
+		cpu = ml_lib_samples_next_cpu(start);
+	samples->drain_cpu = cpu;
+
+	mutex_unlock(&samples->drain_lock);
+
+	dataset->portion_size += appended * sample_size;
+
+	return appended;
+}
+
+/*
+ * ml_lib_samples_drain() - merge per-CPU samples into the dataset
+ * @ml_model: ML model object
+ * @dataset: dataset with payload
+ *
+ * Samples are appended to the dataset's payload after
+ * @dataset->portion_size bytes. The samples that don't fit
+ * into the payload stay in the buffers till the next drain.
+ *
+ * Return: number of appended samples.
+ */
+u32 ml_lib_samples_drain(struct ml_lib_model *ml_model,
+			 struct ml_lib_dataset *dataset)
+{
+	struct ml_lib_samples *samples;
+	u32 appended = 0;
+	int idx;
+
+	if (!dataset->payload ||
+	    dataset->portion_size >= dataset->allocated_size)
+		return 0;
+
+	idx = srcu_read_lock(&ml_lib_samples_srcu);
+	samples = READ_ONCE(ml_model->samples);
+	if (samples)
+		appended = __ml_lib_samples_drain(samples, dataset);
+	srcu_read_unlock(&ml_lib_samples_srcu, idx);
+
+	return appended;
+}
+
+void ml_lib_samples_stat(struct ml_lib_model *ml_model,
+			 u64 *recorded, u64 *dropped)
+{
+	struct ml_lib_samples *samples;
+	struct ml_lib_sample_buffer *buffer;
+	int idx;
+	int cpu;
+
+	*recorded = 0;
+	*dropped = 0;
+
+	idx = srcu_read_lock(&ml_lib_samples_srcu);
+	samples = READ_ONCE(ml_model->samples);
+	if (!samples)
+		goto finish_stat;
+
+	for_each_possible_cpu(cpu) {
+		buffer = per_cpu_ptr(samples->buffers, cpu);
+		*recorded += READ_ONCE(buffer->head);
+		*dropped += READ_ONCE(buffer->dropped);
+	}
+
+finish_stat:
+	srcu_read_unlock(&ml_lib_samples_srcu, idx);
+}
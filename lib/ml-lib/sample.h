@@ -0,0 +1,16 @@
+// SPDX-License-Identifier: GPL-2.0-only
+/*
+ * Machine Learning (ML) library
+ *
+ * Copyright (C) 2025-2026 Viacheslav Dubeyko <slava@dubeyko.com>
+ */
+
+#ifndef _LINUX_ML_LIB_SAMPLE_H
+#define _LINUX_ML_LIB_SAMPLE_H
+
+u32 ml_lib_samples_drain(struct ml_lib_model *ml_model,
+			 struct ml_lib_dataset *dataset);
+void ml_lib_samples_stat(struct ml_lib_model *ml_model,
+			 u64 *recorded, u64 *dropped);
+
+#endif /* _LINUX_ML_LIB_SAMPLE_H */
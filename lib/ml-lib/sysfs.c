@@ -11,6 +11,18 @@
 #include <linux/ml-lib/ml_lib.h>
 
 #include "sysfs.h"
+#include "dataset_queue.h"
+#include "sample.h"
+#include "aggregate.h"
+#include "tree_ensemble.h"
+#include "mlp.h"
+#include "model_blob.h"
+#include "worker.h"
+#include "hint_ring.h"
+#include "hint_cache.h"
+#include "governor.h"
+#include "decision.h"
+#include "agent.h"
 
 struct ml_lib_feature_attr {
 	struct attribute attr;
@@ -41,6 +53,7 @@ enum {
 	ML_LIB_STOP_COMMAND,
 	ML_LIB_PREPARE_DATASET_COMMAND,
 	ML_LIB_DISCARD_DATASET_COMMAND,
+	ML_LIB_RESET_STREAM_COMMAND,
 	ML_LIB_COMMAND_NUMBER
 };
 
@@ -49,6 +62,7 @@ static const char *control_command_str[ML_LIB_COMMAND_NUMBER] = {
 	"stop",
 	"prepare_dataset",
 	"discard_dataset",
+	"reset_stream",
 };
 
 static ssize_t ml_lib_feature_control_store(struct ml_lib_feature_attr *attr,
@@ -85,6 +99,11 @@ static ssize_t ml_lib_feature_control_store(struct ml_lib_feature_attr *attr,
 	case ML_LIB_DISCARD_DATASET_COMMAND:
 		err = ml_model_discard_dataset(ml_model);
 		break;
+
+	case ML_LIB_RESET_STREAM_COMMAND:
+		ml_model_reset_stream(ml_model);
+		err = 0;
+		break;
 	}
 
 	if (unlikely(err))
@@ -93,15 +112,328 @@ static ssize_t ml_lib_feature_control_store(struct ml_lib_feature_attr *attr,
 	return len;
 }
 
+static ssize_t ml_lib_feature_datasets_show(struct ml_lib_feature_attr *attr,
+					    struct ml_lib_model *ml_model,
+					    char *buf)
+{
+	struct ml_lib_dataset_queue *queue = ml_model->datasets;
+
+	if (!queue)
+		return sysfs_emit(buf, "0 0\n");
+
+	return sysfs_emit(buf, "%u %u\n",
+			  ml_lib_dataset_queue_count(queue),
+			  ml_lib_dataset_queue_depth(queue));
+}
+
+static ssize_t ml_lib_feature_samples_show(struct ml_lib_feature_attr *attr,
+					   struct ml_lib_model *ml_model,
+					   char *buf)
+{
+	u64 recorded;
+	u64 dropped;
+
+	ml_lib_samples_stat(ml_model, &recorded, &dropped);
+
+	return sysfs_emit(buf, "recorded %llu dropped %llu\n",
+			  recorded, dropped);
+}
+
+static ssize_t ml_lib_feature_stream_show(struct ml_lib_feature_attr *attr,
+					  struct ml_lib_model *ml_model,
+					  char *buf)
+{
+	return sysfs_emit(buf, "%llu\n", ml_model_stream_cursor(ml_model));
+}
+
+static ssize_t
+ml_lib_feature_uncompressed_bytes_show(struct ml_lib_feature_attr *attr,
+				       struct ml_lib_model *ml_model,
+				       char *buf)
+{
+	return sysfs_emit(buf, "%lld\n",
+			  atomic64_read(&ml_model->uncompressed_bytes));
+}
+
+static ssize_t
+ml_lib_feature_compressed_bytes_show(struct ml_lib_feature_attr *attr,
+				     struct ml_lib_model *ml_model,
+				     char *buf)
+{
+	return sysfs_emit(buf, "%lld\n",
+			  atomic64_read(&ml_model->compressed_bytes));
+}
+
+static ssize_t ml_lib_feature_preprocess_show(struct ml_lib_feature_attr *attr,
+					      struct ml_lib_model *ml_model,
+					      char *buf)
+{
+	struct ml_lib_preprocess_config *config;
+	ssize_t count;
+
+	rcu_read_lock();
+	config = rcu_dereference(ml_model->preprocess_config);
+	if (!config)
+		count = sysfs_emit(buf, "disabled\n");
+	else {
+		count = sysfs_emit(buf,
+				   "features %u in_record %u out_record %u\n",
+				   config->nr_features,
+				   config->in_record_size,
+				   config->out_record_size);
+	}
+	rcu_read_unlock();
+
+	return count;
+}
+
+/* room for the line of truncated aggregates */
+#define ML_LIB_AGGREGATES_RESERVE	(64)
+
+static ssize_t ml_lib_feature_aggregates_show(struct ml_lib_feature_attr *attr,
+					      struct ml_lib_model *ml_model,
+					      char *buf)
+{
+	const size_t limit = PAGE_SIZE - ML_LIB_AGGREGATES_RESERVE;
+	struct ml_lib_preprocess_config *config;
+	ssize_t count;
+	ssize_t start;
+	u32 i, j;
+
+	count = sysfs_emit(buf, "kernel %s\n", ml_lib_aggregate_kernel());
+
+	rcu_read_lock();
+	config = rcu_dereference(ml_model->preprocess_config);
+	if (!config) {
+		rcu_read_unlock();
+		return count;
+	}
+
+	spin_lock(&config->aggregate_lock);
+	count += sysfs_emit_at(buf, count, "records %llu\n",
+			       config->nr_records);
+
+	/*
+	 * The features are shown while their lines fit into the page.
+	 * The line that doesn't fit is dropped entirely, so the output
+	 * never ends by the truncated line.
+	 */
+	for (i = 0; i < config->nr_features; i++) {
+		const u64 *histogram = config->histogram +
+					i * ML_LIB_HISTOGRAM_BUCKETS;
+
+		start = count;
+		count += scnprintf(buf + count, limit - count,
+				   "feature %u sum %lld min %lld max %lld "
+				   "log2_histogram",
+				   i, config->sum[i],
+				   config->min[i], config->max[i]);
+
+		/* only non-empty buckets as bucket:counter pairs */
+		for (j = 0; j < ML_LIB_HISTOGRAM_BUCKETS; j++) {
+			if (!histogram[j])
+				continue;
+
+			count += scnprintf(buf + count, limit - count,
+					   " %u:%llu", j, histogram[j]);
+		}
+
+		count += scnprintf(buf + count, limit - count, "\n");
+
+		if (count >= limit - 1) {
+			count = start;
+			break;
+		}
+	}
+
+	if (i < config->nr_features) {
+		count += sysfs_emit_at(buf, count,
+				       "truncated %u of %u features\n",
+				       config->nr_features - i,
+				       config->nr_features);
+	}
+	spin_unlock(&config->aggregate_lock);
+	rcu_read_unlock();
+
+	return count;
+}
+
+static const char * const ml_lib_mode_str[ML_LIB_MODE_MAX] = {
+	"unknown",
+	"emergency",
+	"learning",
+	"collaboration",
+	"recommendation",
+};
+
+static ssize_t ml_lib_feature_mode_show(struct ml_lib_feature_attr *attr,
+					struct ml_lib_model *ml_model,
+					char *buf)
+{
+	int mode = atomic_read(&ml_model->mode);
+
+	if (mode < 0 || mode >= ML_LIB_MODE_MAX)
+		mode = ML_LIB_UNKNOWN_MODE;
+
+	return sysfs_emit(buf, "%s\n", ml_lib_mode_str[mode]);
+}
+
+static ssize_t ml_lib_feature_mode_store(struct ml_lib_feature_attr *attr,
+					 struct ml_lib_model *ml_model,
+					 const char *buf, size_t len)
+{
+	int mode;
+	int err;
+
+	mode = sysfs_match_string(ml_lib_mode_str, buf);
+	if (mode < 0)
+		return mode;
+
+	err = ml_model_set_mode(ml_model, mode);
+	if (unlikely(err))
+		return err;
+
+	return len;
+}
+
+static ssize_t
+ml_lib_feature_tree_ensemble_show(struct ml_lib_feature_attr *attr,
+				  struct ml_lib_model *ml_model,
+				  char *buf)
+{
+	return ml_lib_tree_ensemble_info(ml_model, buf);
+}
+
+static ssize_t ml_lib_feature_mlp_show(struct ml_lib_feature_attr *attr,
+				       struct ml_lib_model *ml_model,
+				       char *buf)
+{
+	return ml_lib_mlp_info(ml_model, buf);
+}
+
+static ssize_t
+ml_lib_feature_model_version_show(struct ml_lib_feature_attr *attr,
+				  struct ml_lib_model *ml_model,
+				  char *buf)
+{
+	return sysfs_emit(buf, "%llu\n", READ_ONCE(ml_model->model_version));
+}
+
+static ssize_t
+ml_lib_feature_effective_interval_show(struct ml_lib_feature_attr *attr,
+				       struct ml_lib_model *ml_model,
+				       char *buf)
+{
+	return sysfs_emit(buf, "%u\n", ml_lib_worker_interval(ml_model));
+}
+
+static ssize_t ml_lib_feature_worker_show(struct ml_lib_feature_attr *attr,
+					  struct ml_lib_model *ml_model,
+					  char *buf)
+{
+	return ml_lib_worker_info(ml_model, buf);
+}
+
+static ssize_t ml_lib_feature_hints_show(struct ml_lib_feature_attr *attr,
+					 struct ml_lib_model *ml_model,
+					 char *buf)
+{
+	return ml_lib_hint_ring_info(ml_model, buf);
+}
+
+static ssize_t ml_lib_feature_hint_cache_show(struct ml_lib_feature_attr *attr,
+					      struct ml_lib_model *ml_model,
+					      char *buf)
+{
+	return ml_lib_hint_cache_info(ml_model, buf);
+}
+
+static ssize_t ml_lib_feature_governor_show(struct ml_lib_feature_attr *attr,
+					    struct ml_lib_model *ml_model,
+					    char *buf)
+{
+	return ml_lib_governor_info(ml_model, buf);
+}
+
+static ssize_t ml_lib_feature_decisions_show(struct ml_lib_feature_attr *attr,
+					     struct ml_lib_model *ml_model,
+					     char *buf)
+{
+	return ml_lib_decision_info(ml_model, buf);
+}
+
+static ssize_t ml_lib_feature_agents_show(struct ml_lib_feature_attr *attr,
+					  struct ml_lib_model *ml_model,
+					  char *buf)
+{
+	return ml_lib_agent_info(ml_model, buf);
+}
+
 ML_LIB_FEATURE_W_ATTR(control);
+ML_LIB_FEATURE_RO_ATTR(datasets);
+ML_LIB_FEATURE_RO_ATTR(samples);
+ML_LIB_FEATURE_RO_ATTR(stream);
+ML_LIB_FEATURE_RO_ATTR(uncompressed_bytes);
+ML_LIB_FEATURE_RO_ATTR(compressed_bytes);
+ML_LIB_FEATURE_RO_ATTR(preprocess);
+ML_LIB_FEATURE_RO_ATTR(aggregates);
+ML_LIB_FEATURE_RW_ATTR(mode);
+ML_LIB_FEATURE_RO_ATTR(tree_ensemble);
+ML_LIB_FEATURE_RO_ATTR(mlp);
+ML_LIB_FEATURE_RO_ATTR(model_version);
+ML_LIB_FEATURE_RO_ATTR(effective_interval);
+ML_LIB_FEATURE_RO_ATTR(worker);
+ML_LIB_FEATURE_RO_ATTR(hints);
+ML_LIB_FEATURE_RO_ATTR(hint_cache);
+ML_LIB_FEATURE_RO_ATTR(governor);
+ML_LIB_FEATURE_RO_ATTR(decisions);
+ML_LIB_FEATURE_RO_ATTR(agents);
 
 static struct attribute *ml_model_attrs[] = {
 	&ml_lib_feature_attr_control.attr,
+	&ml_lib_feature_attr_datasets.attr,
+	&ml_lib_feature_attr_samples.attr,
+	&ml_lib_feature_attr_stream.attr,
+	&ml_lib_feature_attr_uncompressed_bytes.attr,
+	&ml_lib_feature_attr_compressed_bytes.attr,
+	&ml_lib_feature_attr_preprocess.attr,
+	&ml_lib_feature_attr_aggregates.attr,
+	&ml_lib_feature_attr_mode.attr,
+	&ml_lib_feature_attr_tree_ensemble.attr,
+	&ml_lib_feature_attr_mlp.attr,
+	&ml_lib_feature_attr_model_version.attr,
+	&ml_lib_feature_attr_effective_interval.attr,
+	&ml_lib_feature_attr_worker.attr,
+	&ml_lib_feature_attr_hints.attr,
+	&ml_lib_feature_attr_hint_cache.attr,
+	&ml_lib_feature_attr_governor.attr,
+	&ml_lib_feature_attr_decisions.attr,
+	&ml_lib_feature_attr_agents.attr,
+	NULL,
+};
+
+/* /sys/<subsystem>/<ml_model>/model - upload of model blob */
+static ssize_t model_write(struct file *file, struct kobject *kobj,
+			   const struct bin_attribute *attr,
+			   char *buf, loff_t off, size_t count)
+{
+	struct ml_lib_model *ml_model = container_of(kobj,
+						     struct ml_lib_model,
+						     kobj);
+
+	return ml_lib_model_blob_write(ml_model, buf, off, count);
+}
+
+static const BIN_ATTR_WO(model, 0);
+
+static const struct bin_attribute *const ml_model_bin_attrs[] = {
+	&bin_attr_model,
 	NULL,
 };
 
 static const struct attribute_group ml_model_group = {
 	.attrs = ml_model_attrs,
+	.bin_attrs = ml_model_bin_attrs,
 };
 
 static const struct attribute_group *ml_model_groups[] = {
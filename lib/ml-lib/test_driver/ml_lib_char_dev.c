@@ -17,6 +17,13 @@
 #include <linux/proc_fs.h>
 #include <linux/seq_file.h>
 #include <linux/mutex.h>
+#include <linux/mm.h>
+#include <linux/ktime.h>
+#include <linux/math64.h>
+#include <linux/io_uring/cmd.h>
+#include <linux/poll.h>
+#include <linux/random.h>
+#include <linux/workqueue.h>
 #include <linux/ml-lib/ml_lib.h>
 
 #define DEVICE_NAME "mllibdev"
@@ -28,13 +35,52 @@
 #define ML_LIB_TEST_DEV_IOCRESET    _IO(ML_LIB_TEST_DEV_IOC_MAGIC, 0)
 #define ML_LIB_TEST_DEV_IOCGETSIZE  _IOR(ML_LIB_TEST_DEV_IOC_MAGIC, 1, int)
 #define ML_LIB_TEST_DEV_IOCSETSIZE  _IOW(ML_LIB_TEST_DEV_IOC_MAGIC, 2, int)
+#define ML_LIB_TEST_DEV_IOCLOADTREES \
+	_IOW(ML_LIB_TEST_DEV_IOC_MAGIC, 3, struct ml_lib_test_dev_image)
+#define ML_LIB_TEST_DEV_IOCDECIDE \
+	_IOWR(ML_LIB_TEST_DEV_IOC_MAGIC, 4, struct ml_lib_test_dev_decision)
+
+#define ML_LIB_TEST_DEV_IOCBENCHMLP \
+	_IOWR(ML_LIB_TEST_DEV_IOC_MAGIC, 5, struct ml_lib_test_dev_mlp_bench)
+#define ML_LIB_TEST_DEV_IOCAGENTS   _IOW(ML_LIB_TEST_DEV_IOC_MAGIC, 6, int)
+
+#define ML_LIB_TEST_DEV_IMAGE_SIZE_MAX	(16 * 1024 * 1024)
+#define ML_LIB_TEST_DEV_BENCH_ITERATIONS_MAX	(10 * 1000 * 1000)
+#define ML_LIB_TEST_DEV_FEATURES	(4)
+
+/* Image of tree ensemble in user-space memory */
+struct ml_lib_test_dev_image {
+	__u64 addr;
+	__u64 size;
+};
+
+/* Decision that is evaluated by in-kernel tree ensemble */
+struct ml_lib_test_dev_decision {
+	__s64 features[ML_LIB_TEST_DEV_FEATURES];
+	__s64 value;
+};
+
+/* Microbenchmark of two-layer quantized MLP with random weights */
+struct ml_lib_test_dev_mlp_bench {
+	__u32 input_size;
+	__u32 hidden_size;
+	__u32 output_size;
+	__u32 iterations;
+	__u64 nsec_per_inference;
+};
+
+/*
+ * Emulated user-space agents of ml_model1: the hedged live agents
+ * and one shadow agent (the last one).
+ */
+#define ML_LIB_TEST_DEV_HEDGED_AGENTS	(2)
+#define ML_LIB_TEST_DEV_AGENTS		(ML_LIB_TEST_DEV_HEDGED_AGENTS + 1)
 
 /* Device data structure */
 struct ml_lib_test_dev_data {
 	struct cdev cdev;
 	struct device *device;
-	char *dataset_buf;
-	size_t dataset_buf_size;
+	size_t portion_size;
 	size_t dataset_size;
 	char *recommendations_buf;
 	size_t recommendations_buf_size;
@@ -43,11 +89,41 @@ struct ml_lib_test_dev_data {
 	unsigned long access_count;
 	unsigned long read_count;
 	unsigned long write_count;
+	atomic64_t recommendation_count;
+	atomic64_t feedback_count;
+	atomic64_t feedback_error;
+	atomic64_t feedback_errors;
+	u8 stream_pattern;
 
 	struct ml_lib_model *ml_model1;
+
+	bool agents_attached;
+	struct ml_lib_agent agents[ML_LIB_TEST_DEV_AGENTS];
 };
 
 #define ML_MODEL_1_NAME "ml_model1"
+#define ML_MODEL_1_RING_SLOTS 16
+#define ML_MODEL_1_PORTION_SIZE_DEFAULT (1024 * BUFFER_SIZE)
+#define ML_MODEL_1_SAMPLES_PER_CPU 64
+#define ML_MODEL_1_STREAM_SIZE (64ULL * 1024 * BUFFER_SIZE)
+#define ML_MODEL_1_MIN_SLEEP_TIMEOUT 1
+#define ML_MODEL_1_MAX_SLEEP_TIMEOUT 1000
+#define ML_MODEL_1_HINT_CACHE_ENTRIES 256
+#define ML_MODEL_1_HINT_CACHE_TTL 1000
+#define ML_MODEL_1_DEFAULT_ERROR 100
+#define ML_MODEL_1_DECISION_BUDGET_NS (100 * NSEC_PER_USEC)
+
+enum {
+	ML_LIB_TEST_DEV_READ_OP,
+	ML_LIB_TEST_DEV_WRITE_OP,
+};
+
+/* Sample of the device's activity */
+struct ml_lib_test_dev_sample {
+	u64 timestamp;
+	u32 operation;
+	u32 bytes;
+};
 
 static
 int ml_lib_test_dev_extract_dataset(struct ml_lib_model *ml_model,
@@ -57,6 +133,74 @@ static struct ml_lib_dataset_operations ml_lib_test_dev_dataset_ops = {
 	.extract = ml_lib_test_dev_extract_dataset,
 };
 
+static
+int ml_lib_test_dev_apply_recommendation(struct ml_lib_model *ml_model,
+				struct ml_lib_user_space_recommendation *hint);
+static
+int ml_lib_test_dev_error_backpropagation(struct ml_lib_model *ml_model,
+				struct ml_lib_backpropagation_feedback *feedback,
+				struct ml_lib_user_space_notification *notify);
+static
+int ml_lib_test_dev_estimate_efficiency(struct ml_lib_model *ml_model,
+				struct ml_lib_user_space_recommendation *hint,
+				struct ml_lib_user_space_request *request);
+
+static struct ml_lib_model_operations ml_lib_test_dev_model_ops = {
+	.apply_recommendation = ml_lib_test_dev_apply_recommendation,
+	.error_backpropagation = ml_lib_test_dev_error_backpropagation,
+	.estimate_efficiency = ml_lib_test_dev_estimate_efficiency,
+};
+
+static
+int ml_lib_test_dev_agent_send(struct ml_lib_agent *agent,
+			       struct ml_lib_user_space_request *request);
+
+static struct ml_lib_agent_operations ml_lib_test_dev_agent_ops = {
+	.send_request = ml_lib_test_dev_agent_send,
+};
+
+static const char * const ml_lib_test_dev_agent_names[] = {
+	"test_agent0",
+	"test_agent1",
+	"test_shadow",
+};
+
+/* answers of emulated agents */
+static struct workqueue_struct *ml_lib_test_dev_agent_wq;
+
+static unsigned int compression = ML_LIB_NO_COMPRESSION;
+module_param(compression, uint, 0444);
+MODULE_PARM_DESC(compression,
+		 "Compression of published datasets (0 - none, 1 - lz4, 2 - zstd)");
+
+static unsigned int ml_model1_portion_size = ML_MODEL_1_PORTION_SIZE_DEFAULT;
+module_param_named(portion_size, ml_model1_portion_size, uint, 0444);
+MODULE_PARM_DESC(portion_size, "Size of dataset portion in bytes");
+
+static bool preprocess;
+module_param(preprocess, bool, 0444);
+MODULE_PARM_DESC(preprocess, "Preprocess the datasets in kernel");
+
+static unsigned int worker_class = ML_LIB_WORKER_NORMAL_CLASS;
+module_param(worker_class, uint, 0444);
+MODULE_PARM_DESC(worker_class,
+		 "Priority class of worker (0 - normal, 1 - high, 2 - background)");
+
+static unsigned int worker_budget;
+module_param(worker_budget, uint, 0444);
+MODULE_PARM_DESC(worker_budget,
+		 "CPU time of worker in microseconds per second (0 - no limit)");
+
+static unsigned int governor_interval;
+module_param(governor_interval, uint, 0444);
+MODULE_PARM_DESC(governor_interval,
+		 "Interval of mode governor in milliseconds (0 - no governor)");
+
+static unsigned int recommendations_capacity = BUFFER_SIZE;
+module_param_named(recommendations_size, recommendations_capacity, uint, 0444);
+MODULE_PARM_DESC(recommendations_size,
+		 "Size of recommendations buffer in bytes");
+
 static dev_t dev_number;
 static struct class *ml_lib_test_dev_class;
 static struct ml_lib_test_dev_data *dev_data;
@@ -69,22 +213,293 @@ int ml_lib_test_dev_extract_dataset(struct ml_lib_model *ml_model,
 {
 	struct ml_lib_test_dev_data *data =
 		(struct ml_lib_test_dev_data *)ml_model->parent->private;
-	u8 pattern;
+	u64 offset = dataset->portion_offset;
+	u64 remaining;
+	u32 portion;
+	u32 pos;
+
+	/* the portion is stored into the dataset ring directly */
+	if (!dataset->payload)
+		return -ENOBUFS;
+
+	if (offset >= ML_MODEL_1_STREAM_SIZE)
+		offset = 0;
+
+	/*
+	 * Emulate the stream of ML_MODEL_1_STREAM_SIZE bytes.
+	 * Every extraction produces only the next portion.
+	 */
+	remaining = ML_MODEL_1_STREAM_SIZE - offset;
+	portion = min_t(u64, remaining, dataset->portion_limit);
 
 	mutex_lock(&data->lock);
-	get_random_bytes(&pattern, 1);
-	memset(data->dataset_buf, pattern, data->dataset_buf_size);
-	data->dataset_size = data->dataset_buf_size;
+	if (offset == 0)
+		get_random_bytes(&data->stream_pattern, 1);
+
+	/* every KB of the stream has its own pattern */
+	for (pos = 0; pos < portion; pos += BUFFER_SIZE) {
+		u8 pattern = data->stream_pattern ^
+				(u8)((offset + pos) / BUFFER_SIZE);
+
+		memset((u8 *)dataset->payload + pos, pattern,
+			min_t(u32, BUFFER_SIZE, portion - pos));
+	}
+	data->dataset_size = portion;
+
 	atomic_set(&dataset->type, ML_LIB_MEMORY_STREAM_DATASET);
-	atomic_set(&dataset->state, ML_LIB_DATASET_CLEAN);
-	dataset->allocated_size = data->dataset_buf_size;
-	dataset->portion_offset = 0;
-	dataset->portion_size = data->dataset_buf_size;
+	if (offset + portion < ML_MODEL_1_STREAM_SIZE) {
+		atomic_set(&dataset->state,
+			   ML_LIB_DATASET_EXTRACTED_PARTIALLY);
+	} else {
+		atomic_set(&dataset->state,
+			   ML_LIB_DATASET_EXTRACTED_COMPLETELY);
+	}
+	dataset->portion_offset = offset;
+	dataset->portion_size = portion;
 	mutex_unlock(&data->lock);
 
 	return 0;
 }
 
+/*
+ * The recommendations and feedback can be delivered by io_uring
+ * commands in big batches, so the test driver only counts them
+ * without taking the device's lock.
+ */
+static
+int ml_lib_test_dev_apply_recommendation(struct ml_lib_model *ml_model,
+				struct ml_lib_user_space_recommendation *hint)
+{
+	struct ml_lib_test_dev_data *data =
+		(struct ml_lib_test_dev_data *)ml_model->parent->private;
+
+	atomic64_inc(&data->recommendation_count);
+
+	return 0;
+}
+
+static
+int ml_lib_test_dev_error_backpropagation(struct ml_lib_model *ml_model,
+				struct ml_lib_backpropagation_feedback *feedback,
+				struct ml_lib_user_space_notification *notify)
+{
+	struct ml_lib_test_dev_data *data =
+		(struct ml_lib_test_dev_data *)ml_model->parent->private;
+	s64 error = feedback->error;
+	/* negation in u64 is defined for S64_MIN too */
+	u64 magnitude = error < 0 ? -(u64)error : (u64)error;
+
+	atomic64_inc(&data->feedback_count);
+	atomic64_add(magnitude, &data->feedback_error);
+	atomic64_inc(&data->feedback_errors);
+
+	return 0;
+}
+
+/*
+ * The right decision of the test device is the sum of the request's
+ * features. The emulated live agents answer it exactly and the shadow
+ * agent answers it with the error up to ML_MODEL_1_DEFAULT_ERROR.
+ */
+static s64 ml_lib_test_dev_reference(const s64 *features, u32 nr_features)
+{
+	s64 value = 0;
+	u32 i;
+
+	for (i = 0; i < nr_features; i++)
+		value += features[i];
+
+	return value;
+}
+
+/*
+ * The default algorithm of the test device is assumed to have
+ * the mean absolute error of ML_MODEL_1_DEFAULT_ERROR. So, ML model
+ * has 100% efficiency for the same error and 200% for exact
+ * recommendations.
+ */
+static int ml_lib_test_dev_efficiency(u64 error)
+{
+	error = min_t(u64, error, 2 * ML_MODEL_1_DEFAULT_ERROR);
+
+	return (2 * ML_MODEL_1_DEFAULT_ERROR - (int)error) * 100 /
+		ML_MODEL_1_DEFAULT_ERROR;
+}
+
+/*
+ * The error of the governor's interval is taken from the feedback
+ * of user-space. The answer of shadow agent is scored by its error
+ * against the reference decision for the answered request's features,
+ * so the scoring never consumes the feedback of the governor.
+ */
+static
+int ml_lib_test_dev_estimate_efficiency(struct ml_lib_model *ml_model,
+				struct ml_lib_user_space_recommendation *hint,
+				struct ml_lib_user_space_request *request)
+{
+	struct ml_lib_test_dev_data *data =
+		(struct ml_lib_test_dev_data *)ml_model->parent->private;
+	u64 errors, error;
+	s64 reference;
+
+	if (request->id == ML_LIB_GOVERNOR_REQUEST_ID) {
+		errors = atomic64_xchg(&data->feedback_errors, 0);
+		error = atomic64_xchg(&data->feedback_error, 0);
+		if (!errors)
+			return -ENODATA;
+
+		return ml_lib_test_dev_efficiency(div64_u64(error, errors));
+	}
+
+	if (!(request->id & ML_LIB_DECISION_REQUEST_ID))
+		return -EOPNOTSUPP;
+
+	if (!request->features ||
+	    request->nr_features != ML_LIB_TEST_DEV_FEATURES)
+		return -ENODATA;
+
+	reference = ml_lib_test_dev_reference(request->features,
+					      request->nr_features);
+
+	/* the difference can overflow s64 */
+	error = hint->value >= reference ?
+			(u64)hint->value - (u64)reference :
+			(u64)reference - (u64)hint->value;
+
+	return ml_lib_test_dev_efficiency(error);
+}
+
+/*
+ * struct ml_lib_test_dev_answer - pending answer of emulated agent
+ * @work: the answer is submitted by the work
+ * @agent: agent that answers
+ * @hint: recommendation of agent
+ */
+struct ml_lib_test_dev_answer {
+	struct work_struct work;
+	struct ml_lib_agent *agent;
+	struct ml_lib_user_space_recommendation hint;
+};
+
+static void ml_lib_test_dev_agent_answer(struct work_struct *work)
+{
+	struct ml_lib_test_dev_answer *answer =
+		container_of(work, struct ml_lib_test_dev_answer, work);
+
+	/* the late answers are counted by ML library */
+	ml_model_submit_agent_recommendation(answer->agent, &answer->hint);
+	kfree(answer);
+}
+
+/*
+ * The emulated agent answers asynchronously like user-space one.
+ * The method is called by ml_model_decide() and it cannot sleep.
+ */
+static
+int ml_lib_test_dev_agent_send(struct ml_lib_agent *agent,
+			       struct ml_lib_user_space_request *request)
+{
+	struct ml_lib_test_dev_answer *answer;
+	s64 value;
+	u32 noise;
+
+	if (!request->features ||
+	    request->nr_features != ML_LIB_TEST_DEV_FEATURES)
+		return -EOPNOTSUPP;
+
+	answer = kzalloc(sizeof(*answer), GFP_NOWAIT | __GFP_NOWARN);
+	if (!answer)
+		return -ENOMEM;
+
+	value = ml_lib_test_dev_reference(request->features,
+					  request->nr_features);
+	if (agent->flags & ML_LIB_AGENT_SHADOW) {
+		noise = get_random_u32_below(2 * ML_MODEL_1_DEFAULT_ERROR + 1);
+		value += (s64)noise - ML_MODEL_1_DEFAULT_ERROR;
+	}
+
+	INIT_WORK(&answer->work, ml_lib_test_dev_agent_answer);
+	answer->agent = agent;
+	answer->hint.request_id = request->id;
+	answer->hint.value = value;
+
+	queue_work(ml_lib_test_dev_agent_wq, &answer->work);
+
+	return 0;
+}
+
+static int ml_lib_test_dev_attach_agents(struct ml_lib_test_dev_data *data)
+{
+	struct ml_lib_agent *agent;
+	int ret = 0;
+	int i;
+
+	mutex_lock(&data->lock);
+
+	if (data->agents_attached)
+		goto finish_attach;
+
+	for (i = 0; i < ML_LIB_TEST_DEV_AGENTS; i++) {
+		agent = &data->agents[i];
+
+		agent->name = ml_lib_test_dev_agent_names[i];
+		agent->flags = i < ML_LIB_TEST_DEV_HEDGED_AGENTS ?
+					0 : ML_LIB_AGENT_SHADOW;
+		agent->ops = &ml_lib_test_dev_agent_ops;
+		agent->private = data;
+
+		ret = ml_model_attach_agent(data->ml_model1, agent);
+		if (ret) {
+			pr_err("ml_lib_test_dev: Failed to attach agent: err %d\n",
+			       ret);
+			goto fail_attach;
+		}
+	}
+
+	data->agents_attached = true;
+
+finish_attach:
+	mutex_unlock(&data->lock);
+	return 0;
+
+fail_attach:
+	while (--i >= 0)
+		ml_model_detach_agent(&data->agents[i]);
+	flush_workqueue(ml_lib_test_dev_agent_wq);
+	mutex_unlock(&data->lock);
+	return ret;
+}
+
+static void ml_lib_test_dev_detach_agents(struct ml_lib_test_dev_data *data)
+{
+	int i;
+
+	mutex_lock(&data->lock);
+
+	if (data->agents_attached) {
+		for (i = 0; i < ML_LIB_TEST_DEV_AGENTS; i++)
+			ml_model_detach_agent(&data->agents[i]);
+
+		/* the pending answers of detached agents are rejected */
+		flush_workqueue(ml_lib_test_dev_agent_wq);
+		data->agents_attached = false;
+	}
+
+	mutex_unlock(&data->lock);
+}
+
+static void ml_lib_test_dev_record(struct ml_lib_test_dev_data *data,
+				   u32 operation, size_t bytes)
+{
+	struct ml_lib_test_dev_sample sample = {
+		.timestamp = ktime_get_ns(),
+		.operation = operation,
+		.bytes = bytes,
+	};
+
+	ml_lib_record_sample(data->ml_model1, &sample);
+}
+
 /* File operations */
 static int ml_lib_test_dev_open(struct inode *inode, struct file *file)
 {
@@ -114,80 +529,246 @@ static ssize_t ml_lib_test_dev_read(struct file *file, char __user *buf,
 				    size_t count, loff_t *ppos)
 {
 	struct ml_lib_test_dev_data *data = file->private_data;
-	size_t to_read;
-	int ret;
-
-	mutex_lock(&data->lock);
-
-	if (*ppos >= data->dataset_size) {
-		mutex_unlock(&data->lock);
-		return 0;
-	}
+	ssize_t to_read;
 
-	to_read = min(count, data->dataset_size - (size_t)*ppos);
+	/* stream the oldest dataset from the ring of ML model */
+	to_read = ml_model_read_dataset(data->ml_model1, buf, count, ppos);
+	if (to_read < 0)
+		return to_read;
 
-	ret = copy_to_user(buf, data->dataset_buf + *ppos, to_read);
-	if (ret) {
-		mutex_unlock(&data->lock);
-		return -EFAULT;
-	}
-
-	*ppos += to_read;
+	mutex_lock(&data->lock);
 	data->read_count++;
-
 	mutex_unlock(&data->lock);
 
-	pr_info("ml_lib_test_dev: Read %zu bytes\n", to_read);
+	ml_lib_test_dev_record(data, ML_LIB_TEST_DEV_READ_OP, to_read);
+
+	pr_info("ml_lib_test_dev: Read %zd bytes\n", to_read);
 
 	return to_read;
 }
 
+/*
+ * The written buffer is an array of recommendation records. Every
+ * record is submitted into the recommendations ring of ML model
+ * and it is applied by the batch of ML model's work.
+ */
 static ssize_t ml_lib_test_dev_write(struct file *file, const char __user *buf,
 				     size_t count, loff_t *ppos)
 {
 	struct ml_lib_test_dev_data *data = file->private_data;
+	struct ml_lib_user_space_recommendation hint;
+	size_t nr_records = count / sizeof(hint);
 	size_t to_write;
-	int ret;
+	size_t i;
+	int ret = 0;
+
+	if (!nr_records)
+		return -EINVAL;
+
+	for (i = 0; i < nr_records; i++) {
+		if (copy_from_user(&hint, buf + i * sizeof(hint),
+				   sizeof(hint))) {
+			ret = -EFAULT;
+			break;
+		}
+
+		ret = ml_model_submit_recommendation(data->ml_model1, &hint);
+		if (ret)
+			break;
+	}
+
+	/* report the number of submitted records, if any */
+	if (i == 0)
+		return ret;
+
+	to_write = i * sizeof(hint);
 
 	mutex_lock(&data->lock);
+	data->write_count++;
+	mutex_unlock(&data->lock);
 
-	if (*ppos >= data->recommendations_buf_size) {
-		mutex_unlock(&data->lock);
-		return -ENOSPC;
-	}
+	ml_lib_test_dev_record(data, ML_LIB_TEST_DEV_WRITE_OP, to_write);
 
-	to_write = min(count, data->recommendations_buf_size - (size_t)*ppos);
+	pr_info("ml_lib_test_dev: Wrote %zu bytes\n", to_write);
 
-	ret = copy_from_user(data->recommendations_buf + *ppos, buf, to_write);
-	if (ret) {
-		mutex_unlock(&data->lock);
+	return to_write;
+}
+
+static int ml_lib_test_dev_load_trees(struct ml_lib_test_dev_data *data,
+				      unsigned long arg)
+{
+	struct ml_lib_test_dev_image image;
+	void *buf;
+	int ret;
+
+	if (copy_from_user(&image, (void __user *)arg, sizeof(image)))
 		return -EFAULT;
+
+	if (!image.size || image.size > ML_LIB_TEST_DEV_IMAGE_SIZE_MAX)
+		return -EINVAL;
+
+	buf = vmemdup_user(u64_to_user_ptr(image.addr), image.size);
+	if (IS_ERR(buf))
+		return PTR_ERR(buf);
+
+	ret = ml_model_load_tree_ensemble(data->ml_model1, buf, image.size);
+	kvfree(buf);
+
+	return ret;
+}
+
+static int ml_lib_test_dev_decide(struct ml_lib_test_dev_data *data,
+				  unsigned long arg)
+{
+	struct ml_lib_user_space_recommendation hint = {0};
+	struct ml_lib_user_space_request request = {0};
+	struct ml_lib_test_dev_decision decision;
+	int ret;
+
+	if (copy_from_user(&decision, (void __user *)arg, sizeof(decision)))
+		return -EFAULT;
+
+	request.nr_features = ML_LIB_TEST_DEV_FEATURES;
+	request.features = decision.features;
+
+	/* the repeated features are answered by the cache */
+	ret = ml_model_decide(data->ml_model1, &hint, &request,
+			      ML_MODEL_1_DECISION_BUDGET_NS);
+	if (ret < 0)
+		return ret;
+
+	/* the test device has no default algorithm */
+	if (ret == ML_LIB_DECISION_DEFAULT)
+		return -EOPNOTSUPP;
+
+	decision.value = hint.value;
+
+	if (copy_to_user((void __user *)arg, &decision, sizeof(decision)))
+		return -EFAULT;
+
+	return 0;
+}
+
+static void *
+ml_lib_test_dev_build_mlp(const struct ml_lib_test_dev_mlp_bench *bench,
+			  size_t *size)
+{
+	struct ml_lib_mlp_header *hdr;
+	struct ml_lib_mlp_layer_desc *desc;
+	size_t hidden_weights = (size_t)bench->hidden_size * bench->input_size;
+	size_t output_weights = (size_t)bench->output_size * bench->hidden_size;
+	u8 *params;
+	void *image;
+
+	*size = sizeof(*hdr) + 2 * sizeof(*desc) +
+		bench->hidden_size * sizeof(s32) + hidden_weights +
+		bench->output_size * sizeof(s32) + output_weights;
+
+	image = kvzalloc(*size, GFP_KERNEL);
+	if (!image)
+		return NULL;
+
+	hdr = image;
+	hdr->magic = ML_LIB_MLP_MAGIC;
+	hdr->version = ML_LIB_MLP_VERSION;
+	hdr->nr_layers = 2;
+
+	desc = (struct ml_lib_mlp_layer_desc *)(hdr + 1);
+	desc[0].in_size = bench->input_size;
+	desc[0].out_size = bench->hidden_size;
+	desc[0].activation = ML_LIB_MLP_ACTIVATION_RELU;
+	desc[0].shift = 7;
+	desc[1].in_size = bench->hidden_size;
+	desc[1].out_size = bench->output_size;
+	desc[1].activation = ML_LIB_MLP_ACTIVATION_NONE;
+
+	/* zero biases and random weights */
+	params = (u8 *)&desc[2];
+	params += bench->hidden_size * sizeof(s32);
+	get_random_bytes(params, hidden_weights);
+	params += hidden_weights;
+	params += bench->output_size * sizeof(s32);
+	get_random_bytes(params, output_weights);
+
+	return image;
+}
+
+static int ml_lib_test_dev_bench_mlp(struct ml_lib_test_dev_data *data,
+				     unsigned long arg)
+{
+	struct ml_lib_test_dev_mlp_bench bench;
+	struct ml_lib_mlp *mlp;
+	s8 *input = NULL;
+	s32 *output = NULL;
+	void *image;
+	size_t size;
+	u64 start;
+	u32 i;
+	int ret;
+
+	if (copy_from_user(&bench, (void __user *)arg, sizeof(bench)))
+		return -EFAULT;
+
+	if (!bench.input_size || bench.input_size > ML_LIB_MLP_WIDTH_MAX ||
+	    !bench.hidden_size || bench.hidden_size > ML_LIB_MLP_WIDTH_MAX ||
+	    !bench.output_size || bench.output_size > ML_LIB_MLP_WIDTH_MAX ||
+	    !bench.iterations ||
+	    bench.iterations > ML_LIB_TEST_DEV_BENCH_ITERATIONS_MAX)
+		return -EINVAL;
+
+	image = ml_lib_test_dev_build_mlp(&bench, &size);
+	if (!image)
+		return -ENOMEM;
+
+	/* the loaded model and model_version of ml_model1 are intact */
+	mlp = allocate_mlp(image, size);
+	kvfree(image);
+	if (IS_ERR(mlp))
+		return PTR_ERR(mlp);
+
+	input = kmalloc(bench.input_size, GFP_KERNEL);
+	output = kmalloc_array(bench.output_size, sizeof(s32), GFP_KERNEL);
+	if (!input || !output) {
+		ret = -ENOMEM;
+		goto finish_bench;
 	}
 
-	*ppos += to_write;
-	if (*ppos > data->recommendations_size)
-		data->recommendations_size = *ppos;
+	get_random_bytes(input, bench.input_size);
 
-	data->write_count++;
+	start = ktime_get_ns();
+	for (i = 0; i < bench.iterations; i++) {
+		ret = ml_lib_mlp_run_inference(mlp, input, bench.input_size,
+					       output, bench.output_size);
+		if (ret)
+			goto finish_bench;
 
-	mutex_unlock(&data->lock);
+		cond_resched();
+	}
+	bench.nsec_per_inference = div_u64(ktime_get_ns() - start,
+					   bench.iterations);
 
-	pr_info("ml_lib_test_dev: Wrote %zu bytes\n", to_write);
+	if (copy_to_user((void __user *)arg, &bench, sizeof(bench)))
+		ret = -EFAULT;
 
-	return to_write;
+finish_bench:
+	free_mlp(mlp);
+	kfree(output);
+	kfree(input);
+
+	return ret;
 }
 
 static long ml_lib_test_dev_ioctl(struct file *file, unsigned int cmd,
 				  unsigned long arg)
 {
 	struct ml_lib_test_dev_data *data = file->private_data;
+	int attach;
 	int size;
 
 	switch (cmd) {
 	case ML_LIB_TEST_DEV_IOCRESET:
+		ml_model_reset_stream(data->ml_model1);
 		mutex_lock(&data->lock);
-		memset(data->dataset_buf,
-			0, data->dataset_buf_size);
 		data->dataset_size = 0;
 		memset(data->recommendations_buf,
 			0, data->recommendations_buf_size);
@@ -215,6 +796,24 @@ static long ml_lib_test_dev_ioctl(struct file *file, unsigned int cmd,
 		pr_info("ml_lib_test_dev: Data size set to %d via IOCTL\n", size);
 		break;
 
+	case ML_LIB_TEST_DEV_IOCLOADTREES:
+		return ml_lib_test_dev_load_trees(data, arg);
+
+	case ML_LIB_TEST_DEV_IOCDECIDE:
+		return ml_lib_test_dev_decide(data, arg);
+
+	case ML_LIB_TEST_DEV_IOCBENCHMLP:
+		return ml_lib_test_dev_bench_mlp(data, arg);
+
+	case ML_LIB_TEST_DEV_IOCAGENTS:
+		if (copy_from_user(&attach, (int __user *)arg, sizeof(attach)))
+			return -EFAULT;
+		if (!attach) {
+			ml_lib_test_dev_detach_agents(data);
+			break;
+		}
+		return ml_lib_test_dev_attach_agents(data);
+
 	default:
 		return -ENOTTY;
 	}
@@ -222,6 +821,31 @@ static long ml_lib_test_dev_ioctl(struct file *file, unsigned int cmd,
 	return 0;
 }
 
+static int ml_lib_test_dev_mmap(struct file *file, struct vm_area_struct *vma)
+{
+	struct ml_lib_test_dev_data *data = file->private_data;
+
+	return ml_model_dataset_ring_mmap(data->ml_model1, vma);
+}
+
+static __poll_t ml_lib_test_dev_poll(struct file *file,
+				     struct poll_table_struct *wait)
+{
+	struct ml_lib_test_dev_data *data = file->private_data;
+
+	/* recommendations can be written at any time */
+	return ml_model_poll(data->ml_model1, file, wait) |
+		EPOLLOUT | EPOLLWRNORM;
+}
+
+static int ml_lib_test_dev_uring_cmd(struct io_uring_cmd *ioucmd,
+				     unsigned int issue_flags)
+{
+	struct ml_lib_test_dev_data *data = ioucmd->file->private_data;
+
+	return ml_model_uring_cmd(data->ml_model1, ioucmd, issue_flags);
+}
+
 static const struct file_operations ml_lib_test_dev_fops = {
 	.owner = THIS_MODULE,
 	.open = ml_lib_test_dev_open,
@@ -229,6 +853,9 @@ static const struct file_operations ml_lib_test_dev_fops = {
 	.read = ml_lib_test_dev_read,
 	.write = ml_lib_test_dev_write,
 	.unlocked_ioctl = ml_lib_test_dev_ioctl,
+	.mmap = ml_lib_test_dev_mmap,
+	.poll = ml_lib_test_dev_poll,
+	.uring_cmd = ml_lib_test_dev_uring_cmd,
 	.llseek = default_llseek,
 };
 
@@ -238,7 +865,7 @@ static ssize_t buffer_size_show(struct device *dev,
 {
 	struct ml_lib_test_dev_data *data = dev_get_drvdata(dev);
 
-	return sprintf(buf, "%zu\n", data->dataset_buf_size);
+	return sprintf(buf, "%zu\n", data->portion_size);
 }
 
 static ssize_t data_size_show(struct device *dev,
@@ -267,9 +894,12 @@ static ssize_t stats_show(struct device *dev,
 {
 	struct ml_lib_test_dev_data *data = dev_get_drvdata(dev);
 
-	return sprintf(buf, "Opens: %lu\nReads: %lu\nWrites: %lu\n",
+	return sprintf(buf, "Opens: %lu\nReads: %lu\nWrites: %lu\n"
+		       "Recommendations: %lld\nFeedback: %lld\n",
 		       data->access_count, data->read_count,
-		       data->write_count);
+		       data->write_count,
+		       atomic64_read(&data->recommendation_count),
+		       atomic64_read(&data->feedback_count));
 }
 
 static DEVICE_ATTR_RO(buffer_size);
@@ -297,7 +927,7 @@ static int ml_lib_test_dev_proc_show(struct seq_file *m, void *v)
 	seq_printf(m, "ML Library Testing Device Driver Information\n");
 	seq_printf(m, "=================================\n");
 	seq_printf(m, "Device name:     %s\n", DEVICE_NAME);
-	seq_printf(m, "Buffer size:     %zu bytes\n", data->dataset_buf_size);
+	seq_printf(m, "Buffer size:     %zu bytes\n", data->portion_size);
 	seq_printf(m, "Data size:       %zu bytes\n", data->dataset_size);
 	seq_printf(m, "Access count:    %lu\n", data->access_count);
 	seq_printf(m, "Read count:      %lu\n", data->read_count);
@@ -318,10 +948,67 @@ static const struct proc_ops ml_lib_test_dev_proc_ops = {
 	.proc_release = single_release,
 };
 
+/*
+ * The emulated stream is treated as records of four features:
+ * (1) latency - normalized into int16;
+ * (2) size - quantized into int8;
+ * (3) offset - log2 bucket;
+ * (4) inode - hashed into 4096 dimensions.
+ */
+enum {
+	ML_MODEL_1_LATENCY_FEATURE,
+	ML_MODEL_1_SIZE_FEATURE,
+	ML_MODEL_1_OFFSET_FEATURE,
+	ML_MODEL_1_INODE_FEATURE,
+	ML_MODEL_1_FEATURES_NUMBER
+};
+
+static int ml_lib_test_dev_setup_preprocessing(struct ml_lib_model *ml_model)
+{
+	struct ml_lib_preprocess_config *config;
+	struct ml_lib_feature_desc *desc;
+	int ret;
+
+	config = allocate_preprocess_config(ML_MODEL_1_FEATURES_NUMBER,
+					    GFP_KERNEL);
+	if (IS_ERR(config))
+		return PTR_ERR(config);
+
+	desc = &config->features[ML_MODEL_1_LATENCY_FEATURE];
+	desc->transform = ML_LIB_FEATURE_NORMALIZE;
+	desc->width = sizeof(s16);
+	desc->scale = 1;
+	desc->shift = 48;
+
+	desc = &config->features[ML_MODEL_1_SIZE_FEATURE];
+	desc->transform = ML_LIB_FEATURE_NORMALIZE;
+	desc->width = sizeof(s8);
+	desc->scale = 1;
+	desc->shift = 56;
+
+	desc = &config->features[ML_MODEL_1_OFFSET_FEATURE];
+	desc->transform = ML_LIB_FEATURE_LOG2_BUCKET;
+	desc->width = sizeof(u8);
+	desc->nr_buckets = 64;
+
+	desc = &config->features[ML_MODEL_1_INODE_FEATURE];
+	desc->transform = ML_LIB_FEATURE_HASH;
+	desc->width = sizeof(u16);
+	desc->nr_buckets = 4096;
+	desc->seed = 0x9e37;
+
+	ret = ml_model_set_preprocess_config(ml_model, config);
+	if (ret)
+		free_preprocess_config(config);
+
+	return ret;
+}
+
 /* Module initialization */
 static int __init ml_lib_test_dev_init(void)
 {
 	struct ml_lib_model_options *options;
+	size_t samples_room;
 	int ret;
 
 	pr_info("ml_lib_test_dev: Initializing driver\n");
@@ -331,33 +1018,40 @@ static int __init ml_lib_test_dev_init(void)
 	if (!dev_data)
 		return -ENOMEM;
 
-	/* Allocate dataset buffer */
-	dev_data->dataset_buf = kzalloc(BUFFER_SIZE, GFP_KERNEL);
-	if (!dev_data->dataset_buf) {
-		ret = -ENOMEM;
+	if (!ml_model1_portion_size || !recommendations_capacity) {
+		ret = -EINVAL;
 		goto err_free_data;
 	}
 
-	dev_data->dataset_buf_size = BUFFER_SIZE;
+	/* Datasets are stored in the ring of ML model */
+	dev_data->portion_size = ml_model1_portion_size;
 	dev_data->dataset_size = 0;
 
 	/* Allocate recomendations buffer */
-	dev_data->recommendations_buf = kzalloc(BUFFER_SIZE, GFP_KERNEL);
+	dev_data->recommendations_buf = kvzalloc(recommendations_capacity,
+						 GFP_KERNEL);
 	if (!dev_data->recommendations_buf) {
 		ret = -ENOMEM;
-		goto err_free_dataset_buffer;
+		goto err_free_data;
 	}
 
-	dev_data->recommendations_buf_size = BUFFER_SIZE;
+	dev_data->recommendations_buf_size = recommendations_capacity;
 	dev_data->recommendations_size = 0;
 
 	mutex_init(&dev_data->lock);
 
+	ml_lib_test_dev_agent_wq = alloc_workqueue("ml_lib_test_agent",
+						   WQ_UNBOUND, 0);
+	if (!ml_lib_test_dev_agent_wq) {
+		ret = -ENOMEM;
+		goto err_free_recommendations_buffer;
+	}
+
 	/* Allocate device number */
 	ret = alloc_chrdev_region(&dev_number, 0, 1, DEVICE_NAME);
 	if (ret < 0) {
 		pr_err("ml_lib_test_dev: Failed to allocate device number\n");
-		goto err_free_recommendations_buffer;
+		goto err_destroy_agent_wq;
 	}
 
 	pr_info("ml_lib_test_dev: Device number allocated: %d:%d\n",
@@ -428,9 +1122,17 @@ static int __init ml_lib_test_dev_init(void)
 	}
 
 	dev_data->ml_model1->parent->private = dev_data;
-	dev_data->ml_model1->model_ops = NULL;
+	dev_data->ml_model1->model_ops = &ml_lib_test_dev_model_ops;
 	dev_data->ml_model1->dataset_ops = &ml_lib_test_dev_dataset_ops;
 
+	ret = ml_model_create_sample_buffers(dev_data->ml_model1,
+				sizeof(struct ml_lib_test_dev_sample),
+				ML_MODEL_1_SAMPLES_PER_CPU);
+	if (ret < 0) {
+		pr_err("ml_lib_test_dev: Failed to create sample buffers\n");
+		goto err_ml_model_destroy;
+	}
+
 	options = allocate_ml_model_options(sizeof(struct ml_lib_model_options),
 					    GFP_KERNEL);
 	if (IS_ERR(options)) {
@@ -443,12 +1145,36 @@ static int __init ml_lib_test_dev_init(void)
 		goto err_ml_model_destroy;
 	}
 
+	/* the rest of the slot is the room of drained samples */
+	samples_room = min_t(size_t, ml_model1_portion_size / 2,
+			     (size_t)nr_cpu_ids * ML_MODEL_1_SAMPLES_PER_CPU *
+				sizeof(struct ml_lib_test_dev_sample));
+	options->stream_chunk_size = ml_model1_portion_size - samples_room;
+	options->compression = compression;
+	options->ring_slots = ML_MODEL_1_RING_SLOTS;
+	options->ring_portion_size = ml_model1_portion_size;
+	options->min_sleep_timeout = ML_MODEL_1_MIN_SLEEP_TIMEOUT;
+	options->max_sleep_timeout = ML_MODEL_1_MAX_SLEEP_TIMEOUT;
+	options->hint_cache_entries = ML_MODEL_1_HINT_CACHE_ENTRIES;
+	options->hint_cache_ttl = ML_MODEL_1_HINT_CACHE_TTL;
+	options->governor_interval = governor_interval;
+	options->worker_class = worker_class;
+	options->worker_budget = worker_budget;
+
 	ret = ml_model_init(dev_data->ml_model1, options);
 	if (ret < 0) {
 		pr_err("ml_lib_test_dev: Failed to init ML model\n");
 		goto err_ml_model_options_free;
 	}
 
+	if (preprocess) {
+		ret = ml_lib_test_dev_setup_preprocessing(dev_data->ml_model1);
+		if (ret < 0) {
+			pr_err("ml_lib_test_dev: Failed to setup preprocessing\n");
+			goto err_ml_model_destroy;
+		}
+	}
+
 	pr_info("ml_lib_test_dev: Driver initialized successfully\n");
 	pr_info("ml_lib_test_dev: Device created at /dev/%s\n",
 		DEVICE_NAME);
@@ -476,10 +1202,10 @@ err_class_destroy:
 	class_destroy(ml_lib_test_dev_class);
 err_unregister_chrdev:
 	unregister_chrdev_region(dev_number, 1);
+err_destroy_agent_wq:
+	destroy_workqueue(ml_lib_test_dev_agent_wq);
 err_free_recommendations_buffer:
-	kfree(dev_data->recommendations_buf);
-err_free_dataset_buffer:
-	kfree(dev_data->dataset_buf);
+	kvfree(dev_data->recommendations_buf);
 err_free_data:
 	kfree(dev_data);
 	return ret;
@@ -494,6 +1220,9 @@ static void __exit ml_lib_test_dev_exit(void)
 	ml_model_destroy(dev_data->ml_model1);
 	free_ml_model(dev_data->ml_model1);
 
+	/* The answers of detached agents are finished */
+	destroy_workqueue(ml_lib_test_dev_agent_wq);
+
 	/* Remove procfs entry */
 	proc_remove(proc_entry);
 
@@ -514,8 +1243,7 @@ static void __exit ml_lib_test_dev_exit(void)
 	unregister_chrdev_region(dev_number, 1);
 
 	/* Free buffers */
-	kfree(dev_data->recommendations_buf);
-	kfree(dev_data->dataset_buf);
+	kvfree(dev_data->recommendations_buf);
 	kfree(dev_data);
 
 	pr_info("ml_lib_test_dev: Driver removed successfully\n");
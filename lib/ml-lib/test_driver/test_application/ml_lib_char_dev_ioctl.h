@@ -11,11 +11,156 @@
 #define _ML_LIB_TEST_DEV_IOCTL_H
 
 #include <linux/ioctl.h>
+#include <linux/types.h>
 
 /* IOCTL commands */
 #define ML_LIB_TEST_DEV_IOC_MAGIC   'M'
 #define ML_LIB_TEST_DEV_IOCRESET    _IO(ML_LIB_TEST_DEV_IOC_MAGIC, 0)
 #define ML_LIB_TEST_DEV_IOCGETSIZE  _IOR(ML_LIB_TEST_DEV_IOC_MAGIC, 1, int)
 #define ML_LIB_TEST_DEV_IOCSETSIZE  _IOW(ML_LIB_TEST_DEV_IOC_MAGIC, 2, int)
+#define ML_LIB_TEST_DEV_IOCLOADTREES \
+	_IOW(ML_LIB_TEST_DEV_IOC_MAGIC, 3, struct ml_lib_test_dev_image)
+#define ML_LIB_TEST_DEV_IOCDECIDE \
+	_IOWR(ML_LIB_TEST_DEV_IOC_MAGIC, 4, struct ml_lib_test_dev_decision)
+#define ML_LIB_TEST_DEV_IOCBENCHMLP \
+	_IOWR(ML_LIB_TEST_DEV_IOC_MAGIC, 5, struct ml_lib_test_dev_mlp_bench)
+#define ML_LIB_TEST_DEV_IOCAGENTS   _IOW(ML_LIB_TEST_DEV_IOC_MAGIC, 6, int)
+
+#define ML_LIB_TEST_DEV_FEATURES	(4)
+
+/* Image of tree ensemble in user-space memory */
+struct ml_lib_test_dev_image {
+	__u64 addr;
+	__u64 size;
+};
+
+/* Decision that is evaluated by in-kernel tree ensemble */
+struct ml_lib_test_dev_decision {
+	__s64 features[ML_LIB_TEST_DEV_FEATURES];
+	__s64 value;
+};
+
+/* Microbenchmark of two-layer quantized MLP with random weights */
+struct ml_lib_test_dev_mlp_bench {
+	__u32 input_size;
+	__u32 hidden_size;
+	__u32 output_size;
+	__u32 iterations;
+	__u64 nsec_per_inference;
+};
+
+/*
+ * Tree ensemble image
+ * (mirrors in-kernel evaluator of ML library)
+ */
+#define ML_LIB_TREE_ENSEMBLE_MAGIC	0x4d4c5445	/* MLTE */
+#define ML_LIB_TREE_ENSEMBLE_VERSION	(1)
+#define ML_LIB_TREE_LEAF		0xFFFF
+
+struct ml_lib_tree_ensemble_header {
+	__u32 magic;
+	__u32 version;
+	__u32 nr_features;
+	__u32 nr_trees;
+	__u32 nr_nodes;
+	__u32 reserved;
+	__s64 base_score;
+};
+
+struct ml_lib_tree_node {
+	__s64 value;
+	__u16 feature;
+	__u16 reserved;
+	__u32 right;
+};
+
+/*
+ * Dataset ring layout of mmap() on /dev/mllibdev
+ * (mirrors struct ml_lib_dataset_ring_ctrl and
+ *  struct ml_lib_dataset_slot of ML library)
+ */
+struct ml_lib_dataset_ring_ctrl {
+	__u32 nr_slots;
+	__u32 slot_size;
+	__u32 data_offset;
+	__u32 reserved;
+	__u64 head;
+	__u64 tail;
+};
+
+struct ml_lib_dataset_slot {
+	__u64 seq;
+	__u64 portion_offset;
+	__u32 portion_size;
+	__u32 type;
+	__u32 compression;
+	__u32 raw_size;
+};
+
+/* Compression algorithms of slot's payload */
+enum {
+	ML_LIB_NO_COMPRESSION,
+	ML_LIB_LZ4_COMPRESSION,
+	ML_LIB_ZSTD_COMPRESSION,
+};
+
+/*
+ * io_uring commands of /dev/mllibdev
+ * (mirrors io_uring interface of ML library)
+ */
+enum {
+	ML_LIB_URING_CMD_FETCH_DATASET = 1,
+	ML_LIB_URING_CMD_APPLY_RECOMMENDATION,
+	ML_LIB_URING_CMD_SEND_FEEDBACK,
+};
+
+#define ML_LIB_URING_FETCH_PREPARE	(1 << 0)
+#define ML_LIB_URING_FETCH_KEEP		(1 << 1)
+#define ML_LIB_URING_BATCH_MAX		(4096)
+
+struct ml_lib_uring_cmd {
+	__u64 addr;
+	__u32 len;
+	__u32 flags;
+};
+
+struct ml_lib_user_space_recommendation {
+	__u32 type;
+	__u32 flags;
+	__u64 request_id;
+	__s64 value;
+	__u8 payload[40];
+};
+
+struct ml_lib_backpropagation_feedback {
+	__u32 type;
+	__u32 flags;
+	__u64 request_id;
+	__s64 error;
+	__u64 reserved;
+};
+
+/*
+ * Versioned model blob of /sys/.../ml_model1/model
+ * (mirrors model blob of ML library)
+ */
+#define ML_LIB_MODEL_BLOB_MAGIC		0x4d4c4d42	/* MLMB */
+#define ML_LIB_MODEL_BLOB_FORMAT	(1)
+
+enum {
+	ML_LIB_MODEL_BLOB_UNKNOWN,
+	ML_LIB_MODEL_BLOB_TREE_ENSEMBLE,
+	ML_LIB_MODEL_BLOB_MLP,
+};
+
+struct ml_lib_model_blob_header {
+	__u32 magic;
+	__u32 format;
+	__u32 type;
+	__u32 reserved;
+	__u64 version;
+	__u32 payload_size;
+	__u32 checksum;
+};
 
 #endif /* _ML_LIB_TEST_DEV_IOCTL_H */
@@ -7,7 +7,13 @@
  * Copyright (C) 2025-2026 Viacheslav Dubeyko <slava@dubeyko.com>
  *
  * Compile with: gcc -o test_ml_lib_char_dev test_ml_lib_char_dev.c
+ *               (add -DML_LIB_TEST_WITH_LZ4 -llz4 and/or
+ *                -DML_LIB_TEST_WITH_ZSTD -lzstd to decompress
+ *                the compressed datasets;
+ *                add -DML_LIB_TEST_WITH_URING -luring
+ *                to test io_uring commands)
  * Run with:     sudo ./test_ml_lib_char_dev
+ * Benchmark:    sudo ./test_ml_lib_char_dev bench [seconds]
  */
 
 #include <stdio.h>
@@ -16,13 +22,45 @@
 #include <fcntl.h>
 #include <unistd.h>
 #include <sys/ioctl.h>
+#include <sys/mman.h>
+#include <poll.h>
 #include <errno.h>
+#include <time.h>
+
+#ifdef ML_LIB_TEST_WITH_LZ4
+#include <lz4.h>
+#endif
+#ifdef ML_LIB_TEST_WITH_ZSTD
+#include <zstd.h>
+#endif
+#ifdef ML_LIB_TEST_WITH_URING
+#include <liburing.h>
+#endif
 
 #include "ml_lib_char_dev_ioctl.h"
 
 #define DEVICE_PATH "/dev/mllibdev"
 #define SYSFS_BASE "/sys/class/ml_lib_test/mllibdev"
 #define PROC_PATH "/proc/mllibdev"
+#define ML_MODEL_CONTROL SYSFS_BASE "/ml_model1/control"
+#define ML_MODEL_MODE SYSFS_BASE "/ml_model1/mode"
+#define ML_MODEL_BLOB SYSFS_BASE "/ml_model1/model"
+#define ML_MODEL_AGENTS SYSFS_BASE "/ml_model1/agents"
+#define BENCH_DEFAULT_SECONDS 5
+#define READ_CHUNK_SIZE (64 * 1024)
+#define POLL_TIMEOUT_MS 1000
+#define URING_QUEUE_DEPTH 64
+#define WRITE_RECORDS 16
+#define URING_APPLY_COMMANDS 16
+#define URING_RECORDS_PER_COMMAND 1024
+/* the whole dataset is fetched by one command (default portion size) */
+#define URING_FETCH_SIZE (1024 * 1024)
+#define MLP_BENCH_MACS_BUDGET (256ULL * 1024 * 1024)
+#define MLP_BENCH_ITERATIONS_MIN 1000
+#define MLP_BENCH_ITERATIONS_MAX 1000000
+#define AGENT_DECISIONS 64
+/* the shadow agent's answers are scored after the decisions */
+#define AGENT_SETTLE_US 10000
 
 static void print_separator(const char *title)
 {
@@ -79,42 +117,140 @@ static void show_proc_info(void)
 	fclose(fp);
 }
 
+static int write_model_attr(const char *path, const char *value)
+{
+	FILE *fp;
+
+	fp = fopen(path, "w");
+	if (!fp) {
+		perror("Failed to open ML model attribute");
+		return -1;
+	}
+
+	if (fputs(value, fp) < 0) {
+		perror("Failed to write ML model attribute");
+		fclose(fp);
+		return -1;
+	}
+
+	if (fclose(fp)) {
+		perror("Failed to write ML model attribute");
+		return -1;
+	}
+
+	return 0;
+}
+
+static int write_control(const char *command)
+{
+	return write_model_attr(ML_MODEL_CONTROL, command);
+}
+
+/*
+ * Submit the array of recommendation records by one write() call.
+ */
 static void test_write(int fd)
 {
-	const char *test_data = "Hello from userspace! This is a test of the mllibdev driver.";
+	struct ml_lib_user_space_recommendation hints[WRITE_RECORDS];
 	ssize_t ret;
+	int i;
 
 	print_separator("Write Test");
 
-	ret = write(fd, test_data, strlen(test_data));
+	memset(hints, 0, sizeof(hints));
+	for (i = 0; i < WRITE_RECORDS; i++) {
+		hints[i].request_id = i;
+		hints[i].value = i;
+	}
+
+	ret = write(fd, hints, sizeof(hints));
 	if (ret < 0) {
 		perror("Write failed");
 		return;
 	}
 
-	printf("Successfully wrote %zd bytes\n", ret);
-	printf("Data: \"%s\"\n", test_data);
+	printf("Successfully submitted %zd recommendations (%zd bytes)\n",
+		ret / (ssize_t)sizeof(hints[0]), ret);
 }
 
+/*
+ * Read the whole oldest dataset by chunks of READ_CHUNK_SIZE bytes.
+ */
 static void test_read(int fd)
 {
-	char buffer[256];
+	unsigned char *buffer;
+	unsigned char first_byte = 0;
+	size_t total = 0;
 	ssize_t ret;
 
 	print_separator("Read Test");
 
+	if (write_control("prepare_dataset") < 0)
+		return;
+
+	buffer = malloc(READ_CHUNK_SIZE);
+	if (!buffer) {
+		perror("Failed to allocate read buffer");
+		return;
+	}
+
 	/* Seek to beginning */
 	lseek(fd, 0, SEEK_SET);
 
-	ret = read(fd, buffer, sizeof(buffer) - 1);
-	if (ret < 0) {
+	while ((ret = read(fd, buffer, READ_CHUNK_SIZE)) > 0) {
+		if (total == 0)
+			first_byte = buffer[0];
+		total += ret;
+	}
+
+	if (ret < 0)
 		perror("Read failed");
+	else {
+		printf("Successfully read %zu bytes\n", total);
+		if (total > 0)
+			printf("First byte: 0x%02x\n", first_byte);
+	}
+
+	free(buffer);
+	write_control("discard_dataset");
+}
+
+/*
+ * Wait for the published dataset by poll() instead of spinning.
+ */
+static void test_poll(int fd)
+{
+	struct pollfd pfd = {
+		.fd = fd,
+		.events = POLLIN,
+	};
+	int ret;
+
+	print_separator("Poll Test");
+
+	ret = poll(&pfd, 1, 0);
+	if (ret < 0) {
+		perror("Poll failed");
 		return;
 	}
+	printf("Before prepare: %s\n",
+		(pfd.revents & POLLIN) ? "dataset is ready" : "no dataset");
 
-	buffer[ret] = '\0';
-	printf("Successfully read %zd bytes\n", ret);
-	printf("Data: \"%s\"\n", buffer);
+	if (write_control("prepare_dataset") < 0)
+		return;
+
+	ret = poll(&pfd, 1, POLL_TIMEOUT_MS);
+	if (ret < 0) {
+		perror("Poll failed");
+		return;
+	} else if (ret == 0) {
+		printf("Poll timed out\n");
+		return;
+	}
+	printf("After prepare: %s\n",
+		(pfd.revents & POLLIN) ? "dataset is ready" : "no dataset");
+
+	write_control("discard_dataset");
 }
 
 static void test_ioctl(int fd)
@@ -166,10 +302,703 @@ static void test_ioctl(int fd)
 	printf("Size after reset: %d bytes\n", size);
 }
 
-int main(void)
+/*
+ * Two trees of depth two over four features:
+ *   tree 0: f0 <= 100 ? (f1 <= 10 ? 1 : 2) : 3
+ *   tree 1: f2 <= -5 ? 10 : (f3 <= 1000 ? 20 : 30)
+ */
+#define TREES_NUMBER 2
+#define TREE_NODES_NUMBER 10
+
+struct tree_ensemble_image {
+	struct ml_lib_tree_ensemble_header hdr;
+	__u32 roots[TREES_NUMBER];
+	struct ml_lib_tree_node nodes[TREE_NODES_NUMBER];
+};
+
+static void build_tree_ensemble(struct tree_ensemble_image *image)
+{
+	static const struct ml_lib_tree_node nodes[TREE_NODES_NUMBER] = {
+		/* tree 0 */
+		{ .value = 100, .feature = 0, .right = 4 },
+		{ .value = 10, .feature = 1, .right = 3 },
+		{ .value = 1, .feature = ML_LIB_TREE_LEAF },
+		{ .value = 2, .feature = ML_LIB_TREE_LEAF },
+		{ .value = 3, .feature = ML_LIB_TREE_LEAF },
+		/* tree 1 */
+		{ .value = -5, .feature = 2, .right = 7 },
+		{ .value = 10, .feature = ML_LIB_TREE_LEAF },
+		{ .value = 1000, .feature = 3, .right = 9 },
+		{ .value = 20, .feature = ML_LIB_TREE_LEAF },
+		{ .value = 30, .feature = ML_LIB_TREE_LEAF },
+	};
+
+	memset(image, 0, sizeof(*image));
+	image->hdr.magic = ML_LIB_TREE_ENSEMBLE_MAGIC;
+	image->hdr.version = ML_LIB_TREE_ENSEMBLE_VERSION;
+	image->hdr.nr_features = ML_LIB_TEST_DEV_FEATURES;
+	image->hdr.nr_trees = TREES_NUMBER;
+	image->hdr.nr_nodes = TREE_NODES_NUMBER;
+	image->hdr.base_score = 100;
+	image->roots[0] = 0;
+	image->roots[1] = 5;
+	memcpy(image->nodes, nodes, sizeof(nodes));
+}
+
+static __s64 evaluate_tree_ensemble(const struct tree_ensemble_image *image,
+				    const __s64 *features)
+{
+	__s64 score = image->hdr.base_score;
+	unsigned int i;
+
+	for (i = 0; i < image->hdr.nr_trees; i++) {
+		const struct ml_lib_tree_node *node;
+
+		node = &image->nodes[image->roots[i]];
+		while (node->feature != ML_LIB_TREE_LEAF) {
+			if (features[node->feature] <= node->value)
+				node++;
+			else
+				node = &image->nodes[node->right];
+		}
+
+		score += node->value;
+	}
+
+	return score;
+}
+
+static int test_trees(int fd)
+{
+	static const __s64 vectors[][ML_LIB_TEST_DEV_FEATURES] = {
+		{ 50, 5, -10, 0 },
+		{ 50, 50, 0, 500 },
+		{ 500, 0, 0, 5000 },
+		{ 100, 10, -5, 1000 },
+	};
+	struct tree_ensemble_image image;
+	struct ml_lib_test_dev_image desc;
+	unsigned int pass;
+	unsigned int i;
+	int err = 0;
+
+	print_separator("In-kernel Tree Ensemble Test");
+
+	build_tree_ensemble(&image);
+	desc.addr = (__u64)(unsigned long)&image;
+	desc.size = sizeof(image);
+
+	if (ioctl(fd, ML_LIB_TEST_DEV_IOCLOADTREES, &desc) < 0) {
+		perror("IOCTL LOADTREES failed");
+		return -1;
+	}
+
+	if (write_model_attr(ML_MODEL_MODE, "recommendation"))
+		return -1;
+
+	/* the second pass is served by the recommendations cache */
+	for (pass = 0; pass < 2; pass++) {
+		for (i = 0; i < sizeof(vectors) / sizeof(vectors[0]); i++) {
+			struct ml_lib_test_dev_decision decision;
+			__s64 expected = evaluate_tree_ensemble(&image,
+								vectors[i]);
+
+			memcpy(decision.features, vectors[i],
+			       sizeof(vectors[i]));
+			if (ioctl(fd, ML_LIB_TEST_DEV_IOCDECIDE,
+				  &decision) < 0) {
+				perror("IOCTL DECIDE failed");
+				err = -1;
+				goto finish_trees;
+			}
+
+			printf("Decision %u: value %lld, expected %lld %s\n",
+			       i, (long long)decision.value,
+			       (long long)expected,
+			       decision.value == expected ?
+					"(OK)" : "(MISMATCH)");
+		}
+	}
+
+	read_sysfs_attr("ml_model1/hint_cache");
+
+finish_trees:
+	write_model_attr(ML_MODEL_MODE, "learning");
+
+	return err;
+}
+
+/*
+ * The emulated agents of the test driver answer the sum of features.
+ * The hedged live agents answer exactly and the shadow agent's answers
+ * are only scored (see ml_model1/agents), so every decision has to be
+ * the sum or the default one (the budget has been exhausted).
+ */
+static int test_agents(int fd)
+{
+	struct ml_lib_test_dev_decision decision;
+	unsigned int answered = 0, fallback = 0;
+	char buffer[256];
+	__s64 expected;
+	FILE *fp;
+	int attach;
+	int err = 0;
+	int i, j;
+
+	print_separator("Hedged and Shadow Agents Test");
+
+	attach = 1;
+	if (ioctl(fd, ML_LIB_TEST_DEV_IOCAGENTS, &attach) < 0) {
+		perror("IOCTL AGENTS failed");
+		return -1;
+	}
+
+	if (write_model_attr(ML_MODEL_MODE, "recommendation")) {
+		err = -1;
+		goto finish_agents;
+	}
+
+	for (i = 0; i < AGENT_DECISIONS; i++) {
+		expected = 0;
+		for (j = 0; j < ML_LIB_TEST_DEV_FEATURES; j++) {
+			/* the unique features aren't answered by the cache */
+			decision.features[j] = i * ML_LIB_TEST_DEV_FEATURES + j;
+			expected += decision.features[j];
+		}
+
+		if (ioctl(fd, ML_LIB_TEST_DEV_IOCDECIDE, &decision) < 0) {
+			if (errno == EOPNOTSUPP) {
+				fallback++;
+				continue;
+			}
+
+			perror("IOCTL DECIDE failed");
+			err = -1;
+			goto finish_agents;
+		}
+
+		if (decision.value != expected) {
+			printf("Decision %d: value %lld, expected %lld (MISMATCH)\n",
+			       i, (long long)decision.value,
+			       (long long)expected);
+			err = -1;
+			goto finish_agents;
+		}
+
+		answered++;
+	}
+
+	printf("Decisions: %u answered by agents, %u by default algorithm\n",
+	       answered, fallback);
+
+	usleep(AGENT_SETTLE_US);
+
+	fp = fopen(ML_MODEL_AGENTS, "r");
+	if (!fp) {
+		perror("Failed to open agents attribute");
+		err = -1;
+		goto finish_agents;
+	}
+
+	while (fgets(buffer, sizeof(buffer), fp))
+		printf("  %s", buffer);
+
+	fclose(fp);
+
+finish_agents:
+	write_model_attr(ML_MODEL_MODE, "learning");
+
+	attach = 0;
+	if (ioctl(fd, ML_LIB_TEST_DEV_IOCAGENTS, &attach) < 0) {
+		perror("IOCTL AGENTS failed");
+		err = -1;
+	}
+
+	return err;
+}
+
+/* crc32_le() of kernel: reflected polynomial without final inversion */
+static __u32 crc32_le(__u32 crc, const unsigned char *p, size_t len)
+{
+	int i;
+
+	while (len--) {
+		crc ^= *p++;
+		for (i = 0; i < 8; i++)
+			crc = (crc >> 1) ^ (0xEDB88320 & -(crc & 1));
+	}
+
+	return crc;
+}
+
+/*
+ * Upload the tree ensemble as versioned model blob through
+ * the binary sysfs attribute. The blob is written by small chunks
+ * to check the accumulation of partial writes.
+ */
+static void test_model_blob(int fd)
 {
+	struct {
+		struct ml_lib_model_blob_header hdr;
+		struct tree_ensemble_image image;
+	} blob;
+	struct ml_lib_test_dev_decision decision = {
+		.features = { 50, 5, -10, 0 },
+	};
+	const size_t chunk = 64;
+	size_t offset;
+	int blob_fd;
+
+	print_separator("Model Blob Upload Test");
+
+	build_tree_ensemble(&blob.image);
+	blob.image.hdr.base_score = 1000;
+
+	memset(&blob.hdr, 0, sizeof(blob.hdr));
+	blob.hdr.magic = ML_LIB_MODEL_BLOB_MAGIC;
+	blob.hdr.format = ML_LIB_MODEL_BLOB_FORMAT;
+	blob.hdr.type = ML_LIB_MODEL_BLOB_TREE_ENSEMBLE;
+	blob.hdr.version = (__u64)time(NULL);
+	blob.hdr.payload_size = sizeof(blob.image);
+	blob.hdr.checksum = crc32_le(~0U, (unsigned char *)&blob.image,
+				     sizeof(blob.image));
+
+	blob_fd = open(ML_MODEL_BLOB, O_WRONLY);
+	if (blob_fd < 0) {
+		perror("Failed to open model blob attribute");
+		return;
+	}
+
+	for (offset = 0; offset < sizeof(blob); offset += chunk) {
+		size_t len = sizeof(blob) - offset;
+
+		if (len > chunk)
+			len = chunk;
+
+		if (pwrite(blob_fd, (char *)&blob + offset, len, offset) < 0) {
+			perror("Failed to upload model blob");
+			close(blob_fd);
+			return;
+		}
+	}
+
+	close(blob_fd);
+
+	read_sysfs_attr("ml_model1/model_version");
+	read_sysfs_attr("ml_model1/tree_ensemble");
+
+	if (write_model_attr(ML_MODEL_MODE, "recommendation"))
+		return;
+
+	if (ioctl(fd, ML_LIB_TEST_DEV_IOCDECIDE, &decision) < 0)
+		perror("IOCTL DECIDE failed");
+	else {
+		__s64 expected = evaluate_tree_ensemble(&blob.image,
+							decision.features);
+
+		printf("Decision: value %lld, expected %lld %s\n",
+		       (long long)decision.value, (long long)expected,
+		       decision.value == expected ? "(OK)" : "(MISMATCH)");
+	}
+
+	write_model_attr(ML_MODEL_MODE, "learning");
+}
+
+/*
+ * Decompress the slot's payload into @dst.
+ * Returns number of raw bytes or negative error code.
+ */
+static long decompress_payload(unsigned int compression,
+			       const void *src, size_t src_size,
+			       void *dst, size_t dst_size)
+{
+	switch (compression) {
+	case ML_LIB_NO_COMPRESSION:
+		if (src_size > dst_size)
+			return -ENOSPC;
+		memcpy(dst, src, src_size);
+		return src_size;
+
+	case ML_LIB_LZ4_COMPRESSION:
+#ifdef ML_LIB_TEST_WITH_LZ4
+	{
+		int res = LZ4_decompress_safe(src, dst, src_size, dst_size);
+
+		return res < 0 ? -EIO : res;
+	}
+#else
+		return -ENOTSUP;
+#endif
+
+	case ML_LIB_ZSTD_COMPRESSION:
+#ifdef ML_LIB_TEST_WITH_ZSTD
+	{
+		size_t res = ZSTD_decompress(dst, dst_size, src, src_size);
+
+		return ZSTD_isError(res) ? -EIO : (long)res;
+	}
+#else
+		return -ENOTSUP;
+#endif
+	}
+
+	return -EINVAL;
+}
+
+static void test_mmap(int fd)
+{
+	const struct ml_lib_dataset_ring_ctrl *ctrl;
+	const struct ml_lib_dataset_slot *slot;
+	const unsigned char *payload;
+	unsigned char *raw = NULL;
+	long raw_size;
+	unsigned long long index;
+	unsigned long long seq;
+	size_t map_size;
+	void *ctrl_page;
+	void *area;
+	long page_size = sysconf(_SC_PAGESIZE);
+
+	print_separator("Mmap Dataset Ring Test");
+
+	if (write_control("prepare_dataset") < 0)
+		return;
+
+	ctrl_page = mmap(NULL, page_size, PROT_READ, MAP_SHARED, fd, 0);
+	if (ctrl_page == MAP_FAILED) {
+		perror("Mmap of control page failed");
+		return;
+	}
+
+	ctrl = ctrl_page;
+	map_size = ctrl->data_offset +
+			(size_t)ctrl->nr_slots * ctrl->slot_size;
+	munmap(ctrl_page, page_size);
+
+	area = mmap(NULL, map_size, PROT_READ, MAP_SHARED, fd, 0);
+	if (area == MAP_FAILED) {
+		perror("Mmap of dataset ring failed");
+		return;
+	}
+
+	ctrl = area;
+	printf("Ring: slots %u, slot size %u, head %llu, tail %llu\n",
+		ctrl->nr_slots, ctrl->slot_size,
+		(unsigned long long)ctrl->head,
+		(unsigned long long)ctrl->tail);
+
+	if (ctrl->head == 0) {
+		printf("Ring is empty\n");
+		goto unmap_ring;
+	}
+
+	index = __atomic_load_n(&ctrl->head, __ATOMIC_ACQUIRE) - 1;
+	slot = (const void *)((const char *)area + ctrl->data_offset +
+				(index % ctrl->nr_slots) * ctrl->slot_size);
+	payload = (const unsigned char *)(slot + 1);
+
+	seq = __atomic_load_n(&slot->seq, __ATOMIC_ACQUIRE);
+	if (seq != index + 1) {
+		printf("Slot %llu has been overwritten\n", index);
+		goto unmap_ring;
+	}
+
+	printf("Slot %llu: type %u, offset %llu, size %u, "
+		"compression %u, raw size %u\n",
+		index, slot->type,
+		(unsigned long long)slot->portion_offset,
+		slot->portion_size, slot->compression, slot->raw_size);
+
+	raw = malloc(slot->raw_size ? slot->raw_size : 1);
+	if (!raw) {
+		perror("Failed to allocate raw buffer");
+		goto unmap_ring;
+	}
+
+	raw_size = decompress_payload(slot->compression,
+				      payload, slot->portion_size,
+				      raw, slot->raw_size);
+
+	__atomic_thread_fence(__ATOMIC_ACQUIRE);
+	if (__atomic_load_n(&slot->seq, __ATOMIC_RELAXED) != seq) {
+		printf("Slot %llu has been overwritten during read\n", index);
+		goto unmap_ring;
+	}
+
+	if (raw_size < 0) {
+		printf("Failed to decompress slot %llu: %s\n",
+			index, strerror(-raw_size));
+	} else if (raw_size > 0) {
+		printf("Decompressed %ld bytes, first byte 0x%02x\n",
+			raw_size, raw[0]);
+	}
+
+unmap_ring:
+	free(raw);
+	munmap(area, map_size);
+}
+
+static double elapsed_seconds(const struct timespec *start)
+{
+	struct timespec now;
+
+	clock_gettime(CLOCK_MONOTONIC, &now);
+
+	return (now.tv_sec - start->tv_sec) +
+		(now.tv_nsec - start->tv_nsec) / 1e9;
+}
+
+/*
+ * Measure how many prepare_dataset/discard_dataset cycles
+ * per second can be executed through ML model's control.
+ */
+static int bench_dataset_cycles(int seconds)
+{
+	static const char prepare[] = "prepare_dataset";
+	static const char discard[] = "discard_dataset";
+	unsigned long long cycles = 0;
+	unsigned long long failures = 0;
+	struct timespec start;
+	double elapsed;
 	int fd;
 
+	print_separator("Dataset Cycle Benchmark");
+
+	fd = open(ML_MODEL_CONTROL, O_WRONLY);
+	if (fd < 0) {
+		perror("Failed to open ML model control");
+		return 1;
+	}
+
+	clock_gettime(CLOCK_MONOTONIC, &start);
+
+	do {
+		if (pwrite(fd, prepare, sizeof(prepare) - 1, 0) < 0 ||
+		    pwrite(fd, discard, sizeof(discard) - 1, 0) < 0)
+			failures++;
+		else
+			cycles++;
+
+		elapsed = elapsed_seconds(&start);
+	} while (elapsed < seconds);
+
+	close(fd);
+
+	printf("Cycles:          %llu\n", cycles);
+	printf("Failures:        %llu\n", failures);
+	printf("Elapsed:         %.3f s\n", elapsed);
+	printf("Cycles/s:        %.0f\n", cycles / elapsed);
+	printf("Latency/cycle:   %.2f us\n",
+		cycles ? elapsed * 1e6 / cycles : 0.0);
+
+	return 0;
+}
+
+#ifdef ML_LIB_TEST_WITH_URING
+static void prep_uring_cmd(struct io_uring_sqe *sqe, int fd,
+			   unsigned int cmd_op, const void *addr,
+			   unsigned int len, unsigned int flags)
+{
+	struct ml_lib_uring_cmd cmd = {
+		.addr = (unsigned long)addr,
+		.len = len,
+		.flags = flags,
+	};
+
+	io_uring_prep_rw(IORING_OP_URING_CMD, sqe, fd, NULL, 0, 0);
+	sqe->cmd_op = cmd_op;
+	memcpy(sqe->cmd, &cmd, sizeof(cmd));
+	sqe->user_data = cmd_op;
+}
+
+/*
+ * Submit the batch of dataset fetch, recommendations and feedback
+ * by single io_uring_submit() call and reap the completions.
+ */
+static void test_uring(int fd)
+{
+	struct ml_lib_user_space_recommendation *hints;
+	struct ml_lib_backpropagation_feedback *feedback;
+	unsigned long long processed = 0;
+	struct io_uring_cqe *cqe;
+	struct io_uring ring;
+	unsigned char *dataset;
+	int submitted;
+	int ret;
+	int i;
+
+	print_separator("Io_uring Commands Test");
+
+	/* the big CQE reports the required size of fetch's buffer */
+	ret = io_uring_queue_init(URING_QUEUE_DEPTH, &ring,
+				  IORING_SETUP_CQE32);
+	if (ret < 0) {
+		printf("Failed to init io_uring: %s\n", strerror(-ret));
+		return;
+	}
+
+	dataset = malloc(URING_FETCH_SIZE);
+	hints = calloc(URING_RECORDS_PER_COMMAND, sizeof(*hints));
+	feedback = calloc(URING_RECORDS_PER_COMMAND, sizeof(*feedback));
+	if (!dataset || !hints || !feedback) {
+		perror("Failed to allocate io_uring buffers");
+		goto free_buffers;
+	}
+
+	for (i = 0; i < URING_RECORDS_PER_COMMAND; i++) {
+		hints[i].request_id = i;
+		hints[i].value = i;
+		feedback[i].request_id = i;
+	}
+
+	prep_uring_cmd(io_uring_get_sqe(&ring), fd,
+			ML_LIB_URING_CMD_FETCH_DATASET,
+			dataset, URING_FETCH_SIZE,
+			ML_LIB_URING_FETCH_PREPARE);
+
+	for (i = 0; i < URING_APPLY_COMMANDS; i++) {
+		prep_uring_cmd(io_uring_get_sqe(&ring), fd,
+				ML_LIB_URING_CMD_APPLY_RECOMMENDATION,
+				hints, URING_RECORDS_PER_COMMAND, 0);
+	}
+
+	prep_uring_cmd(io_uring_get_sqe(&ring), fd,
+			ML_LIB_URING_CMD_SEND_FEEDBACK,
+			feedback, URING_RECORDS_PER_COMMAND, 0);
+
+	submitted = io_uring_submit(&ring);
+	if (submitted < 0) {
+		printf("Failed to submit io_uring commands: %s\n",
+			strerror(-submitted));
+		goto free_buffers;
+	}
+
+	for (i = 0; i < submitted; i++) {
+		ret = io_uring_wait_cqe(&ring, &cqe);
+		if (ret < 0) {
+			printf("Failed to wait completion: %s\n",
+				strerror(-ret));
+			break;
+		}
+
+		if (cqe->res == -EMSGSIZE &&
+		    cqe->user_data == ML_LIB_URING_CMD_FETCH_DATASET) {
+			printf("Fetch needs buffer of %llu bytes\n",
+				(unsigned long long)cqe->big_cqe[0]);
+		} else if (cqe->res < 0) {
+			printf("Command %llu failed: %s\n",
+				(unsigned long long)cqe->user_data,
+				strerror(-cqe->res));
+		} else if (cqe->user_data == ML_LIB_URING_CMD_FETCH_DATASET) {
+			printf("Fetched dataset: %d bytes\n", cqe->res);
+		} else
+			processed += cqe->res;
+
+		io_uring_cqe_seen(&ring, cqe);
+	}
+
+	printf("Submitted %d commands by single syscall\n", submitted);
+	printf("Processed %llu recommendation/feedback records\n",
+		processed);
+
+free_buffers:
+	free(feedback);
+	free(hints);
+	free(dataset);
+	io_uring_queue_exit(&ring);
+}
+#else
+static void test_uring(int fd)
+{
+	(void)fd;
+
+	print_separator("Io_uring Commands Test");
+	printf("Skipped: compiled without ML_LIB_TEST_WITH_URING\n");
+}
+#endif /* ML_LIB_TEST_WITH_URING */
+
+/*
+ * Report per-inference latency of in-kernel quantized MLP
+ * for representative sizes of layers (input x hidden x output).
+ */
+static int bench_mlp(void)
+{
+	static const unsigned int sizes[][3] = {
+		{ 16, 32, 1 },
+		{ 32, 64, 4 },
+		{ 64, 64, 16 },
+		{ 128, 128, 32 },
+		{ 256, 256, 64 },
+		{ 1024, 1024, 64 },
+	};
+	unsigned int i;
+	int fd;
+
+	fd = open(DEVICE_PATH, O_RDWR);
+	if (fd < 0) {
+		perror("Failed to open device");
+		return 1;
+	}
+
+	printf("%-20s %12s %12s %14s\n",
+	       "layers", "MACs", "iterations", "ns/inference");
+
+	for (i = 0; i < sizeof(sizes) / sizeof(sizes[0]); i++) {
+		struct ml_lib_test_dev_mlp_bench bench = {0};
+		unsigned long long macs;
+		unsigned long long iterations;
+		char layers[32];
+
+		bench.input_size = sizes[i][0];
+		bench.hidden_size = sizes[i][1];
+		bench.output_size = sizes[i][2];
+
+		macs = (unsigned long long)bench.input_size * bench.hidden_size +
+			(unsigned long long)bench.hidden_size * bench.output_size;
+		iterations = MLP_BENCH_MACS_BUDGET / macs;
+		if (iterations < MLP_BENCH_ITERATIONS_MIN)
+			iterations = MLP_BENCH_ITERATIONS_MIN;
+		if (iterations > MLP_BENCH_ITERATIONS_MAX)
+			iterations = MLP_BENCH_ITERATIONS_MAX;
+		bench.iterations = iterations;
+
+		if (ioctl(fd, ML_LIB_TEST_DEV_IOCBENCHMLP, &bench) < 0) {
+			perror("IOCTL BENCHMLP failed");
+			close(fd);
+			return 1;
+		}
+
+		snprintf(layers, sizeof(layers), "%ux%ux%u",
+			 bench.input_size, bench.hidden_size,
+			 bench.output_size);
+		printf("%-20s %12llu %12u %14llu\n", layers, macs,
+		       bench.iterations,
+		       (unsigned long long)bench.nsec_per_inference);
+	}
+
+	close(fd);
+
+	return 0;
+}
+
+int main(int argc, char *argv[])
+{
+	int fd;
+
+	if (argc > 1 && strcmp(argv[1], "bench-mlp") == 0)
+		return bench_mlp();
+
+	if (argc > 1 && strcmp(argv[1], "bench") == 0) {
+		int seconds = BENCH_DEFAULT_SECONDS;
+
+		if (argc > 2)
+			seconds = atoi(argv[2]);
+		if (seconds <= 0)
+			seconds = BENCH_DEFAULT_SECONDS;
+
+		return bench_dataset_cycles(seconds);
+	}
+
 	printf("ML Library Testing Device Driver Test Program\n");
 	printf("==================================\n");
 
@@ -189,7 +1018,21 @@ int main(void)
 	/* Run tests */
 	test_write(fd);
 	test_read(fd);
+	test_poll(fd);
 	test_ioctl(fd);
+	test_mmap(fd);
+	test_uring(fd);
+	if (test_agents(fd)) {
+		printf("Agents test failed\n");
+		close(fd);
+		return 1;
+	}
+	if (test_trees(fd)) {
+		printf("Tree ensemble test failed\n");
+		close(fd);
+		return 1;
+	}
+	test_model_blob(fd);
 
 	/* Show sysfs and proc information */
 	show_sysfs_info();
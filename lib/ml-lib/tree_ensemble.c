@@ -0,0 +1,307 @@
+// SPDX-License-Identifier: GPL-2.0-only
+/*
+ * Machine Learning (ML) library
+ *
+ * Copyright (C) 2025-2026 Viacheslav Dubeyko <slava@dubeyko.com>
+ */
+
+#include <linux/module.h>
+#include <linux/kernel.h>
+#include <linux/slab.h>
+#include <linux/overflow.h>
+#include <linux/rcupdate.h>
+
+#include <linux/ml-lib/ml_lib.h>
+
+#include "tree_ensemble.h"
+#include "model_blob.h"
+
+/*
+ * The tree ensemble is trained in user-space and its image
+ * is loaded into ML model. The image is validated at load time,
+ * so the evaluation doesn't check anything: every child has
+ * bigger index than its parent and belongs to the same tree.
+ * As a result, every walk from the root reaches a leaf.
+ *
+ * The evaluation is integer-only and doesn't sleep. It is executed
+ * under RCU read lock, so the ensemble can be replaced at any time.
+ */
+
+/*
+ * struct ml_lib_tree_ensemble - loaded tree ensemble
+ * @nr_features: number of features in decision's feature vector
+ * @nr_trees: number of trees
+ * @nr_nodes: number of nodes of all trees
+ * @base_score: initial decision value
+ * @roots: index of every tree's root node
+ * @rcu: deferred freeing of replaced ensemble
+ * @nodes: nodes of all trees
+ */
+struct ml_lib_tree_ensemble {
+	u32 nr_features;
+	u32 nr_trees;
+	u32 nr_nodes;
+	s64 base_score;
+	u32 *roots;
+
+	struct rcu_head rcu;
+
+	struct ml_lib_tree_node nodes[] ____cacheline_aligned;
+};
+
+static int ml_lib_tree_validate(const struct ml_lib_tree_node *nodes,
+				u32 start, u32 end, u32 nr_features)
+{
+	u32 i;
+
+	if (start >= end)
+		return -EINVAL;
+
+	for (i = start; i < end; i++) {
+		const struct ml_lib_tree_node *node = &nodes[i];
+
+		if (node->reserved)
+			return -EINVAL;
+
+		if (node->feature == ML_LIB_TREE_LEAF)
+			continue;
+
+		if (node->feature >= nr_features)
+			return -ERANGE;
+
+		/* left child is the next node */
+		if (i + 1 >= end)
+			return -EINVAL;
+
+		if (node->right <= i + 1 || node->right >= end)
+			return -EINVAL;
+	}
+
+	return 0;
+}
+
+static struct ml_lib_tree_ensemble *
+ml_lib_tree_ensemble_create(const void *image, size_t size)
+{
+	const struct ml_lib_tree_ensemble_header *hdr = image;
+	const struct ml_lib_tree_node *nodes;
+	struct ml_lib_tree_ensemble *ensemble;
+	const u32 *roots;
+	size_t roots_size;
+	size_t nodes_size;
+	size_t ensemble_size;
+	u32 i;
+	int err;
+
+	if (size < sizeof(*hdr))
+		return ERR_PTR(-EINVAL);
+
+	if (hdr->magic != ML_LIB_TREE_ENSEMBLE_MAGIC ||
+	    hdr->version != ML_LIB_TREE_ENSEMBLE_VERSION ||
+	    hdr->reserved)
+		return ERR_PTR(-EINVAL);
+
+	if (!hdr->nr_features || hdr->nr_features >= ML_LIB_TREE_LEAF ||
+	    !hdr->nr_trees || hdr->nr_trees > hdr->nr_nodes ||
+	    hdr->nr_nodes > ML_LIB_TREE_NODES_MAX)
+		return ERR_PTR(-EINVAL);
+
+	roots_size = array_size(hdr->nr_trees, sizeof(u32));
+	nodes_size = array_size(hdr->nr_nodes,
+				sizeof(struct ml_lib_tree_node));
+
+	if (size != size_add(sizeof(*hdr), size_add(roots_size, nodes_size)))
+		return ERR_PTR(-EINVAL);
+
+	roots = (const u32 *)(hdr + 1);
+	nodes = (const struct ml_lib_tree_node *)((const u8 *)roots +
+							roots_size);
+
+	/* trees occupy the consecutive ranges of nodes */
+	if (roots[0] != 0)
+		return ERR_PTR(-EINVAL);
+
+	for (i = 0; i < hdr->nr_trees; i++) {
+		u32 end = hdr->nr_nodes;
+
+		if (i + 1 < hdr->nr_trees)
+			end = min(roots[i + 1], hdr->nr_nodes);
+
+		err = ml_lib_tree_validate(nodes, roots[i], end,
+					   hdr->nr_features);
+		if (err) {
+			pr_err("ml_lib: invalid tree: index %u, err %d\n",
+				i, err);
+			return ERR_PTR(err);
+		}
+	}
+
+	ensemble_size = size_add(struct_size(ensemble, nodes, hdr->nr_nodes),
+				 roots_size);
+	ensemble = kvzalloc(ensemble_size, GFP_KERNEL);
+	if (unlikely(!ensemble))
+		return ERR_PTR(-ENOMEM);
+
+	ensemble->nr_features = hdr->nr_features;
+	ensemble->nr_trees = hdr->nr_trees;
+	ensemble->nr_nodes = hdr->nr_nodes;
+	ensemble->base_score = hdr->base_score;
+	memcpy(ensemble->nodes, nodes, nodes_size);
+
+	ensemble->roots = (u32 *)&ensemble->nodes[hdr->nr_nodes];
+	memcpy(ensemble->roots, roots, roots_size);
+
+	return ensemble;
+}
+
+static void ml_lib_tree_ensemble_replace(struct ml_lib_model *ml_model,
+					 struct ml_lib_tree_ensemble *ensemble)
+{
+	struct ml_lib_tree_ensemble *old_ensemble;
+
+	/* ensemble is replaced like ML model's options */
+	spin_lock(&ml_model->options_lock);
+	old_ensemble = rcu_dereference_protected(ml_model->tree_ensemble,
+				lockdep_is_held(&ml_model->options_lock));
+	rcu_assign_pointer(ml_model->tree_ensemble, ensemble);
+	spin_unlock(&ml_model->options_lock);
+
+	if (old_ensemble)
+		kvfree_rcu(old_ensemble, rcu);
+
+	/* the cached recommendations belong to the replaced model */
+	ml_model_invalidate_recommendations(ml_model);
+}
+
+int ml_lib_tree_ensemble_load(struct ml_lib_model *ml_model,
+			      const void *image, size_t size)
+{
+	struct ml_lib_tree_ensemble *ensemble;
+
+	ensemble = ml_lib_tree_ensemble_create(image, size);
+	if (IS_ERR(ensemble)) {
+		pr_err("ml_lib: failed to load tree ensemble: err %ld\n",
+			PTR_ERR(ensemble));
+		return PTR_ERR(ensemble);
+	}
+
+	ml_lib_tree_ensemble_replace(ml_model, ensemble);
+
+	return 0;
+}
+
+/*
+ * ml_model_load_tree_ensemble() - load tree ensemble into ML model
+ * @ml_model: ML model object
+ * @image: tree ensemble image (see struct ml_lib_tree_ensemble_header)
+ * @size: size of image in bytes
+ *
+ * The image is validated and copied, so the caller keeps
+ * the ownership of @image. The previously loaded ensemble
+ * (or MLP) is freed after RCU grace period. The ensemble
+ * receives the next model version.
+ */
+int ml_model_load_tree_ensemble(struct ml_lib_model *ml_model,
+				const void *image, size_t size)
+{
+	if (!ml_model || !image)
+		return -EINVAL;
+
+	return ml_lib_model_install(ml_model, ML_LIB_MODEL_BLOB_TREE_ENSEMBLE,
+				    image, size, 0);
+}
+EXPORT_SYMBOL(ml_model_load_tree_ensemble);
+
+void ml_model_unload_tree_ensemble(struct ml_lib_model *ml_model)
+{
+	if (!ml_model)
+		return;
+
+	ml_lib_tree_ensemble_replace(ml_model, NULL);
+}
+EXPORT_SYMBOL(ml_model_unload_tree_ensemble);
+
+static inline s64 ml_lib_tree_evaluate(const struct ml_lib_tree_node *nodes,
+				       u32 root, const s64 *features)
+{
+	const struct ml_lib_tree_node *node = &nodes[root];
+
+	while (node->feature != ML_LIB_TREE_LEAF) {
+		if (features[node->feature] <= node->value)
+			node++;
+		else
+			node = &nodes[node->right];
+	}
+
+	return node->value;
+}
+
+/*
+ * ml_model_evaluate_tree_ensemble() - evaluate decision in kernel
+ * @ml_model: ML model object
+ * @features: feature vector of decision
+ * @nr_features: number of features in @features
+ * @value: decision value [out]
+ *
+ * Returns -ENODATA if no tree ensemble has been loaded.
+ */
+int ml_model_evaluate_tree_ensemble(struct ml_lib_model *ml_model,
+				    const s64 *features, u32 nr_features,
+				    s64 *value)
+{
+	struct ml_lib_tree_ensemble *ensemble;
+	s64 score;
+	u32 i;
+	int err = 0;
+
+	if (!ml_model || !features || !value)
+		return -EINVAL;
+
+	rcu_read_lock();
+	ensemble = rcu_dereference(ml_model->tree_ensemble);
+	if (!ensemble) {
+		err = -ENODATA;
+		goto finish_evaluation;
+	}
+
+	if (nr_features < ensemble->nr_features) {
+		err = -EINVAL;
+		goto finish_evaluation;
+	}
+
+	score = ensemble->base_score;
+	for (i = 0; i < ensemble->nr_trees; i++) {
+		score += ml_lib_tree_evaluate(ensemble->nodes,
+					      ensemble->roots[i], features);
+	}
+
+	*value = score;
+
+finish_evaluation:
+	rcu_read_unlock();
+
+	return err;
+}
+EXPORT_SYMBOL(ml_model_evaluate_tree_ensemble);
+
+/*
+ * ml_lib_tree_ensemble_info() - show description of loaded ensemble
+ */
+ssize_t ml_lib_tree_ensemble_info(struct ml_lib_model *ml_model, char *buf)
+{
+	struct ml_lib_tree_ensemble *ensemble;
+	ssize_t count;
+
+	rcu_read_lock();
+	ensemble = rcu_dereference(ml_model->tree_ensemble);
+	if (!ensemble)
+		count = sysfs_emit(buf, "none\n");
+	else {
+		count = sysfs_emit(buf, "trees %u nodes %u features %u\n",
+				   ensemble->nr_trees, ensemble->nr_nodes,
+				   ensemble->nr_features);
+	}
+	rcu_read_unlock();
+
+	return count;
+}
@@ -0,0 +1,15 @@
+// SPDX-License-Identifier: GPL-2.0-only
+/*
+ * Machine Learning (ML) library
+ *
+ * Copyright (C) 2025-2026 Viacheslav Dubeyko <slava@dubeyko.com>
+ */
+
+#ifndef _LINUX_ML_LIB_TREE_ENSEMBLE_H
+#define _LINUX_ML_LIB_TREE_ENSEMBLE_H
+
+int ml_lib_tree_ensemble_load(struct ml_lib_model *ml_model,
+			      const void *image, size_t size);
+ssize_t ml_lib_tree_ensemble_info(struct ml_lib_model *ml_model, char *buf);
+
+#endif /* _LINUX_ML_LIB_TREE_ENSEMBLE_H */
@@ -0,0 +1,164 @@
+// SPDX-License-Identifier: GPL-2.0-only
+/*
+ * Machine Learning (ML) library
+ *
+ * Copyright (C) 2025-2026 Viacheslav Dubeyko <slava@dubeyko.com>
+ */
+
+#include <linux/module.h>
+#include <linux/kernel.h>
+#include <linux/uaccess.h>
+#include <linux/io_uring/cmd.h>
+
+#include <linux/ml-lib/ml_lib.h>
+
+#include "dataset_queue.h"
+
+/*
+ * Every io_uring command is executed synchronously at submission
+ * time and its result is posted as CQE by io_uring core. As a result,
+ * user-space can submit a batch of commands (and every command
+ * can carry an array of records) by a single io_uring_enter() call.
+ * Only the preparation of a dataset can sleep on ML model's locks,
+ * so such command is punted into io_uring's worker by -EAGAIN
+ * for the case of non-blocking issue. The fetch of dataset is
+ * punted too if other consumer holds the queue.
+ */
+
+static int ml_lib_uring_fetch_dataset(struct ml_lib_model *ml_model,
+				      struct io_uring_cmd *ioucmd,
+				      const struct ml_lib_uring_cmd *cmd,
+				      unsigned int issue_flags)
+{
+	void __user *buf = u64_to_user_ptr(cmd->addr);
+	u32 size = 0;
+	ssize_t copied;
+	int err;
+
+	if (cmd->flags & ~ML_LIB_URING_FETCH_FLAGS)
+		return -EINVAL;
+
+	if (cmd->flags & ML_LIB_URING_FETCH_PREPARE) {
+		if (issue_flags & IO_URING_F_NONBLOCK)
+			return -EAGAIN;
+
+		err = ml_model_get_dataset(ml_model, NULL, NULL);
+		if (err)
+			return err;
+	}
+
+	copied = ml_lib_dataset_fetch(ml_model, buf, cmd->len,
+				      cmd->flags & ML_LIB_URING_FETCH_KEEP,
+				      issue_flags & IO_URING_F_NONBLOCK,
+				      &size);
+	if (copied == -EMSGSIZE) {
+		/* the required size is reported by the big CQE */
+		io_uring_cmd_done(ioucmd, -EMSGSIZE, size, issue_flags);
+		return -EIOCBQUEUED;
+	}
+
+	return copied;
+}
+
+static int ml_lib_uring_apply_recommendations(struct ml_lib_model *ml_model,
+					const struct ml_lib_uring_cmd *cmd)
+{
+	struct ml_lib_user_space_recommendation __user *records;
+	struct ml_lib_user_space_recommendation hint;
+	u32 i;
+	int err;
+
+	if (cmd->flags || cmd->len > ML_LIB_URING_BATCH_MAX)
+		return -EINVAL;
+
+	records = u64_to_user_ptr(cmd->addr);
+
+	for (i = 0; i < cmd->len; i++) {
+		if (copy_from_user(&hint, &records[i], sizeof(hint))) {
+			err = -EFAULT;
+			goto finish_apply;
+		}
+
+		err = ml_model_submit_recommendation(ml_model, &hint);
+		if (err)
+			goto finish_apply;
+	}
+
+	return i;
+
+finish_apply:
+	/* report the number of submitted records, if any */
+	return i > 0 ? i : err;
+}
+
+static int ml_lib_uring_send_feedback(struct ml_lib_model *ml_model,
+				      const struct ml_lib_uring_cmd *cmd)
+{
+	struct ml_lib_backpropagation_feedback __user *records;
+	struct ml_lib_backpropagation_feedback feedback;
+	u32 i;
+	int err;
+
+	if (cmd->flags || cmd->len > ML_LIB_URING_BATCH_MAX)
+		return -EINVAL;
+
+	records = u64_to_user_ptr(cmd->addr);
+
+	for (i = 0; i < cmd->len; i++) {
+		if (copy_from_user(&feedback, &records[i], sizeof(feedback))) {
+			err = -EFAULT;
+			goto finish_send;
+		}
+
+		err = ml_model_error_backpropagation(ml_model, &feedback, NULL);
+		if (err)
+			goto finish_send;
+	}
+
+	return i;
+
+finish_send:
+	/* report the number of delivered records, if any */
+	return i > 0 ? i : err;
+}
+
+/*
+ * ml_model_uring_cmd() - execute io_uring command
+ * @ml_model: ML model object
+ * @ioucmd: io_uring command
+ * @issue_flags: io_uring issue flags
+ *
+ * The method can be used by file_operations::uring_cmd
+ * of kernel subsystem that owns the ML model.
+ */
+int ml_model_uring_cmd(struct ml_lib_model *ml_model,
+			struct io_uring_cmd *ioucmd,
+			unsigned int issue_flags)
+{
+	const struct ml_lib_uring_cmd *sqe_cmd;
+	struct ml_lib_uring_cmd cmd;
+
+	if (!ml_model || !ioucmd)
+		return -EINVAL;
+
+	/* SQE is shared with user-space */
+	sqe_cmd = io_uring_sqe_cmd(ioucmd->sqe);
+	cmd.addr = READ_ONCE(sqe_cmd->addr);
+	cmd.len = READ_ONCE(sqe_cmd->len);
+	cmd.flags = READ_ONCE(sqe_cmd->flags);
+
+	switch (ioucmd->cmd_op) {
+	case ML_LIB_URING_CMD_FETCH_DATASET:
+		return ml_lib_uring_fetch_dataset(ml_model, ioucmd, &cmd,
+						  issue_flags);
+
+	case ML_LIB_URING_CMD_APPLY_RECOMMENDATION:
+		return ml_lib_uring_apply_recommendations(ml_model, &cmd);
+
+	case ML_LIB_URING_CMD_SEND_FEEDBACK:
+		return ml_lib_uring_send_feedback(ml_model, &cmd);
+	}
+
+	return -ENOTTY;
+}
+EXPORT_SYMBOL(ml_model_uring_cmd);
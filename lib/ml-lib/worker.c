@@ -0,0 +1,487 @@
+// SPDX-License-Identifier: GPL-2.0-only
+/*
+ * Machine Learning (ML) library
+ *
+ * Copyright (C) 2025-2026 Viacheslav Dubeyko <slava@dubeyko.com>
+ */
+
+#include <linux/module.h>
+#include <linux/kernel.h>
+#include <linux/jiffies.h>
+#include <linux/math64.h>
+#include <linux/timekeeping.h>
+#include <linux/timer.h>
+#include <linux/topology.h>
+#include <linux/cpumask.h>
+#include <linux/nodemask.h>
+#include <linux/workqueue.h>
+#include <linux/rcupdate.h>
+
+#include <linux/ml-lib/ml_lib.h>
+
+#include "dataset_queue.h"
+#include "hint_ring.h"
+#include "worker.h"
+
+/*
+ * The worker of started ML model executes the cycle of dataset
+ * extraction, preprocessing, compression and publishing every
+ * sleep_timeout milliseconds. The worker is the delayed work,
+ * so the idle ML model doesn't keep any thread. The sleep_timeout
+ * is taken from the current RCU-protected options before every
+ * re-queue, so re_init() changes the cadence without restart
+ * of the ML model.
+ *
+ * The workers of all ML models share the unbound workqueues of
+ * ML library (one workqueue per priority class). The unbound
+ * workqueues keep per-NUMA-node pools of threads, and the worker
+ * of ML model with defined NUMA node is queued on the CPU of this
+ * node. The timers of NORMAL and BACKGROUND classes are deferrable
+ * and the intervals that are longer than one second are rounded
+ * to the whole second, so the idle ML models don't wake up idle CPUs
+ * and the wakeups of many ML models are coalesced.
+ *
+ * The CPU-time budget (microseconds per second) limits the overhead
+ * of ML model: the next cycle is delayed until the duration of
+ * the last cycle fits into the budget.
+ *
+ * If the options define the bounds of the interval, then the interval
+ * is adapted after every cycle (the cycles of one ML model never run
+ * concurrently, so the cadence needs no lock):
+ * (1) the interval is doubled if the consumer lags (the dataset queue
+ *     is three quarters full) or nothing has been published;
+ * (2) the interval is halved if the publishing rate exceeds its moving
+ *     average by a quarter (burst of subsystem's activity);
+ * (3) the interval is increased by a quarter if the rate falls below
+ *     three quarters of the moving average.
+ */
+
+static struct workqueue_struct *ml_lib_worker_wq[ML_LIB_WORKER_CLASS_MAX];
+
+static const char * const ml_lib_worker_class_str[ML_LIB_WORKER_CLASS_MAX] = {
+	"normal",
+	"high",
+	"background",
+};
+
+struct ml_lib_worker_params {
+	u32 initial;
+	u32 min;
+	u32 max;
+	u32 budget;
+	u32 class;
+};
+
+static bool ml_lib_worker_get_params(struct ml_lib_model *ml_model,
+				     struct ml_lib_worker_params *params)
+{
+	struct ml_lib_model_options *options;
+
+	params->initial = ML_LIB_SLEEP_TIMEOUT_DEFAULT;
+	params->min = 0;
+	params->max = 0;
+	params->budget = 0;
+	params->class = ML_LIB_WORKER_NORMAL_CLASS;
+
+	rcu_read_lock();
+	options = rcu_dereference(ml_model->options);
+	if (options) {
+		if (options->sleep_timeout)
+			params->initial = options->sleep_timeout;
+		params->min = max_t(u32, options->min_sleep_timeout, 1);
+		params->max = options->max_sleep_timeout;
+		params->budget = options->worker_budget;
+		if (options->worker_class < ML_LIB_WORKER_CLASS_MAX)
+			params->class = options->worker_class;
+	}
+	rcu_read_unlock();
+
+	/* is adaptive interval enabled? */
+	return params->max > params->min;
+}
+
+static bool ml_lib_worker_consumer_lags(struct ml_lib_model *ml_model,
+					int err)
+{
+	struct ml_lib_dataset_queue *queue = READ_ONCE(ml_model->datasets);
+	u64 count;
+
+	if (err == -ENOSPC)
+		return true;
+
+	if (!queue)
+		return false;
+
+	count = ml_lib_dataset_queue_count(queue);
+	return count * 4 >= (u64)ml_lib_dataset_queue_depth(queue) * 3;
+}
+
+static u32 ml_lib_worker_adapt(struct ml_lib_model *ml_model,
+			       struct ml_lib_worker_params *params,
+			       bool adaptive, int err)
+{
+	struct ml_lib_cadence *cadence = &ml_model->cadence;
+	u64 interval = cadence->interval;
+	u64 bytes, delta, rate, avg;
+
+	if (!adaptive) {
+		WRITE_ONCE(cadence->interval, params->initial);
+		return params->initial;
+	}
+
+	if (!interval)
+		interval = clamp(params->initial, params->min, params->max);
+
+	bytes = atomic64_read(&ml_model->published_bytes);
+	delta = bytes - cadence->last_bytes;
+	cadence->last_bytes = bytes;
+
+	rate = div64_u64(delta * MSEC_PER_SEC, interval);
+	avg = cadence->rate;
+
+	/* the first sample only seeds the moving average */
+	if (ml_lib_worker_consumer_lags(ml_model, err) || !delta)
+		interval *= 2;
+	else if (avg && rate > avg + avg / 4)
+		interval /= 2;
+	else if (rate < avg - avg / 4)
+		interval += interval / 4;
+
+	/* exponential moving average with weight 1/8 */
+	cadence->rate = avg ? avg - avg / 8 + rate / 8 : rate;
+
+	interval = clamp_t(u64, interval, params->min, params->max);
+	WRITE_ONCE(cadence->interval, interval);
+
+	return interval;
+}
+
+/*
+ * The cycle of @cost_ns fits into the budget of @budget microseconds
+ * per second if the next cycle starts not earlier than
+ * @cost_ns * USEC_PER_SEC / @budget nanoseconds after the start
+ * of the last one.
+ */
+static u32 ml_lib_worker_apply_budget(struct ml_lib_model *ml_model,
+				      u32 budget, u64 cost_ns, u32 delay)
+{
+	u64 period_ns;
+	u64 min_delay;
+
+	if (!budget || budget >= USEC_PER_SEC)
+		return delay;
+
+	period_ns = div64_u64(cost_ns * USEC_PER_SEC, budget);
+	if (period_ns <= cost_ns)
+		return delay;
+
+	min_delay = DIV_ROUND_UP_ULL(period_ns - cost_ns, NSEC_PER_MSEC);
+	if (min_delay <= delay)
+		return delay;
+
+	WRITE_ONCE(ml_model->worker_stats.throttled,
+		   ml_model->worker_stats.throttled + 1);
+
+	return min_t(u64, min_delay, U32_MAX);
+}
+
+static int ml_lib_worker_cpu(struct ml_lib_model *ml_model)
+{
+	int node = READ_ONCE(ml_model->numa_node);
+	unsigned int cpu;
+
+	if (node == NUMA_NO_NODE)
+		return WORK_CPU_UNBOUND;
+
+	cpu = cpumask_any_and(cpumask_of_node(node), cpu_online_mask);
+	if (cpu >= nr_cpu_ids)
+		return WORK_CPU_UNBOUND;
+
+	return cpu;
+}
+
+static void ml_lib_worker_queue(struct ml_lib_model *ml_model, u32 delay)
+{
+	unsigned long timeout = msecs_to_jiffies(delay);
+
+	if (ml_model->worker_class != ML_LIB_WORKER_HIGH_CLASS &&
+	    timeout >= HZ)
+		timeout = round_jiffies_relative(timeout);
+
+	queue_delayed_work_on(ml_lib_worker_cpu(ml_model),
+			      ml_lib_worker_wq[ml_model->worker_class],
+			      &ml_model->worker, timeout);
+}
+
+/*
+ * ml_lib_worker_queue_work() - queue work item of ML model
+ * @ml_model: ML model object
+ * @work: work item
+ *
+ * The work is executed by the workqueue of the model's priority
+ * class on the model's NUMA node.
+ */
+void ml_lib_worker_queue_work(struct ml_lib_model *ml_model,
+			      struct work_struct *work)
+{
+	u32 class = READ_ONCE(ml_model->worker_class);
+
+	queue_work_on(ml_lib_worker_cpu(ml_model),
+		      ml_lib_worker_wq[class], work);
+}
+
+/*
+ * ml_lib_worker_queue_delayed_work() - queue delayed work of ML model
+ * @ml_model: ML model object
+ * @dwork: delayed work item
+ * @delay: delay in jiffies
+ *
+ * The work is executed like ml_lib_worker_queue_work() one,
+ * but the @delay is not rounded.
+ */
+void ml_lib_worker_queue_delayed_work(struct ml_lib_model *ml_model,
+				      struct delayed_work *dwork,
+				      unsigned long delay)
+{
+	u32 class = READ_ONCE(ml_model->worker_class);
+
+	queue_delayed_work_on(ml_lib_worker_cpu(ml_model),
+			      ml_lib_worker_wq[class], dwork, delay);
+}
+
+/*
+ * The manual preparation of dataset sets RUNNING state too, so
+ * the state of ML model doesn't tell whether the worker is queued.
+ */
+static bool ml_lib_worker_active(struct ml_lib_model *ml_model)
+{
+	return READ_ONCE(ml_model->worker_active);
+}
+
+static void ml_lib_worker_func(struct work_struct *work)
+{
+	struct ml_lib_model *ml_model =
+		container_of(to_delayed_work(work), struct ml_lib_model,
+			     worker);
+	struct ml_lib_worker_stats *stats = &ml_model->worker_stats;
+	struct ml_lib_worker_params params;
+	bool adaptive;
+	u64 start_ns, cost_ns;
+	u32 delay;
+	int err;
+
+	if (!ml_lib_worker_active(ml_model))
+		return;
+
+	start_ns = ktime_get_ns();
+
+	err = ml_model_get_dataset(ml_model, NULL, NULL);
+	switch (err) {
+	case 0:
+	case -ENOSPC:	/* consumer hasn't discarded the oldest dataset */
+	case -ENODEV:	/* ML model hasn't been initialized yet */
+		break;
+
+	default:
+		pr_err_ratelimited("ml_lib: worker failed to get dataset: "
+				   "subsystem %s, model %s, err %d\n",
+				   ml_model->subsystem_name,
+				   ml_model->model_name, err);
+		break;
+	}
+
+	/* apply the recommendations that missed their wakeup, if any */
+	ml_lib_hint_ring_kick(ml_model);
+
+	cost_ns = ktime_get_ns() - start_ns;
+
+	/* the stats have single writer */
+	WRITE_ONCE(stats->cycles, stats->cycles + 1);
+	WRITE_ONCE(stats->runtime_ns, stats->runtime_ns + cost_ns);
+
+	if (!ml_lib_worker_active(ml_model))
+		return;
+
+	adaptive = ml_lib_worker_get_params(ml_model, &params);
+	delay = ml_lib_worker_adapt(ml_model, &params, adaptive, err);
+	delay = ml_lib_worker_apply_budget(ml_model, params.budget,
+					   cost_ns, delay);
+
+	ml_lib_worker_queue(ml_model, delay);
+}
+
+void ml_lib_worker_init(struct ml_lib_model *ml_model)
+{
+	mutex_init(&ml_model->worker_lock);
+	ml_model->worker_active = false;
+	INIT_DELAYED_WORK(&ml_model->worker, ml_lib_worker_func);
+	ml_model->worker_class = ML_LIB_WORKER_NORMAL_CLASS;
+	ml_model->numa_node = NUMA_NO_NODE;
+	memset(&ml_model->cadence, 0, sizeof(ml_model->cadence));
+	memset(&ml_model->worker_stats, 0, sizeof(ml_model->worker_stats));
+}
+
+/*
+ * ml_lib_worker_interval() - current interval of worker's cycles
+ * @ml_model: ML model object
+ *
+ * Returns zero if the worker is stopped.
+ */
+u32 ml_lib_worker_interval(struct ml_lib_model *ml_model)
+{
+	return READ_ONCE(ml_model->cadence.interval);
+}
+
+/*
+ * ml_lib_worker_start() - start the worker of ML model
+ * @ml_model: ML model object
+ *
+ * The first cycle is executed immediately. The priority class
+ * is taken from the options, so the class can be changed only
+ * by the restart of ML model. The start of already started
+ * ML model does nothing.
+ */
+int ml_lib_worker_start(struct ml_lib_model *ml_model)
+{
+	struct ml_lib_worker_params params;
+	int err = 0;
+
+	mutex_lock(&ml_model->worker_lock);
+
+	if (atomic_read(&ml_model->state) == ML_LIB_MODEL_SHUTTING_DOWN) {
+		err = -ESHUTDOWN;
+		goto finish_worker_start;
+	}
+
+	if (ml_model->worker_active)
+		goto finish_worker_start;
+
+	ml_lib_worker_get_params(ml_model, &params);
+
+	/* the worker is idle, so the timer's type can be changed */
+	if (params.class == ML_LIB_WORKER_HIGH_CLASS)
+		INIT_DELAYED_WORK(&ml_model->worker, ml_lib_worker_func);
+	else
+		INIT_DEFERRABLE_WORK(&ml_model->worker, ml_lib_worker_func);
+	ml_model->worker_class = params.class;
+
+	ml_model->cadence.interval = 0;
+	ml_model->cadence.last_bytes =
+			atomic64_read(&ml_model->published_bytes);
+	ml_model->cadence.rate = 0;
+
+	atomic_set(&ml_model->state, ML_LIB_MODEL_STARTED);
+	WRITE_ONCE(ml_model->worker_active, true);
+	ml_lib_worker_queue(ml_model, 0);
+
+finish_worker_start:
+	mutex_unlock(&ml_model->worker_lock);
+
+	return err;
+}
+
+/*
+ * ml_lib_worker_cancel() - wait for the end of worker's cycle
+ * @ml_model: ML model object
+ *
+ * The worker cannot re-queue itself during the cancellation.
+ */
+void ml_lib_worker_cancel(struct ml_lib_model *ml_model)
+{
+	cancel_delayed_work_sync(&ml_model->worker);
+}
+
+void ml_lib_worker_stop(struct ml_lib_model *ml_model)
+{
+	mutex_lock(&ml_model->worker_lock);
+
+	/* the cycle in progress doesn't re-queue the worker */
+	WRITE_ONCE(ml_model->worker_active, false);
+	ml_lib_worker_cancel(ml_model);
+
+	/* the cycle in progress could have set RUNNING state */
+	if (atomic_read(&ml_model->state) != ML_LIB_MODEL_SHUTTING_DOWN)
+		atomic_set(&ml_model->state, ML_LIB_MODEL_STOPPED);
+	WRITE_ONCE(ml_model->cadence.interval, 0);
+
+	mutex_unlock(&ml_model->worker_lock);
+}
+
+/*
+ * ml_lib_worker_shutdown() - stop the worker of destroyed ML model
+ * @ml_model: ML model object
+ *
+ * SHUTTING_DOWN state is set under worker_lock, so neither
+ * the worker nor the governor can be started after the call.
+ */
+void ml_lib_worker_shutdown(struct ml_lib_model *ml_model)
+{
+	mutex_lock(&ml_model->worker_lock);
+
+	atomic_set(&ml_model->state, ML_LIB_MODEL_SHUTTING_DOWN);
+	WRITE_ONCE(ml_model->worker_active, false);
+	ml_lib_worker_cancel(ml_model);
+	WRITE_ONCE(ml_model->cadence.interval, 0);
+
+	mutex_unlock(&ml_model->worker_lock);
+}
+
+/*
+ * ml_lib_worker_info() - show the worker's overhead in sysfs
+ * @ml_model: ML model object
+ * @buf: sysfs buffer
+ */
+ssize_t ml_lib_worker_info(struct ml_lib_model *ml_model, char *buf)
+{
+	struct ml_lib_worker_stats *stats = &ml_model->worker_stats;
+	struct ml_lib_worker_params params;
+	u32 class = READ_ONCE(ml_model->worker_class);
+
+	ml_lib_worker_get_params(ml_model, &params);
+
+	return sysfs_emit(buf,
+			  "class %s node %d budget_us %u cycles %llu "
+			  "runtime_ns %llu throttled %llu\n",
+			  ml_lib_worker_class_str[class],
+			  READ_ONCE(ml_model->numa_node), params.budget,
+			  READ_ONCE(stats->cycles),
+			  READ_ONCE(stats->runtime_ns),
+			  READ_ONCE(stats->throttled));
+}
+
+int __init ml_lib_worker_pool_init(void)
+{
+	ml_lib_worker_wq[ML_LIB_WORKER_NORMAL_CLASS] =
+		alloc_workqueue("ml_lib_normal", WQ_UNBOUND | WQ_SYSFS, 0);
+	ml_lib_worker_wq[ML_LIB_WORKER_HIGH_CLASS] =
+		alloc_workqueue("ml_lib_high",
+				WQ_UNBOUND | WQ_HIGHPRI | WQ_SYSFS, 0);
+	/*
+	 * max_active of unbound workqueue is system-wide, so
+	 * the background workers of all ML models share the limit
+	 * of one concurrent worker per possible NUMA node.
+	 */
+	ml_lib_worker_wq[ML_LIB_WORKER_BACKGROUND_CLASS] =
+		alloc_workqueue("ml_lib_background", WQ_UNBOUND | WQ_SYSFS,
+				num_possible_nodes());
+
+	if (!ml_lib_worker_wq[ML_LIB_WORKER_NORMAL_CLASS] ||
+	    !ml_lib_worker_wq[ML_LIB_WORKER_HIGH_CLASS] ||
+	    !ml_lib_worker_wq[ML_LIB_WORKER_BACKGROUND_CLASS]) {
+		ml_lib_worker_pool_destroy();
+		return -ENOMEM;
+	}
+
+	return 0;
+}
+
+void ml_lib_worker_pool_destroy(void)
+{
+	int i;
+
+	for (i = 0; i < ML_LIB_WORKER_CLASS_MAX; i++) {
+		if (ml_lib_worker_wq[i])
+			destroy_workqueue(ml_lib_worker_wq[i]);
+		ml_lib_worker_wq[i] = NULL;
+	}
+}
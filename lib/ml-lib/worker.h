@@ -0,0 +1,27 @@
+// SPDX-License-Identifier: GPL-2.0-only
+/*
+ * Machine Learning (ML) library
+ *
+ * Copyright (C) 2025-2026 Viacheslav Dubeyko <slava@dubeyko.com>
+ */
+
+#ifndef _LINUX_ML_LIB_WORKER_H
+#define _LINUX_ML_LIB_WORKER_H
+
+int ml_lib_worker_pool_init(void);
+void ml_lib_worker_pool_destroy(void);
+
+void ml_lib_worker_init(struct ml_lib_model *ml_model);
+int ml_lib_worker_start(struct ml_lib_model *ml_model);
+void ml_lib_worker_stop(struct ml_lib_model *ml_model);
+void ml_lib_worker_shutdown(struct ml_lib_model *ml_model);
+void ml_lib_worker_cancel(struct ml_lib_model *ml_model);
+u32 ml_lib_worker_interval(struct ml_lib_model *ml_model);
+void ml_lib_worker_queue_work(struct ml_lib_model *ml_model,
+			      struct work_struct *work);
+void ml_lib_worker_queue_delayed_work(struct ml_lib_model *ml_model,
+				      struct delayed_work *dwork,
+				      unsigned long delay);
+ssize_t ml_lib_worker_info(struct ml_lib_model *ml_model, char *buf);
+
+#endif /* _LINUX_ML_LIB_WORKER_H */